@@ -1,2 +1,8 @@
 // HashStatistics reads a file and prints stats of this file. Returns 0 if success and -1 if failure
-int HashStatistics(char* fileName);
\ No newline at end of file
+// The stats come from the per bucket counters of the file (HT_bucket_counters), no bucket chain is read
+// While a rehash is in progress (see HT_SetSkewThreshold) they are about the new table only
+int HashStatistics(char* fileName);
+
+// Same as HashStatistics with the counters of a random sample of the buckets, fraction (0 < fraction <= 1) of them
+// picked by seed, for estimating the skew of a file with many buckets. json prints the stats as one JSON object
+int HashStatisticsSampled(char* fileName, double fraction, unsigned int seed, int json);
@@ -0,0 +1,54 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "record.h"
+#include "predicate.h"
+#include "hp_file.h"
+#include "ht_table.h"
+
+// Batch at a time pipelines over the access methods: a scan fills a vector of up to BATCH_SIZE records and hands it to
+// the stages in order. Filters only shrink its selection vector and a projection points into the rows, so no record is
+// passed by value until the sink gets the batch
+// A page can not stay pinned until the batch is full (the BF layer has BF_BUFFER_SIZE blocks), so the rows are copies.
+// The filters at the front of the pipeline run on the selection of each page while it is pinned, and only the rows
+// they keep are copied
+
+#define BATCH_SIZE 1024         // Records of a batch
+#define BATCH_MAX_STAGES 8      // Stages of a pipeline
+#define BATCH_MAX_COLUMNS 4     // Attributes of a projection
+
+typedef struct{
+  Record rows[BATCH_SIZE];
+  int count;                                    // Rows filled by the scan
+  unsigned short selection[BATCH_SIZE];         // Rows still selected, in scan order
+  int selected;
+  const void* columns[BATCH_MAX_COLUMNS][BATCH_SIZE];   // Set by a projection, columns[c][row] is attribute c of row
+                                                        // (read it as columns[c][selection[i]], later filters shrink the selection)
+  int columnCount;
+}BATCH_Vector;
+
+// A stage of the pipeline, it may shrink the selection (a stage that leaves nothing selected ends the batch)
+typedef void (*BATCH_Stage)(void* state, BATCH_Vector* batch);
+
+typedef struct BATCH_Pipeline BATCH_Pipeline;
+
+BATCH_Pipeline* BATCH_Create(void);
+void BATCH_Destroy(BATCH_Pipeline* pipeline);
+
+// Stages run in the order they are added
+// Return 0 if successfull, -1 if failure (too many stages or columns)
+int BATCH_AddStage(BATCH_Pipeline* pipeline, BATCH_Stage stage, void* state);
+// Keeps the rows whose id satisfies predicate, checked PRED_MAX_SLOTS rows at a time by PRED_EvaluatePage
+// (on a page only the first filter does, a later one checks the rows still selected one at a time)
+int BATCH_AddFilter(BATCH_Pipeline* pipeline, Predicate predicate);
+// Keeps the rows whose string attribute (NAME, SURNAME or CITY) equals value
+int BATCH_AddMatch(BATCH_Pipeline* pipeline, Record_Attribute attribute, const char* value);
+// Points columns 0 .. count - 1 of the batch to the attributes of the selected rows
+int BATCH_AddProject(BATCH_Pipeline* pipeline, const Record_Attribute attributes[], int count);
+
+// Scans the file through the pipeline, sink gets every batch with at least one selected row
+// Return the number of rows that reached the sink if successfull, -1 if failure
+long BATCH_RunHeap(BATCH_Pipeline* pipeline, HP_info* header_info, BATCH_Stage sink, void* context);
+long BATCH_RunHashtable(BATCH_Pipeline* pipeline, HT_info* header_info, BATCH_Stage sink, void* context);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef BF_CHECKSUM_H
+#define BF_CHECKSUM_H
+
+#include <stddef.h>
+
+#include "bf.h"
+
+// CRC32C checksums of the data blocks of the access methods, so a torn or corrupted block is an error instead of
+// recNumber and hashBucket values that send the scans and chain walks to the wrong blocks
+// The last 4 bytes of a data block are free in every page format (heap, hashtable, secondary index), they keep the
+// checksum of the bytes before them. 0 there means no checksum (blocks written with checksums off), except in the
+// strict files, whose header says that every data block got one since the file was created
+// The access methods set it whenever they change a block, before it can be written back, and BF_GetBlockData and
+// BF_GetBlockCounted check it when they get a block through the BF layer or from a mapping (not from a pool, its
+// copies were checked when they were read)
+
+#define BF_CHECKSUM_OFFSET (BF_BLOCK_SIZE - (int) sizeof(unsigned int))
+
+// 1 if block_num is a data block with a checksum, context is what was given to BF_ChecksumAttach
+typedef int (*BF_ChecksumBlocks)(void* context, int block_num);
+
+// CRC32C (Castagnoli) of length bytes continuing crc (0 to start), with the SSE4.2 or ARMv8 CRC instructions if the CPU has them
+unsigned int BF_Crc32c(unsigned int crc, const void* data, size_t length);
+
+// "sse4.2", "armv8" or "software", the way BF_Crc32c computes on this CPU
+const char* BF_Crc32cPath(void);
+
+// Off, the blocks changed after the call get no checksum and none is checked (on if never called)
+void BF_ChecksumSetEnabled(const int on);
+int BF_ChecksumEnabled(void);
+
+// Called by the access methods when a file is opened as file_desc (BF layer or mapped) and before it is closed
+// strict: every data block of the file has a checksum, a block without one is corrupted, and the blocks changed
+// while checksums are off still get theirs
+void BF_ChecksumAttach(const int file_desc, BF_ChecksumBlocks blocks, void* context, const int strict);
+void BF_ChecksumDetach(const int file_desc);
+
+// Sets the checksum of data, block block_num of file_desc, after a change. Nothing for the other blocks of the file
+void BF_ChecksumSeal(const int file_desc, const int block_num, char* data);
+
+// Same as BF_ChecksumSeal for a block that is not a data block yet but is about to be one (e.g. a directory block
+// that a rehash leaves behind), so it has its checksum before the file says it is a data block
+void BF_ChecksumSealReused(const int file_desc, char* data);
+
+// Return 0 if data (block block_num of file_desc) has the checksum of its bytes or none, -1 if it is corrupted (printed)
+int BF_ChecksumVerify(const int file_desc, const int block_num, const char* data);
+
+#endif
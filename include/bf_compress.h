@@ -0,0 +1,16 @@
+#ifndef BF_COMPRESS_H
+#define BF_COMPRESS_H
+
+// LZ compression of runs of blocks, in the LZ4 block format (sequences of a token, literals, a 2 byte offset and a
+// match length) so the extents can also be read by any LZ4 decoder. Greedy matching with a hash of 4 bytes, it is
+// meant for the pages of sealed files (see HP_SealFile), records with zero padded strings from small sets of values
+
+// Compresses length bytes of source to destination (capacity bytes)
+// Return the compressed length if successfull, -1 if it does not fit in capacity (e.g. data that does not compress)
+int BF_Compress(const char* source, const int length, char* destination, const int capacity);
+
+// Decompresses length bytes of source to destination (capacity bytes), every offset and length is checked
+// Return the decompressed length if successfull, -1 if source is not a valid stream or needs more than capacity
+int BF_Decompress(const char* source, const int length, char* destination, const int capacity);
+
+#endif
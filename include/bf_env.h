@@ -0,0 +1,55 @@
+#ifndef BF_ENV_H
+#define BF_ENV_H
+
+#include "bf.h"
+#include "bf_pool.h"
+
+// Workspaces of files that share a memory budget, e.g. one for every tenant of a server process
+// libbf has one buffer and one file table for the whole process, so a BF_Env owns what can be split on top of it:
+//   - a block pool of its own size and policy (see bf_pool.h), the blocks its files read are kept there
+//     and the files of the other envs cannot evict them
+//   - the files opened in it (HP_OpenFileEnv, HT_OpenFileEnv, SHT_OpenSecondaryIndexEnv), BF_EnvDestroy closes
+//     the ones still open, so an env is torn down without touching the others
+//   - the counters of its pool and files
+// The first BF_EnvCreate calls BF_Init and the last BF_EnvDestroy calls BF_Close, a program with envs calls neither
+
+#define BF_ENV_MAX BF_POOL_MAX    // Envs that can exist at once, every one has a pool
+#define BF_ENV_FILES 32           // Files open in an env at once
+
+typedef struct BF_Env BF_Env;
+
+// Closes a file of an env, e.g. HP_CloseFile on its HP_info
+typedef int (*BF_EnvClose)(void* info);
+
+typedef struct{
+  int blocks;         // Budget of the pool
+  int files;          // Files open now
+  long opened;        // Files opened since BF_EnvCreate
+  long hits;          // Blocks read from the pool
+  long misses;        // Blocks read through the BF layer
+}BF_EnvStats;
+
+// Creates the env name with a pool of blocks blocks and replacement policy policy
+// Return the env if successfull, NULL if failure (the name is taken, BF_ENV_MAX envs exist or no memory)
+BF_Env* BF_EnvCreate(const char* name, const int blocks, const ReplacementAlgorithm policy);
+
+// Closes the files still open in env, drops its pool and frees it, the last env also closes the BF layer
+// Returns BF_OK if successfull or an error code if a file could not be closed (env is gone anyway)
+BF_ErrorCode BF_EnvDestroy(BF_Env* env);
+
+const char* BF_EnvName(const BF_Env* env);
+
+// Gives the counters of env in stats
+void BF_EnvCounters(const BF_Env* env, BF_EnvStats* stats);
+
+// Used by the Env opens of the access methods. filename reads its blocks through the pool of env from its next open
+// on, until env is destroyed. Returns BF_OK if successfull or an error code if failed
+BF_ErrorCode BF_EnvUse(BF_Env* env, const char* filename);
+
+// info was opened in env and is closed with close. Returns BF_OK if successfull, BF_ERROR if env has BF_ENV_FILES files
+BF_ErrorCode BF_EnvAdd(BF_Env* env, void* info, BF_EnvClose close);
+
+// Called by the close functions of the access methods, nothing for a file of no env
+void BF_EnvRemove(void* info);
+
+#endif
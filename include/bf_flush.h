@@ -0,0 +1,53 @@
+#ifndef BF_FLUSH_H
+#define BF_FLUSH_H
+
+// Background writer on top of the BF layer (write-behind). Instead of making a changed block dirty, the access method
+// gives a copy of it to the writer thread, which writes the pending blocks in block order with pwritev
+// The frame stays clean, so evicting it costs nothing to the BF_GetBlock or BF_AllocateBlock that chose it as victim
+// A frame evicted before its copy reached the file is read back stale, BF_FlushRefresh puts the pending copy over it
+// (or the one in the file, if the writer wrote it while the frame was read)
+
+#define BF_FLUSH_SLOTS 128      // Blocks waiting to be written, when all are taken the foreground waits for the writer
+#define BF_FLUSH_BATCH 32       // Pending blocks that wake up the writer before its timer does
+#define BF_FLUSH_INTERVAL_MS 10 // The writer trickles what is pending at least this often
+
+typedef enum BF_IoMode{
+  BF_IO_BUFFERED,   // Blocks are written through the OS page cache
+  BF_IO_DIRECT      // Blocks are written with O_DIRECT, so the OS does not cache a second copy of what the BF layer holds
+}BF_IoMode;
+
+// Chooses how the files attached after this call are written (BF_IO_BUFFERED if never called)
+// A file system or device that cannot do direct I/O of BF_BLOCK_SIZE blocks keeps using the page cache
+// In BF_IO_DIRECT mode there is no prefetch either, it would only fill the page cache
+void BF_SetIoMode(const BF_IoMode mode);
+
+// Returns the mode chosen with BF_SetIoMode
+BF_IoMode BF_GetIoMode(void);
+
+// Registers the file opened with BF_OpenFile as file_desc, so its blocks can be written in the background
+// The writer thread starts with the first attached file
+void BF_FlushAttach(const char* filename, const int file_desc);
+
+// Writes every pending block of file_desc, must be called before BF_CloseFile
+// The writer thread stops with the last detached file
+// Return 0 if successfull, -1 if a block could not be written (only a log still has it)
+int BF_FlushDetach(const int file_desc);
+
+// Takes the place of BF_Block_SetDirty, data (block block_num) is copied and written later
+// Return 0 if successfull, -1 if the file is not attached or every slot is kept by a failed write (the block must be
+// made dirty instead)
+int BF_FlushBlock(const int file_desc, const int block_num, const char* data);
+
+// Writes of file_desc finished so far, taken before getting a block and given to BF_FlushRefresh
+unsigned int BF_FlushWritten(const int file_desc);
+
+// Called after getting block block_num, if a copy of it is still pending it is copied over data
+// If none is but a write finished since BF_FlushWritten returned written, the block is read again from the file
+void BF_FlushRefresh(const int file_desc, const int block_num, char* data, const unsigned int written);
+
+// Checkpoint of file_desc, every pending block is written and the file is synced to disk
+// A block whose write failed is tried again, it stays pending if it fails once more
+// Return 0 if successfull, -1 if failure
+int BF_FlushSync(const int file_desc);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef BF_HEADER_H
+#define BF_HEADER_H
+
+// Block 0 of the heap, hashtable and secondary hashtable files is a header in a fixed format: the identifier string
+// of the access method, a version, then the fields one after the other as little endian integers of 4 or 8 bytes
+// So a file means the same for every build and machine, and nothing of an open (e.g. its file descriptor) is kept in it
+// The open functions decode the header into an HP_info, HT_info or SHT_info of their own and unpin block 0,
+// the close functions (and HP_Checkpoint) encode it back
+
+typedef struct{
+  char* data;       // Block 0
+  int offset;       // Next byte of a field
+  int overflow;     // Set if a field did not fit in the block, it was not written (or read as 0)
+}BF_Header;
+
+// Starts a header with identifier and version in data, the rest of the block is zeroed
+void BF_HeaderWrite(BF_Header* header, char* data, const char* identifier, const int version);
+
+// Starts reading the header in data
+// Return its version if successfull, -1 if data does not start with identifier
+int BF_HeaderRead(BF_Header* header, const char* data, const char* identifier);
+
+void BF_HeaderPutInt(BF_Header* header, const int value);
+void BF_HeaderPutLong(BF_Header* header, const long value);
+
+int BF_HeaderGetInt(BF_Header* header);
+long BF_HeaderGetLong(BF_Header* header);
+
+#endif
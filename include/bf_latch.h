@@ -0,0 +1,47 @@
+#ifndef BF_LATCH_H
+#define BF_LATCH_H
+
+#include "bf.h"
+
+// Latches for threads that share the open hashtable files. libbf (with the pools on top of it) is not thread safe,
+// so the BF lock, one recursive mutex, is held around every call into it and around every change of block bytes
+// that a thread without the latches below may read. On top of it every file attached with BF_LatchAttach has
+//   - a directory latch, shared by the inserts and lookups, exclusive for what moves buckets (a rehash step)
+//   - a reader / writer latch for every bucket, exclusive for an insert into the bucket, shared for its lookups
+//   - a file latch, the mutex of the block allocator and of the header fields that every bucket changes
+// They are taken in this order and the BF lock last. For a file that is not attached (e.g. a mapped one) they do nothing
+
+typedef enum BF_LatchMode{
+  BF_LATCH_SHARED,
+  BF_LATCH_EXCLUSIVE
+}BF_LatchMode;
+
+void BF_Lock(void);
+void BF_Unlock(void);
+
+// libbf keeps one pin per frame, the first BF_UnpinBlock frees a block that another thread still has pinned
+// These count the pins of every frame (under the BF lock) and unpin it in libbf with the last one, dirty if it was
+// pinned by more than one holder. Blocks pinned with BF_GetBlock directly (block 0 of the access methods) are not counted
+// BF_GetBlockCounted puts a copy still pending in the background writer over the frame before it checks the checksum
+BF_ErrorCode BF_GetBlockCounted(const int file_desc, const int block_num, BF_Block* block);
+BF_ErrorCode BF_AllocateBlockCounted(const int file_desc, BF_Block* block);
+BF_ErrorCode BF_UnpinBlockCounted(BF_Block* block);
+
+// Creates the latches of the file opened as file_desc, for buckets buckets at most
+// Return 0 if successfull, -1 if failure
+int BF_LatchAttach(const int file_desc, const int buckets);
+
+// Drops the latches of file_desc and the pins counted for it, no thread can hold them
+void BF_LatchDetach(const int file_desc);
+
+// Waiting writers go first, so the readers of a busy file cannot keep a rehash out for ever
+void BF_LatchDirectory(const int file_desc, const BF_LatchMode mode);
+void BF_UnlatchDirectory(const int file_desc);
+
+void BF_LatchBucket(const int file_desc, const int bucket, const BF_LatchMode mode);
+void BF_UnlatchBucket(const int file_desc, const int bucket);
+
+void BF_LatchFile(const int file_desc);
+void BF_UnlatchFile(const int file_desc);
+
+#endif
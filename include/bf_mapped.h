@@ -0,0 +1,42 @@
+#ifndef BF_MAPPED_H
+#define BF_MAPPED_H
+
+#include "bf.h"
+
+// Read only memory mapped files, next to the BF layer. The blocks of a mapped file are pointers into
+// the mapping, so there is no copy into a buffer frame and no limit of BF_BUFFER_SIZE blocks in memory
+// Mapped files get file descriptors starting at BF_MAPPED_FILE_BASE so they never collide with the BF layer ones
+
+#define BF_MAPPED_FILE_BASE BF_MAX_OPEN_FILES
+
+typedef enum BF_MappedAdvice{
+  BF_ADVICE_SEQUENTIAL,   // Scans (heap file), the kernel reads ahead aggressively
+  BF_ADVICE_RANDOM        // Probes (hashtable buckets), the kernel reads only the requested pages
+}BF_MappedAdvice;
+
+// Maps the existing file filename and returns its ID in the file_desc variable
+// The mapping is private, changes made through it (e.g. to the header) are never written to the file
+// Returns BF_OK if successfull or an error code if failed
+BF_ErrorCode BF_OpenFileMapped(const char* filename, int *file_desc);
+
+// Unmaps the file with ID file_desc
+// Returns BF_OK if successfull or an error code if failed
+BF_ErrorCode BF_CloseFileMapped(const int file_desc);
+
+// Return 1 if file_desc was returned by BF_OpenFileMapped, 0 if not
+int BF_IsMappedFile(const int file_desc);
+
+// Gives a hint to the kernel about how the mapped file will be read
+void BF_AdviseMapped(const int file_desc, const BF_MappedAdvice advice);
+
+// Returns in data a pointer to block block_num of a file opened either with BF_OpenFile or with BF_OpenFileMapped
+// For BF_OpenFile files the block is pinned in block (or held in the pool of the file, see bf_pool.h),
+// so BF_ReleaseBlock must be called when we no longer need it
+// Returns BF_OK if successfull or an error code if failed
+BF_ErrorCode BF_GetBlockData(const int file_desc, const int block_num, BF_Block *block, char** data);
+
+// Releases a block returned by BF_GetBlockData (unpins it or releases its pool copy for BF_OpenFile files, nothing for mapped files)
+// Returns BF_OK if successfull or an error code if failed
+BF_ErrorCode BF_ReleaseBlock(const int file_desc, BF_Block *block);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef BF_POOL_H
+#define BF_POOL_H
+
+#include "bf.h"
+
+// Named block pools on top of the single buffer of the BF layer. A file assigned to a pool has the blocks it reads
+// with BF_GetBlockData kept in the pool, so they are not evicted by the blocks of the other files
+// Every pool has its own size and replacement policy, e.g. a small LRU pool keeps a hot index resident
+// while the blocks of a big scan go through the BF layer (or a small MRU pool) without pushing it out
+// Like the BF layer, pools are not thread safe, callers that read in parallel must hold the BF lock (bf_latch.h) around
+// BF_GetBlockData and BF_ReleaseBlock. BF_PoolUpdate takes it itself
+
+#define BF_POOL_MAX 8           // Pools that can exist at once
+#define BF_POOL_FILES 32        // Files that can be assigned to pools by name
+#define BF_POOL_HOLDS 64        // Pool blocks that can be held (between BF_GetBlockData and BF_ReleaseBlock) at once
+
+// Creates the pool name of blocks blocks with replacement policy policy
+// Returns BF_OK if successfull or an error code if failed
+BF_ErrorCode BF_PoolCreate(const char* name, const int blocks, const ReplacementAlgorithm policy);
+
+// Drops the pool name, no file using it can be open
+void BF_PoolDestroy(const char* name);
+
+// The file filename uses the pool name from its next open on
+// Returns BF_OK if successfull or an error code if failed
+BF_ErrorCode BF_PoolUse(const char* filename, const char* name);
+
+// Called by the access methods when filename is opened as file_desc (and closed), a file without a pool is left as it is
+void BF_PoolAttach(const char* filename, const int file_desc);
+void BF_PoolDetach(const int file_desc);
+
+// Used by BF_GetBlockData and BF_ReleaseBlock (see bf_mapped.h)
+// Returns in data the pool copy of block block_num held in block, 0 if found, -1 if the file has no pool or the block is not in it
+int BF_PoolGet(const int file_desc, const int block_num, BF_Block* block, char** data);
+// Puts a copy of data (block block_num) in the pool and holds it in block, returns the copy (NULL if every pool block is held)
+char* BF_PoolPut(const int file_desc, const int block_num, BF_Block* block, const char* data);
+// Return 1 if block held a pool block (it is released), 0 if not
+int BF_PoolRelease(const int file_desc, BF_Block* block);
+
+// Must be called after changing block block_num, so its copy in the pool (if any) stays the same as the block
+void BF_PoolUpdate(const int file_desc, const int block_num, const char* data);
+
+// Gives the blocks of BF_GetBlockData found in the pool name (hits) and read through the BF layer (misses) since it was created
+// Return 0 if successfull, -1 if there is no such pool
+int BF_PoolCounters(const char* name, long* hits, long* misses);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef BF_PREFETCH_H
+#define BF_PREFETCH_H
+
+// Asynchronous prefetch on top of the BF layer. A background I/O thread reads the requested
+// blocks of the file with pread, so when BF_GetBlock asks for them they are already in memory (OS page cache)
+// Prefetching is only a hint, the requests for files that are not attached or while the queue is full are dropped
+
+#define BF_PREFETCH_WINDOW 32   // Blocks read ahead when a sequential access is detected
+
+// Registers the file opened with BF_OpenFile as file_desc, so its blocks can be prefetched
+// The I/O thread starts with the first attached file
+void BF_PrefetchAttach(const char* filename, const int file_desc);
+
+// Drops the pending requests of file_desc, must be called before BF_CloseFile
+// The I/O thread stops with the last detached file
+void BF_PrefetchDetach(const int file_desc);
+
+// Asks the I/O thread to read the n blocks of block_nums, adjacent blocks are read with one call
+void BF_Prefetch(const int file_desc, const int block_nums[], const int n);
+
+// Tells that block_num is about to be read with BF_GetBlock. After a few reads of consecutive blocks
+// the next BF_PREFETCH_WINDOW blocks are prefetched (sequential read-ahead)
+void BF_PrefetchAccess(const int file_desc, const int block_num);
+
+#endif
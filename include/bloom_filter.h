@@ -0,0 +1,19 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+// Bloom filter over a raw byte area (e.g. a directory block of a hashtable file)
+// A negative answer is always correct, a positive one is wrong with probability close to the chosen false positive rate
+// as long as the filter of m bits holds at most m * ln(2)^2 / -ln(rate) keys. The rate grows beyond that, a 4096 bit
+// filter (one block) built for 1% holds about 430 keys and is wrong about 25% of the time with 1000
+
+// Returns the amount of hash functions needed for the given false positive rate (0 < rate < 1)
+// Return 0 if the rate is out of range (filter disabled)
+int BLOOM_HashFunctions(double falsePositiveRate);
+
+// Sets the bits of key (of length bytes) in the filter, which has bits size
+void BLOOM_Add(unsigned char* filter, int bits, int hashes, const void* key, int length);
+
+// Return 1 if the key may exist in the filter, 0 if it surely does not
+int BLOOM_MayContain(const unsigned char* filter, int bits, int hashes, const void* key, int length);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef EXTERNAL_SORT_H
+#define EXTERNAL_SORT_H
+
+#include <stddef.h>
+#include "record.h"
+#include "hp_file.h"
+#include "ht_table.h"
+
+// External merge sort of the records of a file by one attribute, into a new heap file through the BF layer
+// Runs are generated with replacement selection (a heap of the records that fit in the memory budget, about two budgets
+// of records per run on random input) and written to temporary heap files. They are merged fanIn at a time with a loser
+// tree until one pass writes the output, so its blocks hold the records in order (for merge joins or bulk loading)
+
+#define SORT_MAX_FAN_IN 16          // Runs merged at once, every run being merged holds one block in memory
+#define SORT_MIN_BUDGET 4096        // Bytes, a smaller budget is raised to this
+
+typedef struct{
+  long records;
+  int runs;           // Runs written by run generation
+  int passes;         // Merge passes, the last one writes the output
+}SORT_Stats;
+
+// Sorts the records of the heap file header_info by attribute into outputName (created, it must not be open)
+// memoryBudget bounds the replacement selection heap, fanIn the runs merged at once (at most SORT_MAX_FAN_IN)
+// stats, if not NULL, gets what the sort did. Equal records keep no particular order
+// Return the number of records sorted if successfull, -1 if failure
+long SORT_HeapFile(HP_info* header_info, Record_Attribute attribute, char* outputName, size_t memoryBudget, int fanIn, SORT_Stats* stats);
+
+// Same as SORT_HeapFile, for the records of a hashtable file
+long SORT_HashtableFile(HT_info* header_info, Record_Attribute attribute, char* outputName, size_t memoryBudget, int fanIn, SORT_Stats* stats);
+
+#endif
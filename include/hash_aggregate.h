@@ -0,0 +1,32 @@
+#ifndef HASH_AGGREGATE_H
+#define HASH_AGGREGATE_H
+
+#include <stddef.h>
+#include "record.h"
+#include "hp_file.h"
+#include "ht_table.h"
+
+// COUNT, MIN and MAX of the ids of the records of a file, grouped by one attribute, in one scan of its blocks
+// Groups live in a dense array indexed by an open addressing table of (hash, group) slots, so a probe reads 8 byte slots
+// When the groups outgrow the memory budget the records of new groups are spilled by hash to partition heap files
+// (the groups already in memory keep aggregating) and every partition is aggregated the same way afterwards
+
+#define AGG_PARTITIONS 8        // Partition files of one spill
+#define AGG_MAX_DEPTH 3         // Spills of a partition that still has too many groups, after that the table grows anyway
+
+typedef struct{
+  Record key;         // Only the attribute grouped by is meaningful
+  long count;
+  int minId;
+  int maxId;
+}AGG_Group;
+
+// Gets every group once, in no particular order (valid only until it returns)
+typedef void (*AGG_Emit)(void* context, const AGG_Group* group);
+
+// Aggregates the records of the file grouped by attribute using at most memoryBudget bytes for the groups
+// Return the number of groups if successfull, -1 if failure
+long AGG_HeapFile(HP_info* header_info, Record_Attribute attribute, size_t memoryBudget, AGG_Emit emit, void* context);
+long AGG_HashtableFile(HT_info* header_info, Record_Attribute attribute, size_t memoryBudget, AGG_Emit emit, void* context);
+
+#endif
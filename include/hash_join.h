@@ -0,0 +1,39 @@
+#ifndef HASH_JOIN_H
+#define HASH_JOIN_H
+
+#include <stddef.h>
+#include "record.h"
+#include "hp_file.h"
+#include "ht_table.h"
+
+// Equi-join of two Record files (heap or hashtable) on one attribute of each
+// The smaller input is loaded in an in-memory hash table (open addressing, records kept in an arena) and the larger
+// one is scanned block by block to probe it. When the build side does not fit in the memory budget, both inputs are
+// first split in partition files through the BF layer and every pair of partitions is joined the same way (Grace hash join)
+
+#define JOIN_ARENA_CHUNK 4096     // Records of every arena allocation
+#define JOIN_MAX_PARTITIONS 16    // Partitions of one split, two heap files each are open at once
+#define JOIN_MAX_DEPTH 3          // Splits of a partition that still does not fit, after that it is joined in memory anyway
+
+typedef enum JOIN_InputType{
+  JOIN_HEAP,
+  JOIN_HASHTABLE
+}JOIN_InputType;
+
+typedef struct{
+  JOIN_InputType type;
+  void* info;                     // HP_info or HT_info of an open file
+  Record_Attribute attribute;     // Join key of this input
+}JOIN_Input;
+
+// Gets every pair of joined records, left is always a record of the first input
+typedef void (*JOIN_Emit)(void* context, const Record* left, const Record* right);
+
+JOIN_Input JOIN_HeapInput(HP_info* info, Record_Attribute attribute);
+JOIN_Input JOIN_HashtableInput(HT_info* info, Record_Attribute attribute);
+
+// Joins left and right using at most memoryBudget bytes for the hash table, emit is called for every pair
+// Return the number of pairs if successfull, -1 if failure
+long JOIN_HashJoin(JOIN_Input left, JOIN_Input right, size_t memoryBudget, JOIN_Emit emit, void* context);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+
+// Latency histogram in the style of HdrHistogram: log-linear buckets, every power of two is split in
+// HIST_SUB_BUCKETS / 2 linear sub buckets, so any value is kept within 1 / (HIST_SUB_BUCKETS / 2) of itself
+// (about 1.6%) in a fixed array, whatever the range. Recording is a few shifts and an increment
+
+#define HIST_SUB_BITS 7                           // Sub buckets per power of two = 2^(HIST_SUB_BITS - 1)
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BITS)
+#define HIST_MAX_BITS 42                          // Largest value kept is 2^42 - 1 (73 minutes in ns), larger ones count as it
+#define HIST_COUNTS ((HIST_MAX_BITS - HIST_SUB_BITS + 2) * (HIST_SUB_BUCKETS / 2))
+
+typedef struct{
+  uint64_t counts[HIST_COUNTS];
+  uint64_t total;
+  uint64_t min;
+  uint64_t max;
+  double sum;
+}HIST_Histogram;
+
+void HIST_Init(HIST_Histogram* histogram);
+
+void HIST_Record(HIST_Histogram* histogram, uint64_t value);
+
+// Adds the values of from to histogram
+void HIST_Merge(HIST_Histogram* histogram, const HIST_Histogram* from);
+
+// Returns the value at percentile (0 - 100), as the largest value of its bucket, 0 for an empty histogram
+uint64_t HIST_Percentile(const HIST_Histogram* histogram, double percentile);
+
+double HIST_Mean(const HIST_Histogram* histogram);
+
+#endif
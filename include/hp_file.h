@@ -2,6 +2,8 @@
 #define HP_FILE_H
 
 #include <record.h>
+#include <bf_env.h>
+#include <predicate.h>
 
 // Return code emuration
 typedef enum HP_ErrorCode{
@@ -9,14 +11,21 @@ typedef enum HP_ErrorCode{
     HP_ERROR = -1
 }HP_ErrorCode;    
 
-// HP_info has informations about the heap file
+// HP_info has informations about the heap file, kept in block 0 in the format of bf_header.h (fileDesc and blockId are not kept)
 typedef struct{
     int blockId;        // ID of the block
     int fileDesc;       // File ID
     int lastBlockId;    // ID of the last file's block 
+    int lastBlockRecs;  // Records of the last block, it has free space if this is less than maxBlockRecs
     int maxBlockRecs;   // Max amount of records a block can have
+    int sealedBlocks;   // Blocks [1, sealedBlocks] are compressed in extents by HP_SealFile, 0 if the file was never sealed
+    int extents;        // Extents of the sealed blocks, their map is in the blocks after block 0
+    int tailShift;      // Block blockId > sealedBlocks is block blockId + tailShift of the file (0 if never sealed)
+    int flags;          // HP_FLAG_ bits
 }HP_info;
 
+#define HP_FLAG_CHECKSUMS 1     // Every data block has a checksum since the file was created (see bf_checksum.h)
+
 // HP_block_info has informations about the block
 typedef struct{
     int recNumber;      // Number of records a block has 
@@ -30,14 +39,45 @@ int HP_CreateFile(char *fileName);
 // Opens the file named filename and reads from the first block the information about the heap file
 // Then, a structure is updated that holds as much information as deemed necessary 
 // for this file in order to be able to edit then edit its records
+// The header in block 0 (see bf_header.h) is decoded into an HP_info of its own and block 0 is unpinned, HP_CloseFile
+// and HP_Checkpoint write it back. So many heap files can be open at once, each with its own HP_info
 HP_info* HP_OpenFile(char *fileName);
 
+// Same as HP_OpenFile but the file is memory mapped read only (see bf_mapped.h), for scan only sessions
+// The scans read the blocks straight from the mapping, HP_InsertEntry fails. Close it with HP_CloseFile
+HP_info* HP_OpenFileMapped(char *fileName);
+
+// Same as HP_OpenFile but the file is opened in env (see bf_env.h), its blocks are kept in the pool of env and
+// BF_EnvDestroy closes it if it is still open. Close it with HP_CloseFile
+HP_info* HP_OpenFileEnv(BF_Env* env, char *fileName);
+
 // Closes the file specified within the header_info structure
 // The function is is also responsible for freeing the memory occupied
 // by the structure passed as a parameter, in case the closure was successfully performed
 // Return 0 if successfull, -1 if failure
 int HP_CloseFile(HP_info* header_info);
 
+// Checkpoint, the blocks changed so far and block 0 are written and synced to disk, and the log is emptied
+// A crash after it replays only what was inserted after the checkpoint. Call it periodically during long inserts
+// Return 0 if successfull, -1 if failure
+int HP_Checkpoint(HP_info* header_info);
+
+// Rewrites the closed heap file fileName with its full blocks (all but the last one) compressed in extents of
+// consecutive blocks (see bf_compress.h), so cold files take less disk and their scans read fewer blocks
+// The block ids do not change, the scans and lookups decompress the extents on the way and the inserts go on in the last block
+// The file is replaced only after its sealed copy is complete. A sealed file can be sealed again after more inserts
+// Return the number of blocks in extents if successfull, -1 if failure
+int HP_SealFile(char *fileName);
+
+// Calls visitor with the records of every block of the file, in file order (see Record_PageVisitor)
+// Return the number of blocks read if successfull, -1 if failure
+int HP_ScanPages(HP_info* header_info, Record_PageVisitor visitor, void* context);
+
+// Copies the records of block block_num to records (room for maxBlockRecs) and gives in next the block after it, 0 at the end
+// The first block is 1 (the file is empty if lastBlockId is 0). Nothing stays pinned, so many files can be read a block at a time
+// Return the number of records copied if successfull, -1 if failure
+int HP_ReadPage(HP_info* header_info, int block_num, Record* records, int* next);
+
 // Insert a entry into the heap file, the information about the file is in the
 // header_info structure while the record to be inserted is specified by the record structure
 // Return the number of the block in which the insertion was made (blockId) if successfull, -1 if failure
@@ -50,4 +90,15 @@ int HP_InsertEntry(HP_info* header_info, Record record);
 // Return the number of readed blocks if successfull, -1 if failure
 int HP_GetAllEntries(HP_info* header_info, int id);
 
+// Print all records of the heap file whose id satisfies the predicate (=, <, > or BETWEEN)
+// The ids of each block are checked together by PRED_EvaluatePage
+// Return the number of readed blocks if successfull, -1 if failure
+int HP_GetEntriesWhere(HP_info* header_info, Predicate predicate);
+
+// Same as HP_GetAllEntries but the blocks [1, lastBlockId] are split in morsels of consecutive blocks
+// that are handed out to threads workers, each one checks the records of its blocks and the results
+// are merged in file order before printing. The whole file is always read
+// Return the number of readed blocks if successfull, -1 if failure
+int HP_ParallelGetAllEntries(HP_info* header_info, int id, int threads);
+
 #endif
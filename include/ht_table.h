@@ -2,6 +2,7 @@
 #define HT_TABLE_H
 
 #include <record.h>
+#include <bf_env.h>
 
 // Return code emuration
 typedef enum HT_ErrorCode{
@@ -9,16 +10,38 @@ typedef enum HT_ErrorCode{
     HT_ERROR = -1
 }HT_ErrorCode;
 
-// HT_info has informations about the hastable file
+// HT_info has informations about the hastable file, kept in block 0 in the format of bf_header.h (fileDesc, blockId and scans are not kept)
 typedef struct{
     int blockId;            // ID of the block
     int fileDesc;           // File ID
     int lastBlockId;        // ID of the last file's block
     int maxBlockRecs;       // Max amount of records a block can have
+    int filterHashes;       // Hash functions of the per bucket bloom filters (0 if the file has no filters)
+    int filterBlock;        // First block of the per bucket filters
+    int counterBlock;       // First block of the per bucket counters, after the filters
+    int hashSeed;           // 0 for id % numBuckets, every rehash changes it
+    int maxChain;           // Blocks of the longest bucket chain, kept by the inserts
+    int tableBlocks;        // Blocks of all the bucket chains
+    int rehashBlock;        // Block that keeps the old table of a rehash in progress, 0 if there is none
+    int flags;              // HT_FLAG_ bits
+    int scans;              // HT_ScanPages calls running on the file, no rehash step moves records while there are any
     long int numBuckets;    // Buckets of our hashtable
     int hashTable[];        // Hashtable array
 }HT_info;
 
+#define HT_FLAG_INDEXED 1       // A secondary index keeps the blocks of the records, so they never move (no rehash)
+#define HT_FLAG_CHECKSUMS 2     // Every data block has a checksum since the file was created (see bf_checksum.h)
+
+// HT_bucket_counters are kept for every bucket in the counter blocks (HT_COUNTERS_PER_BLOCK buckets each)
+// Every insert updates them, so the statistics of a file need no walk of its chains
+// SHT files keep them the same way
+typedef struct{
+    int records;            // Records of the bucket
+    int blocks;             // Blocks of the bucket chain
+}HT_bucket_counters;
+
+#define HT_COUNTERS_PER_BLOCK ((int) (BF_BLOCK_SIZE / sizeof(HT_bucket_counters)))
+
 // HT_block_info has informations about the block
 typedef struct{
     int recNumber;          // Number of records a block has
@@ -31,12 +54,35 @@ typedef struct{
 // Return 0 if successfull, -1 if failure
 int HT_CreateFile(char *fileName, int buckets);
 
+// Same as HT_CreateFile but every bucket also gets a bloom filter, kept in a directory block right after block 0
+// Lookups for values that the filter rejects are answered without reading any data block
+// falsePositiveRate (0 < rate < 1) picks the amount of hash functions, 0 creates the file without filters
+// Every filter is one block of 4096 bits, it keeps the rate up to 4096 * ln(2)^2 / -ln(rate) records per bucket
+// (about 430 for 1%, 660 for 5%), a file expected to hold more needs more buckets
+// Return 0 if successfull, -1 if failure
+int HT_CreateFileWithFilter(char *fileName, int buckets, double falsePositiveRate);
+
 // Opens the file named filename and reads from the first block the information about the hashtable file
 // Then, a structure is updated that holds as much information as deemed necessary 
 // for this file in order to be able to edit then edit its records
+// The header in block 0 is decoded into an HT_info of its own and block 0 is unpinned, HT_CloseFile writes it back
 // In case of an error then it returns NULL
 HT_info* HT_OpenFile(char *fileName);
 
+// Decodes data, block 0 of a hashtable file, into an HT_info of its own (free it with free), with room for the table of any rehash
+// Return NULL if data is not the header of a hashtable file or has a version this build does not read
+HT_info* HT_DecodeHeader(const char* data);
+
+// Same as HT_OpenFile but the file is memory mapped read only (see bf_mapped.h), for lookup only sessions
+// HT_GetAllEntries reads the blocks straight from the mapping, HT_InsertEntry fails. Close it with HT_CloseFile
+// In case of an error then it returns NULL
+HT_info* HT_OpenFileMapped(char *fileName);
+
+// Same as HT_OpenFile but the file is opened in env (see bf_env.h), its blocks are kept in the pool of env and
+// BF_EnvDestroy closes it if it is still open. Close it with HT_CloseFile
+// In case of an error then it returns NULL
+HT_info* HT_OpenFileEnv(BF_Env* env, char *fileName);
+
 // Closes the file specified in in the header_info structure
 // The function is is also responsible for freeing the memory occupied
 // by the structure passed as a parameter, in case the closure was successfully performed
@@ -55,4 +101,32 @@ int HT_InsertEntry(HT_info* header_info, Record record);
 // Return the number of readed blocks if successfull, -1 if failure
 int HT_GetAllEntries(HT_info* header_info, int value);
 
+// Calls visitor with the records of every data block of the file, in file order and not by bucket (see Record_PageVisitor)
+// Other threads may insert and look up while it runs, and so may visitor (no latch is held while it runs). Records
+// inserted after the call may be missed, and a rehash in progress waits until the scan is done
+// Return the number of blocks read if successfull, -1 if failure
+int HT_ScanPages(HT_info* header_info, Record_PageVisitor visitor, void* context);
+
+// 1 if blockId is block 0, the old table of a rehash or a filter or counter block of the current table, 0 for a data block
+int HT_IsDirectoryBlock(HT_info* header_info, int blockId);
+
+// Chooses the skew (see HT_Skew) above which an insert starts an online rehash of its file, 0 (the default) never rehashes
+// A rehash doubles the buckets, as many as block 0 can keep, and changes the hash function. Every following insert
+// moves one bucket of the old table to the new one, the lookups search both until the last bucket is moved
+// The records move to other blocks, so a file with HT_FLAG_INDEXED is never rehashed
+// The emptied blocks of the old table stay in the file, so every rehash grows it by them and HT_ScanPages still reads them
+void HT_SetSkewThreshold(double threshold);
+
+// Sets HT_FLAG_INDEXED in the header of the hashtable file fileName, and in its HT_info if the file is open
+// SHT_CreateSecondaryIndex calls it before it creates an index on the file
+// Return 0 if successfull, -1 if failure (not a hashtable file, or a rehash of it is in progress)
+int HT_MarkIndexed(char* fileName);
+
+// Blocks of the bucket chains of the current table and, while a rehash is in progress, of the old one
+// The blocks emptied by the rehashes that are done are not counted, so it times maxBlockRecs bounds the records of the file
+int HT_DataBlocks(HT_info* header_info);
+
+// Blocks of the longest bucket chain over the average blocks of a chain, about 1 when the records are spread evenly
+double HT_Skew(HT_info* header_info);
+
 #endif
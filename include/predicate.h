@@ -0,0 +1,29 @@
+#ifndef PREDICATE_H
+#define PREDICATE_H
+
+#define PRED_MAX_SLOTS 32   // Max amount of slots PRED_EvaluatePage checks in one call (bits of the mask)
+
+typedef enum Predicate_Operator{
+  PRED_EQUAL,
+  PRED_LESS,
+  PRED_GREATER,
+  PRED_BETWEEN
+}Predicate_Operator;
+
+// Predicate over an int attribute, e.g. id BETWEEN low AND high
+typedef struct{
+  Predicate_Operator op;
+  int low;          // The value for =, <, > and the lower bound of BETWEEN
+  int high;         // The upper bound of BETWEEN (both bounds are inclusive)
+}Predicate;
+
+// Checks the int found at offset bytes inside each of the count slots of a page (slot i starts at records + i * stride)
+// Uses AVX2 or SSE2 when the cpu has them, else one slot at a time
+// Return a mask with bit i set if slot i satisfies the predicate (count up to PRED_MAX_SLOTS)
+unsigned int PRED_EvaluatePage(const void* records, int count, int stride, int offset, const Predicate* predicate);
+
+// Checks one value, for callers with too few slots to pay for a kernel call
+// Return 1 if value satisfies the predicate, else 0
+int PRED_Check(int value, const Predicate* predicate);
+
+#endif
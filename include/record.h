@@ -16,8 +16,31 @@ typedef struct Record{
 	char city[20];
 }Record;
 
+// The values randomRecord picks from, defined in record.c (the workloads use them first for every attribute)
+extern const char* names[];
+extern const char* surnames[];
+extern const char* cities[];
+extern const int nameCount;
+extern const int surnameCount;
+extern const int cityCount;
+
 Record randomRecord();
 
 void printRecord(Record record);
 
+// Off, printRecord prints nothing (e.g. so a benchmark times the lookups and not their output). On if never called
+void setRecordPrinting(int on);
+
+// Returns a pointer to the attribute of record and its length in bytes (strings without their '\0')
+const void* recordKey(const Record* record, Record_Attribute attribute, int* length);
+
+// Orders two records by attribute, ids as numbers and strings as strcmp does. Returns <0, 0 or >0
+int recordCompare(const Record* first, const Record* second, Record_Attribute attribute);
+
+// Hash of the attribute of record, a different seed gives an independent hash (e.g. to split a partition again)
+unsigned int recordHash(const Record* record, Record_Attribute attribute, unsigned int seed);
+
+// Gets the records of one block from the page scans of the access methods (valid only until it returns)
+typedef void (*Record_PageVisitor)(void* context, const Record* records, int count);
+
 #endif
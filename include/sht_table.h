@@ -2,6 +2,7 @@
 #define SHT_TABLE_H
 
 #include <record.h>
+#include <bf_env.h>
 #include <ht_table.h>
 
 // Return code emuration
@@ -10,16 +11,26 @@ typedef enum SHT_ErrorCode{
     SHT_ERROR = -1
 }SHT_ErrorCode;
 
-// SHT_info has informations about the secondary hastable file
+// SHT_info has informations about the secondary hastable file, kept in block 0 in the format of bf_header.h (fileDesc and blockId are not kept)
 typedef struct{
     int blockId;            // ID of the block
     int fileDesc;           // File ID
     int lastBlockId;        // ID of the last file's block
     int maxBlockRecs;       // Max amount of records a block can have
+    int filterHashes;       // Hash functions of the per bucket bloom filters (0 if the file has no filters)
+    int filterBlock;        // First block of the per bucket filters
+    int counterBlock;       // First block of the per bucket counters (HT_bucket_counters), after the filters
+    int hashSeed;           // 0 for the sum of the name characters % numBuckets, every rehash changes it
+    int maxChain;           // Blocks of the longest bucket chain, kept by the inserts
+    int tableBlocks;        // Blocks of all the bucket chains
+    int rehashBlock;        // Block that keeps the old table of a rehash in progress, 0 if there is none
+    int flags;              // SHT_FLAG_ bits
     long int numBuckets;    // Buckets of our hashtable
     int hashTable[];        // Hashtable array
 }SHT_info;
 
+#define SHT_FLAG_CHECKSUMS 1    // Every data block has a checksum since the file was created (see bf_checksum.h)
+
 // SHT_block_info has informations about the block
 typedef struct{
     int recNumber;          // Number of records a block has
@@ -30,17 +41,38 @@ typedef struct{
 // file with the name sfileName and filename for hash file
 // It takes as input parameters the name of the file in which to
 // build the heap and the number of buckets of the hash function
+// The hashtable file fileName gets HT_FLAG_INDEXED, so it is never rehashed (see HT_MarkIndexed)
 // Return 0 if successfull, -1 if failure
 int SHT_CreateSecondaryIndex(char *sfileName, int buckets, char* fileName);
 
+// Same as SHT_CreateSecondaryIndex but every bucket also gets a bloom filter of the names, kept in a directory
+// block right after block 0. falsePositiveRate (0 < rate < 1) picks the amount of hash functions, 0 disables the filters
+// Like the filters of HT_CreateFileWithFilter, they keep the rate up to 4096 * ln(2)^2 / -ln(rate) names per bucket
+// Return 0 if successfull, -1 if failure
+int SHT_CreateSecondaryIndexWithFilter(char *sfileName, int buckets, char* fileName, double falsePositiveRate);
+
 /* Η συνάρτηση SHT_OpenSecondaryIndex ανοίγει το αρχείο με όνομα sfileName
 και διαβάζει από το πρώτο μπλοκ την πληροφορία που αφορά το δευτερεύον
 ευρετήριο κατακερματισμού.*/
 
 // Opens the file named sfilename and reads from the first  
 // block the information about the secondary hashtable file
+// The header in block 0 is decoded into an SHT_info of its own and block 0 is unpinned, SHT_CloseSecondaryIndex writes it back
 SHT_info* SHT_OpenSecondaryIndex(char *sfileName);
 
+// Decodes data, block 0 of a secondary hashtable file, into an SHT_info of its own (free it with free), with room for the table of any rehash
+// Return NULL if data is not the header of a secondary hashtable file or has a version this build does not read
+SHT_info* SHT_DecodeHeader(const char* data);
+
+// Same as SHT_OpenSecondaryIndex but the file is memory mapped read only (see bf_mapped.h)
+// SHT_SecondaryGetAllEntries reads the blocks straight from the mapping, SHT_SecondaryInsertEntry fails
+// In case of an error then it returns NULL
+SHT_info* SHT_OpenSecondaryIndexMapped(char *sfileName);
+
+// Same as SHT_OpenSecondaryIndex but the file is opened in env (see bf_env.h), closed by BF_EnvDestroy if still open
+// In case of an error then it returns NULL
+SHT_info* SHT_OpenSecondaryIndexEnv(BF_Env* env, char *sfileName);
+
 // Closes the file specified in in the header_info structure
 // The function is is also responsible for freeing the memory occupied
 // by the structure passed as a parameter, in case the closure was successfully performed
@@ -52,6 +84,13 @@ int SHT_CloseSecondaryIndex(SHT_info* header_info);
 // Return 0 if successfull, -1 if failure
 int SHT_SecondaryInsertEntry(SHT_info* header_info, Record record, int block_id);
 
+// Adds an entry for every record of the hashtable file, for an index that has none of them yet (e.g. a new one)
+// threads workers take the data blocks in morsels and partition the names by bucket, then every bucket is written
+// in full blocks with consecutive numbers. The blocks are still read one at a time through the BF layer, only the
+// partitioning and the packing of the buckets run in parallel. Inserts and lookups of both files wait until it is done
+// Return the number of entries added if successfull, -1 if failure
+int SHT_BuildFromPrimary(HT_info* ht_info, SHT_info* header_info, int threads);
+
 // Print all records that exist in the hashtable file that have a value in key field equal to name
 // The first structure gives information about the hashtable and the second gives information about the secondary hashtable
 // For each record that exists in the file and has a value in the id field equal to value, print it
@@ -59,4 +98,10 @@ int SHT_SecondaryInsertEntry(SHT_info* header_info, Record record, int block_id)
 // Return the number of readed blocks if successfull, -1 if failure
 int SHT_SecondaryGetAllEntries(HT_info* ht_info, SHT_info* header_info, char* name);
 
+// Same as HT_SetSkewThreshold for the secondary indexes, rehashing an index is safe, its entries keep pointing to the same blocks
+void SHT_SetSkewThreshold(double threshold);
+
+// Same as HT_Skew for a secondary index
+double SHT_Skew(SHT_info* header_info);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+// Trace points on the blocks of the BF layer and on the public HP_, HT_ and SHT_ functions, kept in an in memory
+// ring of events with nanosecond timestamps. They exist only in programs built with -DBF_TRACE (and modules/trace.c),
+// otherwise every macro is empty and nothing is linked. ./build/trace_main turns a dumped log into a Chrome trace
+// (chrome://tracing or ui.perfetto.dev)
+// libbf has no hooks, so trace.c interposes BF_OpenFile, BF_AllocateBlock, BF_GetBlock, BF_UnpinBlock and
+// BF_CloseFile, and the read() and write() calls libbf makes. A write made to free a frame for a pin is an evict,
+// clean blocks are dropped by libbf without a call and are not seen
+
+#define TRACE_DEFAULT_EVENTS (1 << 20)    // Events kept by TRACE_START(0), the oldest are overwritten
+
+typedef enum TRACE_Type{
+  TRACE_ENTER,      // Entry and exit of a public function, name is the function
+  TRACE_EXIT,
+  TRACE_PIN,        // BF_GetBlock or BF_AllocateBlock
+  TRACE_UNPIN,
+  TRACE_EVICT,      // A dirty block written back by libbf to make room for a pin
+  TRACE_READ,       // A block read from the file (by libbf or by the prefetcher)
+  TRACE_WRITE       // A block written to the file (by libbf on close or by the flusher)
+}TRACE_Type;
+
+#define TRACE_TYPES 7
+
+extern const char* TRACE_TypeNames[TRACE_TYPES];    // "enter", "exit", "pin", ..., the names used in the log
+
+#ifdef BF_TRACE
+
+typedef const char* TRACE_Scope;
+
+// Starts keeping events in a ring of events events (TRACE_DEFAULT_EVENTS if 0), restarts it if it was started
+// Return 0 if successfull, -1 if failure
+int TRACE_Start(long events);
+
+// Writes the events kept so far, oldest first, one per line: "time thread type file block name" (see trace_main.c)
+// Should be called while no other thread records events
+// Return 0 if successfull, -1 if failure
+int TRACE_Dump(const char* filename);
+
+// Stops keeping events and frees the ring
+void TRACE_Stop(void);
+
+void TRACE_Record(TRACE_Type type, const char* name, int file_desc, int block_num);
+
+TRACE_Scope TRACE_Enter(const char* name);
+void TRACE_Leave(TRACE_Scope* scope);
+
+// First statement of a traced function, its exit is recorded on every return
+#define TRACE_FUNCTION() TRACE_Scope traceScope __attribute__((cleanup(TRACE_Leave), unused)) = TRACE_Enter(__func__)
+#define TRACE_PAGE(type, file_desc, block_num) TRACE_Record(type, 0, file_desc, block_num)
+#define TRACE_START(events) TRACE_Start(events)
+#define TRACE_DUMP(filename) TRACE_Dump(filename)
+#define TRACE_STOP() TRACE_Stop()
+
+#else
+
+#define TRACE_FUNCTION() ((void) 0)
+#define TRACE_PAGE(type, file_desc, block_num) ((void) 0)
+#define TRACE_START(events) (-1)
+#define TRACE_DUMP(filename) (-1)
+#define TRACE_STOP() ((void) 0)
+
+#endif
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef WAL_H
+#define WAL_H
+
+// Write ahead log of the inserts, one log file (filename.wal) for every open data file
+// The access methods log a compact redo record before changing a block. The log is handed to the OS before
+// any other BF call, so a block can never reach the file before the log records of its changes
+// Redo records are idempotent, so after a crash the whole log is replayed on open and removed on a clean close
+
+#define WAL_GROUP_SIZE 512      // Records that share one fdatasync in WAL_GROUP mode
+#define WAL_BUFFER_SIZE 4096    // Bytes of records kept in memory before they are written
+
+typedef enum WAL_Mode{
+  WAL_NONE,     // No log, a crash can leave the header and the blocks out of sync
+  WAL_GROUP,    // Group commit, the log reaches the disk once every WAL_GROUP_SIZE records or on WAL_Commit
+  WAL_SYNC      // The log reaches the disk after every insert
+}WAL_Mode;
+
+// Applies one logged record to the file, context is what was passed to WAL_Replay
+typedef void (*WAL_Redo)(void* context, const void* payload, int length);
+
+// Chooses the mode for the files opened after this call (WAL_GROUP if never called)
+void WAL_SetMode(WAL_Mode mode);
+WAL_Mode WAL_GetMode(void);
+
+// Removes the log of filename if there is one, for a file that was just created
+void WAL_Discard(const char* filename);
+
+// Opens (or creates) the log of the file opened with BF_OpenFile as file_desc
+// Return 0 if successfull, -1 if failure
+int WAL_Attach(const char* filename, const int file_desc);
+
+// Calls redo for every complete record of the log, a torn record at the end (crash while writing) is dropped
+// Return the number of replayed records, -1 if failure
+int WAL_Replay(const int file_desc, WAL_Redo redo, void* context);
+
+// Adds a record to the log of file_desc (only in memory, see WAL_Write)
+void WAL_Log(const int file_desc, const void* payload, const int length);
+
+// Hands the logged records to the OS and makes them durable when the group is complete
+// Must be called after WAL_Log and before the next BF call
+// Return 0 if successfull, -1 if failure
+int WAL_Write(const int file_desc);
+
+// Makes every logged record of file_desc durable now
+// Return 0 if successfull, -1 if failure
+int WAL_Commit(const int file_desc);
+
+// Empties the log of file_desc, once a checkpoint has put every logged change in the data file
+// Return 0 if successfull, -1 if failure
+int WAL_Truncate(const int file_desc);
+
+// Syncs the data file, then closes and removes the log, must be called after BF_CloseFile wrote every block of the file
+// Return 0 if successfull, -1 if the data file could not be synced (the log is kept, the next open replays it)
+int WAL_Detach(const int file_desc);
+
+// Closes the log without removing it, when some blocks of the file could not be written
+// The next open of the file replays it
+void WAL_Close(const int file_desc);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <stdint.h>
+#include "record.h"
+
+// Synthetic Records for benchmarks, in place of randomRecord (rand(), a global id, not reproducible across threads)
+// A workload fixes the distribution of the ids and how many distinct names, surnames and cities there are. Records are
+// drawn from streams, each one a xoshiro256** generator seeded from the workload seed and its number, so the records of
+// stream i are the same whatever thread draws them and streams can be used by many threads at once (one each)
+
+#define WORKLOAD_MAX_CARDINALITY 10000    // Distinct values of a string attribute
+
+typedef enum WORKLOAD_Distribution{
+  WORKLOAD_SEQUENTIAL,    // Ids firstId, firstId + 1, ... split between the streams (stream i gets every streams-th id)
+  WORKLOAD_UNIFORM,       // Ids uniform in [0, keys)
+  WORKLOAD_ZIPF,          // Ids in [0, keys), id k drawn with probability proportional to 1 / (k + 1)^skew
+  WORKLOAD_DUPLICATES     // A fraction hotFraction of the records has one of hotKeys ids, the rest uniform in [0, keys)
+}WORKLOAD_Distribution;
+
+typedef struct{
+  WORKLOAD_Distribution distribution;
+  int keys;               // Range of the ids of the other distributions, [0, keys)
+  int firstId;            // First id of WORKLOAD_SEQUENTIAL
+  double skew;            // Zipf exponent, in (0, 1) (0.99 is the usual heavy skew)
+  int hotKeys;
+  double hotFraction;
+  int names;              // Distinct values of each string attribute, at most WORKLOAD_MAX_CARDINALITY
+  int surnames;
+  int cities;
+}WORKLOAD_Config;
+
+typedef struct WORKLOAD WORKLOAD;
+
+// One generator, owned by one thread
+typedef struct{
+  const WORKLOAD* workload;
+  uint64_t state[4];
+  long next;              // Next id of WORKLOAD_SEQUENTIAL
+  int step;
+}WORKLOAD_Stream;
+
+// Return the workload if successfull, NULL if failure (a bad config)
+WORKLOAD* WORKLOAD_Create(const WORKLOAD_Config* config, uint64_t seed);
+void WORKLOAD_Destroy(WORKLOAD* workload);
+
+// Sets stream to the stream number of streams of workload (0 <= number < streams)
+void WORKLOAD_StreamInit(WORKLOAD_Stream* stream, const WORKLOAD* workload, int number, int streams);
+
+// Draws the next record of stream
+Record WORKLOAD_Next(WORKLOAD_Stream* stream);
+
+// Draws count records into records, the same records count calls of WORKLOAD_Next would give
+void WORKLOAD_Fill(WORKLOAD_Stream* stream, Record records[], int count);
+
+#endif
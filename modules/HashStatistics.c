@@ -16,76 +16,72 @@
   }                         \
 }
 
-/**** The two possible file we can have ****/
+/**** Sampling ****/
 
-static const char* secondaryString = "SHash file";
-static const char* hashtableString = "Hashtable file";
-
-/**** Offset functions  ****/
-
-static int HT_InfoOffset(void){
-  return strlen(hashtableString) + 1;
-}
-
-static int HT_MetadataOffset(HT_info* ht_info){
-  return ht_info->maxBlockRecs * sizeof(Record);
+static int HashStatistics_Compare(const void* first, const void* second){
+  return *(const int*) first - *(const int*) second;
 }
 
-static int SHT_InfoOffset(void){
-  return strlen(secondaryString) + 1;
-}
-
-static int SHT_MetadataOffset(SHT_info* sht_info){
-  return sht_info->maxBlockRecs * (sizeof(char) * 15 + sizeof(unsigned int));
+// The first count buckets of a shuffle of all of them (Fisher-Yates, stopped after count), sorted so the
+// counter blocks are read in order
+static void HashStatistics_Sample(int* sample, int buckets, int count, unsigned int seed){
+  for(int i = 0; i < buckets; i++){
+    sample[i] = i;
+  }
+  for(int i = 0; i < count; i++){
+    int j = i + rand_r(&seed) % (buckets - i);
+    int temp = sample[i];
+    sample[i] = sample[j];
+    sample[j] = temp;
+  }
+  qsort(sample, count, sizeof(int), HashStatistics_Compare);
 }
 
 /**** Stats functions ****/
 
 int HashStatistics(char* fileName){
+  return HashStatisticsSampled(fileName, 1.0, 0, 0);
+}
+
+int HashStatisticsSampled(char* fileName, double fraction, unsigned int seed, int json){
   int file;
   void* data;
   BF_Block* block;
 
+  if(fraction <= 0 || fraction > 1){
+    printf("The sampled fraction of the buckets must be in (0, 1].\n");
+    return -1;
+  }
+
   BF_Block_Init(&block);
   CALL_OR_DIE(BF_OpenFile(fileName, &file));
   CALL_OR_DIE(BF_GetBlock(file, 0, block));
   data = BF_Block_GetData(block);
 
-  int* hashTable;
-  int fileDesc = 0;
+  const char* type;
   int numBuckets = 0;
-  int lastBlockId = 0;
-  int maxBlockRecs = 0;
-  int metaDataOffset = 0;
+  int tableBlocks = 0;
+  int counterBlock = 0;
 
   /**** Checking what kind of file this is and initialize the values ****/
 
-  if(strcmp((char*) data, (char*) hashtableString) == 0){
-    HT_info* ht_info = data + HT_InfoOffset();
-    fileDesc = ht_info->fileDesc;
-    numBuckets = ht_info->numBuckets;
-    lastBlockId = ht_info->lastBlockId;
-    maxBlockRecs = ht_info->maxBlockRecs;
-    metaDataOffset = HT_MetadataOffset(ht_info);
+  HT_info* ht_info = HT_DecodeHeader(data);
+  SHT_info* sht_info = ht_info == NULL ? SHT_DecodeHeader(data) : NULL;
 
-    hashTable = (int*) malloc(sizeof(int) * numBuckets);
-    for(int i = 0; i < numBuckets; i++){
-      hashTable[i] = ht_info->hashTable[i];
-    }
+  if(ht_info != NULL){
+    type = "hashtable";
+    numBuckets = ht_info->numBuckets;
+    tableBlocks = ht_info->tableBlocks;
+    counterBlock = ht_info->counterBlock;
+    free(ht_info);
 
     CALL_OR_DIE(BF_UnpinBlock(block));
-  }else if(strcmp((char*) data, (char*) secondaryString) == 0){
-    SHT_info* sht_info = data + SHT_InfoOffset();
-    fileDesc = sht_info->fileDesc;
+  }else if(sht_info != NULL){
+    type = "secondary hashtable";
     numBuckets = sht_info->numBuckets;
-    lastBlockId = sht_info->lastBlockId;
-    maxBlockRecs = sht_info->maxBlockRecs;
-    metaDataOffset = SHT_MetadataOffset(sht_info);
-    
-    hashTable = (int*) malloc(sizeof(int) * numBuckets);
-    for(int i = 0; i < numBuckets; i++){
-      hashTable[i] = sht_info->hashTable[i];
-    }
+    tableBlocks = sht_info->tableBlocks;
+    counterBlock = sht_info->counterBlock;
+    free(sht_info);
 
     CALL_OR_DIE(BF_UnpinBlock(block));
   }else{
@@ -93,116 +89,111 @@ int HashStatistics(char* fileName){
 
     CALL_OR_DIE(BF_UnpinBlock(block));
     BF_Block_Destroy(&block);
+    CALL_OR_DIE(BF_CloseFile(file));
 
     return -1;
   }
 
   CALL_OR_DIE(BF_UnpinBlock(block));  // For not having memory leaks
 
-  int overFlow = 0;
-  int totalOverFlow = 0;
-
-  int maximumRecs = 0;
-  double averageRecs = 0;
-  int minimumRecs = maxBlockRecs * lastBlockId; // Taking a very high value for the first time
-
-  int maximumTemp = 0;
-  int minimumTemp = 0;
-  
-  double averageBlockNumber = 0;
-
-  /**** Minimum-Maximum-Average records per bucket ****/
-
-  for(int i = 0; i < numBuckets; i++){
-    if(hashTable[i] != -1){   // The hashtable must have a value
-
-      int temp = hashTable[i];
-      CALL_OR_DIE(BF_GetBlock(file, temp, block));
+  if(numBuckets < 1){
+    printf("Can not sample %.2f of the %d buckets.\n", fraction, numBuckets);
+    BF_Block_Destroy(&block);
+    CALL_OR_DIE(BF_CloseFile(file));
+    return -1;
+  }
 
-      maximumTemp = 0;  // Set our temp variable  
-      minimumTemp = 0;  // to 0 for every bucket
+  int sampled = (int) (fraction * numBuckets);
+  if(sampled < fraction * numBuckets || sampled == 0){
+    sampled++;
+  }
 
-      while(1){
-        data = BF_Block_GetData(block);
+  int* sample = malloc(sizeof(int) * numBuckets);
+  HT_bucket_counters* counters = calloc(sampled, sizeof(HT_bucket_counters));   // Every one is read below, 1 <= sampled <= numBuckets
+  if(sample == NULL || counters == NULL){
+    free(sample);
+    free(counters);
+    BF_Block_Destroy(&block);
+    CALL_OR_DIE(BF_CloseFile(file));
+    return -1;
+  }
+  HashStatistics_Sample(sample, numBuckets, sampled, seed);
 
-        HT_block_info* block_info = data + metaDataOffset;
+  /**** The counters of the sampled buckets, every counter block is read once ****/
 
-        averageRecs += block_info->recNumber;
-        minimumTemp += block_info->recNumber;
-        maximumTemp += block_info->recNumber;
-        
+  int current = -1;
+  for(int i = 0; i < sampled; i++){
+    int wanted = counterBlock + sample[i] / HT_COUNTERS_PER_BLOCK;
+    if(wanted != current){
+      if(current != -1){
         CALL_OR_DIE(BF_UnpinBlock(block));
-
-        if(block_info->hashBucket == -1){
-          break;
-        }
-
-        temp = block_info->hashBucket;
-        CALL_OR_DIE(BF_GetBlock(fileDesc, temp, block));
       }
+      CALL_OR_DIE(BF_GetBlock(file, wanted, block));
+      current = wanted;
     }
-
-    if(maximumTemp > maximumRecs){
-      maximumRecs = maximumTemp;  // Keeping the maximum 
-    }
-    if(minimumTemp < minimumRecs){
-      minimumRecs = minimumTemp;  // Keeping the minimum
-    }
+    counters[i] = ((HT_bucket_counters*) BF_Block_GetData(block))[sample[i] % HT_COUNTERS_PER_BLOCK];
+  }
+  if(current != -1){
+    CALL_OR_DIE(BF_UnpinBlock(block));
   }
-  averageRecs = (double) averageRecs/numBuckets;
-
-  /**** Overflow calculation *****/
 
-  for(int i = 0; i < numBuckets; i++){
-    overFlow = 0;
+  /**** Minimum-Maximum-Average records per bucket and overflow ****/
 
-    int temp = hashTable[i];
+  int maximumRecs = 0;
+  double averageRecs = 0;
+  int minimumRecs = counters[0].records;
+  int totalOverFlow = 0;
 
-    if(temp == -1){
-      continue;  // Need to check if the block exists
+  for(int i = 0; i < sampled; i++){
+    averageRecs += counters[i].records;
+    if(counters[i].records > maximumRecs){
+      maximumRecs = counters[i].records;  // Keeping the maximum
     }
-
-    CALL_OR_DIE(BF_GetBlock(file, temp, block));
-    data = BF_Block_GetData(block);
-
-    HT_block_info* block_info = data + metaDataOffset;
-
-    if(block_info->hashBucket != -1){
+    if(counters[i].records < minimumRecs){
+      minimumRecs = counters[i].records;  // Keeping the minimum
+    }
+    if(counters[i].blocks > 1){
       totalOverFlow++;
     }
-
-    /**** Overflow calculation for every block ****/
-
-    while(1){
-      data = BF_Block_GetData(block);
-
-      HT_block_info* block_info = data + metaDataOffset;
-
-      overFlow++;
-
-      CALL_OR_DIE(BF_UnpinBlock(block));
-
-      if(block_info->hashBucket == -1){
-        break;
+  }
+  averageRecs = (double) averageRecs/sampled;
+  totalOverFlow = (int) ((double) totalOverFlow * numBuckets / sampled + 0.5);   // All the buckets, if this was a sample
+
+  double averageBlockNumber = (double) (tableBlocks - 1)/numBuckets;
+  double skew = averageRecs > 0 ? maximumRecs / averageRecs : 0;    // 1 when the records are spread evenly
+
+  if(json){
+    printf("{\"file\": \"%s\", \"type\": \"%s\", \"buckets\": %d, \"sampled_buckets\": %d, \"blocks\": %d, "
+           "\"minimum_records\": %d, \"maximum_records\": %d, \"average_records\": %.2f, \"overflow_buckets\": %d, "
+           "\"average_blocks\": %.2f, \"skew\": %.2f, \"sample\": [",
+           fileName, type, numBuckets, sampled, tableBlocks, minimumRecs, maximumRecs, averageRecs, totalOverFlow,
+           averageBlockNumber, skew);
+    for(int i = 0; i < sampled; i++){
+      printf("%s{\"bucket\": %d, \"records\": %d, \"blocks\": %d}", i > 0 ? ", " : "", sample[i], counters[i].records, counters[i].blocks);
+    }
+    printf("]}\n");
+  }else{
+    for(int i = 0; i < sampled; i++){
+      if(counters[i].blocks > 0){
+        printf("Bucket %d has overflown by %d blocks\n", sample[i], counters[i].blocks - 1);
       }
+    }
 
-      temp = block_info->hashBucket;
-      CALL_OR_DIE(BF_GetBlock(fileDesc, temp, block));
+    printf("This file has : %d blocks\n", tableBlocks);
+    printf("The minimum amount of records a bucket has : %d\n", minimumRecs);
+    printf("The maximum amount of records a bucket has : %d\n", maximumRecs);
+    printf("The average amount of records a bucket has : %.2f\n", averageRecs);
+    printf("The total amount of blocks with overflow   : %d\n", totalOverFlow);
+    printf("The average amount of blocks a bucket has  : %.2f\n", averageBlockNumber);
+    if(sampled < numBuckets){
+      printf("Estimated from %d of the %d buckets, skew (maximum / average records) : %.2f\n", sampled, numBuckets, skew);
     }
-    printf("Bucket %d has overflown by %d blocks\n", i, overFlow - 1);
   }
 
-  averageBlockNumber = (double) (lastBlockId - 1)/numBuckets;
-  
-  printf("This file has : %d blocks\n", lastBlockId);
-  printf("The minimum amount of records a bucket has : %d\n", minimumRecs);
-  printf("The maximum amount of records a bucket has : %d\n", maximumRecs);
-  printf("The average amount of records a bucket has : %.2f\n", averageRecs);
-  printf("The total amount of blocks with overflow   : %d\n", totalOverFlow);
-  printf("The average amount of blocks a bucket has  : %.2f\n", averageBlockNumber);
-
-  free(hashTable);
+  free(sample);
+  free(counters);
   BF_Block_Destroy(&block);
+  CALL_OR_DIE(BF_CloseFile(file));
 
   return HT_OK;
-}
\ No newline at end of file
+}
@@ -0,0 +1,322 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "record.h"
+#include "predicate.h"
+#include "hp_file.h"
+#include "ht_table.h"
+#include "batch.h"
+
+typedef int (*BATCH_Scan)(void* info, Record_PageVisitor visitor, void* context);
+
+struct BATCH_Pipeline{
+  BATCH_Stage stages[BATCH_MAX_STAGES];
+  void* states[BATCH_MAX_STAGES];
+  int owned[BATCH_MAX_STAGES];      // The state was allocated here and is freed by BATCH_Destroy
+  int count;
+  int pushed;                       // Leading filter stages, they run on the pages of the scan
+  BATCH_Vector* batch;
+  BATCH_Stage sink;
+  void* context;
+  long rows;                        // Rows that reached the sink
+};
+
+typedef struct{
+  int offset;         // Of the attribute in a Record
+  int size;           // Of the attribute, a value this long has no '\0'
+  int length;
+  char value[sizeof(((Record*) 0)->surname) + 1];   // The longest string attribute
+}BATCH_Match;
+
+typedef struct{
+  Record_Attribute attributes[BATCH_MAX_COLUMNS];
+  int count;
+}BATCH_Project;
+
+/**** Built in stages ****/
+
+// Offset and size of an attribute inside a Record, so the stages read it without a call per row
+static int BATCH_Field(Record_Attribute attribute, int* size){
+  switch(attribute){
+    case ID:
+      *size = sizeof(((Record*) 0)->id);
+      return offsetof(Record, id);
+    case NAME:
+      *size = sizeof(((Record*) 0)->name);
+      return offsetof(Record, name);
+    case SURNAME:
+      *size = sizeof(((Record*) 0)->surname);
+      return offsetof(Record, surname);
+    default:
+      *size = sizeof(((Record*) 0)->city);
+      return offsetof(Record, city);
+  }
+}
+
+/* The filters shrink a selection over rows, which are the rows of a batch or of a page still pinned by the scan */
+
+static int BATCH_FilterRows(const Predicate* predicate, const Record* rows, int count, unsigned short selection[], int selected){
+  int kept = 0;
+
+  if(count < PRED_MAX_SLOTS){   // A later filter on a page, only the few rows still selected are checked
+    for(int i = 0; i < selected; i++){
+      if(PRED_Check(rows[selection[i]].id, predicate)){
+        selection[kept++] = selection[i];
+      }
+    }
+    return kept;
+  }
+
+  // Every row is checked, not only the selected ones, so the kernel reads slots at a fixed stride
+  unsigned int masks[BATCH_SIZE / PRED_MAX_SLOTS];
+  for(int first = 0; first < count; first += PRED_MAX_SLOTS){
+    masks[first / PRED_MAX_SLOTS] = PRED_EvaluatePage(&rows[first], count - first, sizeof(Record), offsetof(Record, id), predicate);
+  }
+
+  for(int i = 0; i < selected; i++){
+    int row = selection[i];
+    if(masks[row / PRED_MAX_SLOTS] & (1u << (row % PRED_MAX_SLOTS))){
+      selection[kept++] = row;
+    }
+  }
+
+  return kept;
+}
+
+static int BATCH_EqualRows(const BATCH_Match* match, const Record* rows, unsigned short selection[], int selected){
+  int kept = 0;
+
+  for(int i = 0; i < selected; i++){
+    const char* field = (const char*) &rows[selection[i]] + match->offset;
+    if(memcmp(field, match->value, match->length) == 0 && (match->length == match->size || field[match->length] == '\0')){
+      selection[kept++] = selection[i];
+    }
+  }
+
+  return kept;
+}
+
+static void BATCH_Filter(void* state, BATCH_Vector* batch){
+  batch->selected = BATCH_FilterRows(state, batch->rows, batch->count, batch->selection, batch->selected);
+}
+
+static void BATCH_Equal(void* state, BATCH_Vector* batch){
+  batch->selected = BATCH_EqualRows(state, batch->rows, batch->selection, batch->selected);
+}
+
+static void BATCH_Columns(void* state, BATCH_Vector* batch){
+  const BATCH_Project* project = state;
+
+  for(int c = 0; c < project->count; c++){
+    int size;
+    int offset = BATCH_Field(project->attributes[c], &size);
+    for(int i = 0; i < batch->selected; i++){
+      int row = batch->selection[i];   // By row, so the columns still match the rows after a filter shrinks the selection
+      batch->columns[c][row] = (const char*) &batch->rows[row] + offset;
+    }
+  }
+  batch->columnCount = project->count;
+}
+
+/**** Execution ****/
+
+static void BATCH_Flush(BATCH_Pipeline* pipeline){
+  BATCH_Vector* batch = pipeline->batch;
+
+  if(batch->count == 0){
+    return;
+  }
+
+  for(int i = 0; i < batch->count; i++){
+    batch->selection[i] = i;
+  }
+  batch->selected = batch->count;
+  batch->columnCount = 0;
+
+  for(int i = pipeline->pushed; i < pipeline->count && batch->selected > 0; i++){
+    pipeline->stages[i](pipeline->states[i], batch);
+  }
+
+  if(batch->selected > 0){
+    pipeline->sink(pipeline->context, batch);
+    pipeline->rows += batch->selected;
+  }
+  batch->count = 0;
+}
+
+// The leading filters run on the page while it is pinned, only the rows they keep are copied to the batch
+static void BATCH_Page(void* context, const Record* records, int count){
+  BATCH_Pipeline* pipeline = context;
+  BATCH_Vector* batch = pipeline->batch;
+  unsigned short selection[BATCH_SIZE];
+
+  if(count > BATCH_SIZE){
+    count = BATCH_SIZE;
+  }
+
+  // A leading id filter checks the whole page with one kernel call and its mask is the selection
+  int selected = 0;
+  int first = 0;
+  if(pipeline->pushed > 0 && pipeline->stages[0] == BATCH_Filter && count <= PRED_MAX_SLOTS){
+    unsigned int mask = PRED_EvaluatePage(records, count, sizeof(Record), offsetof(Record, id), pipeline->states[0]);
+    for(; mask != 0; mask &= mask - 1){
+      selection[selected++] = __builtin_ctz(mask);
+    }
+    first = 1;
+  }else{
+    for(; selected < count; selected++){
+      selection[selected] = selected;
+    }
+  }
+
+  for(int i = first; i < pipeline->pushed && selected > 0; i++){
+    if(pipeline->stages[i] == BATCH_Filter){
+      selected = BATCH_FilterRows(pipeline->states[i], records, count, selection, selected);
+    }else{
+      selected = BATCH_EqualRows(pipeline->states[i], records, selection, selected);
+    }
+  }
+
+  if(batch->count + selected > BATCH_SIZE){
+    BATCH_Flush(pipeline);
+  }
+
+  if(selected == count){
+    memcpy(&batch->rows[batch->count], records, count * sizeof(Record));   // The whole page at once
+  }else{
+    for(int i = 0; i < selected; i++){
+      batch->rows[batch->count + i] = records[selection[i]];
+    }
+  }
+  batch->count += selected;
+}
+
+static long BATCH_Run(BATCH_Pipeline* pipeline, void* info, BATCH_Scan scan, BATCH_Stage sink, void* context){
+  pipeline->sink = sink;
+  pipeline->context = context;
+  pipeline->rows = 0;
+  pipeline->batch->count = 0;
+
+  pipeline->pushed = 0;
+  while(pipeline->pushed < pipeline->count &&
+        (pipeline->stages[pipeline->pushed] == BATCH_Filter || pipeline->stages[pipeline->pushed] == BATCH_Equal)){
+    pipeline->pushed++;
+  }
+
+  if(scan(info, BATCH_Page, pipeline) < 0){
+    return -1;
+  }
+  BATCH_Flush(pipeline);
+
+  return pipeline->rows;
+}
+
+static int BATCH_ScanHeap(void* info, Record_PageVisitor visitor, void* context){
+  return HP_ScanPages(info, visitor, context);
+}
+
+static int BATCH_ScanHashtable(void* info, Record_PageVisitor visitor, void* context){
+  return HT_ScanPages(info, visitor, context);
+}
+
+/**** Pipeline functions ****/
+
+BATCH_Pipeline* BATCH_Create(void){
+  BATCH_Pipeline* pipeline = malloc(sizeof(BATCH_Pipeline));
+  if(pipeline == NULL){
+    return NULL;
+  }
+
+  pipeline->count = 0;
+  if((pipeline->batch = malloc(sizeof(BATCH_Vector))) == NULL){
+    free(pipeline);
+    return NULL;
+  }
+
+  return pipeline;
+}
+
+void BATCH_Destroy(BATCH_Pipeline* pipeline){
+  for(int i = 0; i < pipeline->count; i++){
+    if(pipeline->owned[i]){
+      free(pipeline->states[i]);
+    }
+  }
+  free(pipeline->batch);
+  free(pipeline);
+}
+
+static int BATCH_Add(BATCH_Pipeline* pipeline, BATCH_Stage stage, void* state, int owned){
+  if(pipeline->count == BATCH_MAX_STAGES){
+    if(owned){
+      free(state);
+    }
+    return -1;
+  }
+
+  pipeline->stages[pipeline->count] = stage;
+  pipeline->states[pipeline->count] = state;
+  pipeline->owned[pipeline->count++] = owned;
+
+  return 0;
+}
+
+int BATCH_AddStage(BATCH_Pipeline* pipeline, BATCH_Stage stage, void* state){
+  return BATCH_Add(pipeline, stage, state, 0);
+}
+
+int BATCH_AddFilter(BATCH_Pipeline* pipeline, Predicate predicate){
+  Predicate* state = malloc(sizeof(Predicate));
+  if(state == NULL){
+    return -1;
+  }
+
+  *state = predicate;
+
+  return BATCH_Add(pipeline, BATCH_Filter, state, 1);
+}
+
+int BATCH_AddMatch(BATCH_Pipeline* pipeline, Record_Attribute attribute, const char* value){
+  int size;
+  BATCH_Field(attribute, &size);
+  if(attribute == ID || strlen(value) > (size_t) size){
+    return -1;
+  }
+
+  BATCH_Match* state = malloc(sizeof(BATCH_Match));
+  if(state == NULL){
+    return -1;
+  }
+
+  state->offset = BATCH_Field(attribute, &state->size);
+  state->length = strlen(value);
+  strcpy(state->value, value);
+
+  return BATCH_Add(pipeline, BATCH_Equal, state, 1);
+}
+
+int BATCH_AddProject(BATCH_Pipeline* pipeline, const Record_Attribute attributes[], int count){
+  if(count < 1 || count > BATCH_MAX_COLUMNS){
+    return -1;
+  }
+
+  BATCH_Project* state = malloc(sizeof(BATCH_Project));
+  if(state == NULL){
+    return -1;
+  }
+
+  memcpy(state->attributes, attributes, count * sizeof(Record_Attribute));
+  state->count = count;
+
+  return BATCH_Add(pipeline, BATCH_Columns, state, 1);
+}
+
+long BATCH_RunHeap(BATCH_Pipeline* pipeline, HP_info* header_info, BATCH_Stage sink, void* context){
+  return BATCH_Run(pipeline, header_info, BATCH_ScanHeap, sink, context);
+}
+
+long BATCH_RunHashtable(BATCH_Pipeline* pipeline, HT_info* header_info, BATCH_Stage sink, void* context){
+  return BATCH_Run(pipeline, header_info, BATCH_ScanHashtable, sink, context);
+}
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#include "bf.h"
+#include "bf_mapped.h"
+#include "bf_checksum.h"
+
+#define BF_CHECKSUM_FILES (BF_MAPPED_FILE_BASE + BF_MAX_OPEN_FILES)   // File descriptors of the BF layer, then the mapped ones
+#define BF_CRC32C_POLY 0x82f63b78u                                  // Castagnoli, reflected
+
+typedef struct{
+  BF_ChecksumBlocks blocks;     // NULL if the file has no checksums
+  void* context;
+  int strict;                   // Every data block has a checksum, so 0 is not taken for none
+}BF_ChecksumFile;
+
+static BF_ChecksumFile files[BF_CHECKSUM_FILES];
+static int enabled = 1;
+
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static unsigned int table[256];
+static unsigned int (*crc32c)(unsigned int, const unsigned char*, size_t) = NULL;
+static const char* path = "software";
+
+/**** CRC32C ****/
+
+static unsigned int BF_Crc32cSoftware(unsigned int crc, const unsigned char* data, size_t length){
+  while(length-- > 0){
+    crc = table[(crc ^ *data++) & 0xff] ^ (crc >> 8);
+  }
+
+  return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static unsigned int BF_Crc32cSse42(unsigned int crc, const unsigned char* data, size_t length){
+  uint64_t crc64 = crc;
+
+  for(; length >= 8; data += 8, length -= 8){
+    uint64_t word;
+    memcpy(&word, data, 8);
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  crc = (unsigned int) crc64;
+  for(; length > 0; data++, length--){
+    crc = _mm_crc32_u8(crc, *data);
+  }
+
+  return crc;
+}
+#elif defined(__aarch64__)
+__attribute__((target("+crc")))
+static unsigned int BF_Crc32cArmv8(unsigned int crc, const unsigned char* data, size_t length){
+  for(; length >= 8; data += 8, length -= 8){
+    uint64_t word;
+    memcpy(&word, data, 8);
+    crc = __crc32cd(crc, word);
+  }
+  for(; length > 0; data++, length--){
+    crc = __crc32cb(crc, *data);
+  }
+
+  return crc;
+}
+#endif
+
+// The table of the software path, and the fastest path this CPU has
+static void BF_Crc32cInit(void){
+  for(unsigned int i = 0; i < 256; i++){
+    unsigned int crc = i;
+    for(int bit = 0; bit < 8; bit++){
+      crc = crc & 1 ? (crc >> 1) ^ BF_CRC32C_POLY : crc >> 1;
+    }
+    table[i] = crc;
+  }
+  crc32c = BF_Crc32cSoftware;
+
+#if defined(__x86_64__)
+  if(__builtin_cpu_supports("sse4.2")){
+    crc32c = BF_Crc32cSse42;
+    path = "sse4.2";
+  }
+#elif defined(__aarch64__)
+  if(getauxval(AT_HWCAP) & HWCAP_CRC32){
+    crc32c = BF_Crc32cArmv8;
+    path = "armv8";
+  }
+#endif
+}
+
+unsigned int BF_Crc32c(unsigned int crc, const void* data, size_t length){
+  pthread_once(&once, BF_Crc32cInit);
+
+  return ~crc32c(~crc, data, length);
+}
+
+const char* BF_Crc32cPath(void){
+  pthread_once(&once, BF_Crc32cInit);
+
+  return path;
+}
+
+/**** Block checksums ****/
+
+static BF_ChecksumFile* BF_ChecksumFileOf(int file_desc, int block_num){
+  if(file_desc < 0 || file_desc >= BF_CHECKSUM_FILES || files[file_desc].blocks == NULL){
+    return NULL;
+  }
+  if(!files[file_desc].blocks(files[file_desc].context, block_num)){
+    return NULL;
+  }
+
+  return &files[file_desc];
+}
+
+// 0 is kept for the blocks without a checksum, a block whose checksum is 0 gets 1 instead
+static unsigned int BF_ChecksumOf(const char* data){
+  unsigned int checksum = BF_Crc32c(0, data, BF_CHECKSUM_OFFSET);
+
+  return checksum != 0 ? checksum : 1;
+}
+
+void BF_ChecksumSetEnabled(const int on){
+  enabled = on;
+}
+
+int BF_ChecksumEnabled(void){
+  return enabled;
+}
+
+void BF_ChecksumAttach(const int file_desc, BF_ChecksumBlocks blocks, void* context, const int strict){
+  if(file_desc >= 0 && file_desc < BF_CHECKSUM_FILES){
+    files[file_desc].blocks = blocks;
+    files[file_desc].context = context;
+    files[file_desc].strict = strict;
+  }
+}
+
+void BF_ChecksumDetach(const int file_desc){
+  if(file_desc >= 0 && file_desc < BF_CHECKSUM_FILES){
+    files[file_desc].blocks = NULL;
+  }
+}
+
+void BF_ChecksumSeal(const int file_desc, const int block_num, char* data){
+  BF_ChecksumFile* file = BF_ChecksumFileOf(file_desc, block_num);
+  if(file == NULL){
+    return;
+  }
+
+  // With checksums off a stale one must not stay behind, but a strict file keeps them so it can be checked again
+  unsigned int checksum = enabled || file->strict ? BF_ChecksumOf(data) : 0;
+  memcpy(data + BF_CHECKSUM_OFFSET, &checksum, sizeof(checksum));
+}
+
+void BF_ChecksumSealReused(const int file_desc, char* data){
+  if(file_desc < 0 || file_desc >= BF_CHECKSUM_FILES || files[file_desc].blocks == NULL){
+    return;
+  }
+
+  unsigned int checksum = enabled || files[file_desc].strict ? BF_ChecksumOf(data) : 0;
+  memcpy(data + BF_CHECKSUM_OFFSET, &checksum, sizeof(checksum));
+}
+
+int BF_ChecksumVerify(const int file_desc, const int block_num, const char* data){
+  unsigned int stored;
+
+  BF_ChecksumFile* file = BF_ChecksumFileOf(file_desc, block_num);
+  if(!enabled || file == NULL){
+    return 0;
+  }
+
+  memcpy(&stored, data + BF_CHECKSUM_OFFSET, sizeof(stored));
+  if((stored == 0 && !file->strict) || stored == BF_ChecksumOf(data)){   // A torn write may leave 0 at the end of a block
+    return 0;
+  }
+
+  fprintf(stderr, "Checksum mismatch in block %d of file %d, the block is torn or corrupted.\n", block_num, file_desc);
+
+  return -1;
+}
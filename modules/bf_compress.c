@@ -0,0 +1,177 @@
+#include <string.h>
+#include <stdint.h>
+
+#include "bf_compress.h"
+
+#define BF_LZ_HASH_BITS 12
+#define BF_LZ_MIN_MATCH 4
+#define BF_LZ_LAST_LITERALS 5     // The format ends with at least 5 literals
+#define BF_LZ_MATCH_LIMIT 12      // and no match starts in the last 12 bytes
+#define BF_LZ_MAX_OFFSET 65535
+#define BF_LZ_MAX_LENGTH (1 << 24)
+
+static unsigned int BF_LzRead32(const char* data){
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+static int BF_LzHash(unsigned int sequence){
+  return (int) ((sequence * 2654435761u) >> (32 - BF_LZ_HASH_BITS));
+}
+
+/**** Compression ****/
+
+// The part of a length past its nibble of 15, in bytes of 255 and the rest
+static int BF_LzPutLength(char* destination, int o, const int capacity, int length){
+  for(; length >= 255; length -= 255){
+    if(o >= capacity){
+      return -1;
+    }
+    destination[o++] = (char) 255;
+  }
+  if(o >= capacity){
+    return -1;
+  }
+  destination[o++] = (char) length;
+
+  return o;
+}
+
+// One sequence at o, match 0 for the last one (only literals). Return where the next one starts, -1 if it does not fit
+static int BF_LzSequence(char* destination, int o, const int capacity, const char* literals, const int literalLength, const int offset, int match){
+  if(o >= capacity){
+    return -1;
+  }
+  int token = o++;
+  destination[token] = (char) ((literalLength < 15 ? literalLength : 15) << 4);
+  if(literalLength >= 15 && (o = BF_LzPutLength(destination, o, capacity, literalLength - 15)) < 0){
+    return -1;
+  }
+
+  if(literalLength > capacity - o){
+    return -1;
+  }
+  memcpy(destination + o, literals, literalLength);
+  o += literalLength;
+
+  if(match == 0){
+    return o;
+  }
+
+  if(capacity - o < 2){
+    return -1;
+  }
+  destination[o++] = (char) (offset & 0xff);
+  destination[o++] = (char) (offset >> 8);
+
+  match -= BF_LZ_MIN_MATCH;
+  destination[token] |= (char) (match < 15 ? match : 15);
+  if(match >= 15 && (o = BF_LzPutLength(destination, o, capacity, match - 15)) < 0){
+    return -1;
+  }
+
+  return o;
+}
+
+int BF_Compress(const char* source, const int length, char* destination, const int capacity){
+  int table[1 << BF_LZ_HASH_BITS];    // Last position of every hash of 4 bytes
+  int anchor = 0;                     // First byte not written yet
+  int o = 0;
+
+  for(int i = 0; i < (1 << BF_LZ_HASH_BITS); i++){
+    table[i] = -1;
+  }
+
+  for(int i = 0; i + BF_LZ_MATCH_LIMIT < length; ){
+    unsigned int sequence = BF_LzRead32(source + i);
+    int hash = BF_LzHash(sequence);
+    int candidate = table[hash];
+    table[hash] = i;
+
+    if(candidate < 0 || i - candidate > BF_LZ_MAX_OFFSET || BF_LzRead32(source + candidate) != sequence){
+      i++;
+      continue;
+    }
+
+    int match = BF_LZ_MIN_MATCH;
+    while(i + match < length - BF_LZ_LAST_LITERALS && source[candidate + match] == source[i + match]){
+      match++;
+    }
+
+    o = BF_LzSequence(destination, o, capacity, source + anchor, i - anchor, i - candidate, match);
+    if(o < 0){
+      return -1;
+    }
+    i += match;
+    anchor = i;
+    table[BF_LzHash(BF_LzRead32(source + i - 2))] = i - 2;   // The next record often repeats the end of this match
+  }
+
+  return BF_LzSequence(destination, o, capacity, source + anchor, length - anchor, 0, 0);
+}
+
+/**** Decompression ****/
+
+static int BF_LzGetLength(const unsigned char* source, int* i, const int length, int value){
+  int byte;
+
+  do{
+    if(*i >= length || value > BF_LZ_MAX_LENGTH){
+      return -1;
+    }
+    byte = source[(*i)++];
+    value += byte;
+  }while(byte == 255);
+
+  return value;
+}
+
+int BF_Decompress(const char* source, const int length, char* destination, const int capacity){
+  const unsigned char* bytes = (const unsigned char*) source;
+  int i = 0;
+  int o = 0;
+
+  while(i < length){
+    int token = bytes[i++];
+
+    int literals = token >> 4;
+    if(literals == 15 && (literals = BF_LzGetLength(bytes, &i, length, literals)) < 0){
+      return -1;
+    }
+    if(literals > length - i || literals > capacity - o){
+      return -1;
+    }
+    memcpy(destination + o, source + i, literals);
+    i += literals;
+    o += literals;
+
+    if(i == length){    // The last sequence has no match
+      return o;
+    }
+
+    if(length - i < 2){
+      return -1;
+    }
+    int offset = bytes[i] | bytes[i + 1] << 8;
+    i += 2;
+    if(offset == 0 || offset > o){
+      return -1;
+    }
+
+    int match = token & 15;
+    if(match == 15 && (match = BF_LzGetLength(bytes, &i, length, match)) < 0){
+      return -1;
+    }
+    match += BF_LZ_MIN_MATCH;
+    if(match > capacity - o){
+      return -1;
+    }
+
+    for(int k = 0; k < match; k++, o++){    // Byte by byte, a match may overlap what it copies (a run)
+      destination[o] = destination[o - offset];
+    }
+  }
+
+  return -1;    // A stream ends with literals
+}
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "bf.h"
+#include "bf_pool.h"
+#include "bf_env.h"
+
+typedef struct{
+  void* info;           // NULL if the slot is free
+  BF_EnvClose close;
+}BF_EnvFile;
+
+struct BF_Env{
+  char* name;           // Also the name of its pool
+  int blocks;
+  long opened;
+  BF_EnvFile files[BF_ENV_FILES];
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static BF_Env* envs[BF_ENV_MAX];
+static int count = 0;           // Envs that exist, the BF layer is initialized while it is not 0
+
+/**** Helpers (called with the lock held) ****/
+
+static int BF_EnvSlot(const BF_Env* env){
+  for(int i = 0; i < BF_ENV_MAX; i++){
+    if(envs[i] == env){
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+/**** Envs ****/
+
+BF_Env* BF_EnvCreate(const char* name, const int blocks, const ReplacementAlgorithm policy){
+  pthread_mutex_lock(&lock);
+
+  int slot = BF_EnvSlot(NULL);
+  if(slot == -1 || BF_PoolCreate(name, blocks, policy) != BF_OK){   // The pool fails for a name that is taken
+    pthread_mutex_unlock(&lock);
+    return NULL;
+  }
+
+  if(count == 0){
+    BF_ErrorCode code = BF_Init(LRU);
+    if(code != BF_OK){
+      BF_PoolDestroy(name);
+      pthread_mutex_unlock(&lock);
+      BF_PrintError(code);
+      return NULL;
+    }
+  }
+
+  BF_Env* env = calloc(1, sizeof(BF_Env));
+  env->name = strdup(name);
+  env->blocks = blocks;
+  envs[slot] = env;
+  count++;
+
+  pthread_mutex_unlock(&lock);
+
+  return env;
+}
+
+BF_ErrorCode BF_EnvDestroy(BF_Env* env){
+  BF_EnvFile files[BF_ENV_FILES];
+  BF_ErrorCode code = BF_OK;
+
+  pthread_mutex_lock(&lock);
+  int slot = BF_EnvSlot(env);
+  if(slot == -1){
+    pthread_mutex_unlock(&lock);
+    return BF_ERROR;
+  }
+  memcpy(files, env->files, sizeof(files));   // Closed without the lock, the close functions remove them
+  memset(env->files, 0, sizeof(env->files));
+  pthread_mutex_unlock(&lock);
+
+  for(int i = 0; i < BF_ENV_FILES; i++){
+    if(files[i].info != NULL && files[i].close(files[i].info) != 0){
+      code = BF_ERROR;
+    }
+  }
+
+  pthread_mutex_lock(&lock);
+  BF_PoolDestroy(env->name);
+  envs[slot] = NULL;
+  if(--count == 0){
+    BF_ErrorCode closed = BF_Close();
+    if(closed != BF_OK){
+      code = closed;
+    }
+  }
+  pthread_mutex_unlock(&lock);
+
+  free(env->name);
+  free(env);
+
+  return code;
+}
+
+const char* BF_EnvName(const BF_Env* env){
+  return env->name;
+}
+
+void BF_EnvCounters(const BF_Env* env, BF_EnvStats* stats){
+  pthread_mutex_lock(&lock);
+  stats->blocks = env->blocks;
+  stats->opened = env->opened;
+  stats->files = 0;
+  for(int i = 0; i < BF_ENV_FILES; i++){
+    stats->files += env->files[i].info != NULL;
+  }
+  if(BF_PoolCounters(env->name, &stats->hits, &stats->misses) != 0){
+    stats->hits = 0;
+    stats->misses = 0;
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+/**** Files of the envs ****/
+
+BF_ErrorCode BF_EnvUse(BF_Env* env, const char* filename){
+  pthread_mutex_lock(&lock);
+  BF_ErrorCode code = BF_PoolUse(filename, env->name);
+  pthread_mutex_unlock(&lock);
+
+  return code;
+}
+
+BF_ErrorCode BF_EnvAdd(BF_Env* env, void* info, BF_EnvClose close){
+  BF_ErrorCode code = BF_ERROR;
+
+  pthread_mutex_lock(&lock);
+  for(int i = 0; i < BF_ENV_FILES; i++){
+    if(env->files[i].info == NULL){
+      env->files[i].info = info;
+      env->files[i].close = close;
+      env->opened++;
+      code = BF_OK;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&lock);
+
+  return code;
+}
+
+void BF_EnvRemove(void* info){
+  pthread_mutex_lock(&lock);
+  for(int slot = 0; slot < BF_ENV_MAX; slot++){
+    for(int i = 0; envs[slot] != NULL && i < BF_ENV_FILES; i++){
+      if(envs[slot]->files[i].info == info){
+        envs[slot]->files[i].info = NULL;
+      }
+    }
+  }
+  pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,428 @@
+#define _GNU_SOURCE     // O_DIRECT and statx
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+
+#include "bf.h"
+#include "bf_flush.h"
+#include "trace.h"
+
+typedef struct{
+  int used;
+  int writing;          // Taken by the writer thread, a newer copy of the block goes to another slot
+  int failed;           // Its write failed, it is kept until a newer copy or a sync of the file tries it again
+  int file;             // file_desc of the BF layer
+  int block;
+  char data[BF_BLOCK_SIZE] __attribute__((aligned(BF_BLOCK_SIZE)));   // Aligned for O_DIRECT
+}BF_FlushSlot;
+
+typedef struct{
+  int attached;
+  int fd;               // Our own write only open of the file, the writer thread writes to this
+  int pending;          // Slots of this file, also read without the lock by BF_FlushRefresh
+  int failed;           // Slots of this file whose write failed
+  unsigned int written; // Slots of this file written so far, also read without the lock by BF_FlushRefresh
+  int dirtied;          // A block was given back to be made dirty, its frame may be newer than the file
+}BF_FlushFile;
+
+static BF_IoMode ioMode = BF_IO_BUFFERED;
+
+/**** State shared with the writer thread (protected by lock) ****/
+
+static BF_FlushFile files[BF_MAX_OPEN_FILES];
+static BF_FlushSlot slots[BF_FLUSH_SLOTS];
+static int pendingSlots = 0;  // Slots waiting for the writer or being written, not the failed ones
+static int attachedFiles = 0;
+static int running = 0;
+static int waiting = 0;       // Callers waiting for the writer, it writes at once instead of waiting for a batch
+
+static char refreshCopy[BF_BLOCK_SIZE] __attribute__((aligned(BF_BLOCK_SIZE)));   // BF_FlushRefresh reads the file into it
+
+static pthread_t thread;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeUp = PTHREAD_COND_INITIALIZER;    // A batch is pending, somebody is waiting or the thread must stop
+static pthread_cond_t done = PTHREAD_COND_INITIALIZER;      // The writer thread finished a batch
+
+/**** Writer thread ****/
+
+static int BF_FlushCompare(const void* a, const void* b){
+  const BF_FlushSlot* first = &slots[*(const int*) a];
+  const BF_FlushSlot* second = &slots[*(const int*) b];
+
+  if(first->file != second->file){
+    return first->file - second->file;
+  }
+
+  return first->block - second->block;
+}
+
+// Writes count blocks from offset, again from where a short write stopped
+static int BF_FlushWriteRun(int fd, struct iovec* vectors, int count, off_t offset){
+  while(count > 0){
+    ssize_t written = pwritev(fd, vectors, count, offset);
+    if(written < 0 && errno == EINTR){
+      continue;
+    }
+    if(written <= 0){
+      perror("BF flush");
+      return -1;
+    }
+
+    offset += written;
+    while(count > 0 && written >= (ssize_t) vectors->iov_len){
+      written -= vectors->iov_len;
+      vectors++;
+      count--;
+    }
+    if(count > 0){
+      vectors->iov_base = (char*) vectors->iov_base + written;
+      vectors->iov_len -= written;
+    }
+  }
+
+  return 0;
+}
+
+// Called without the lock, the slots of the batch are marked writing so nobody else touches them
+// The slots that could not be written are marked failed
+static void BF_FlushWrite(int batch[], int count){
+  static struct iovec vectors[BF_FLUSH_SLOTS];
+
+  int i = 0;
+  while(i < count){
+    BF_FlushSlot* first = &slots[batch[i]];
+
+    int run = 0;    // Adjacent blocks of the same file become one pwritev
+    while(i + run < count && slots[batch[i + run]].file == first->file && slots[batch[i + run]].block == first->block + run){
+      vectors[run].iov_base = slots[batch[i + run]].data;
+      vectors[run].iov_len = BF_BLOCK_SIZE;
+      run++;
+    }
+
+    int failed = BF_FlushWriteRun(files[first->file].fd, vectors, run, (off_t) first->block * BF_BLOCK_SIZE) != 0;
+    for(int j = 0; j < run; j++){
+      slots[batch[i + j]].failed = failed;
+      TRACE_PAGE(TRACE_WRITE, first->file, first->block + j);
+    }
+    i += run;
+  }
+}
+
+static void* BF_FlushThread(void* argument){
+  static int batch[BF_FLUSH_SLOTS];
+
+  (void) argument;
+  pthread_mutex_lock(&lock);
+  while(1){
+    if(pendingSlots == 0){
+      if(!running){
+        break;
+      }
+      pthread_cond_wait(&wakeUp, &lock);
+      continue;
+    }
+
+    if(pendingSlots < BF_FLUSH_BATCH && waiting == 0 && running){   // Trickling a small batch only when the timer expires
+      struct timespec deadline;
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      deadline.tv_nsec += BF_FLUSH_INTERVAL_MS * 1000000L;
+      deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+      deadline.tv_nsec %= 1000000000L;
+      pthread_cond_timedwait(&wakeUp, &lock, &deadline);
+    }
+
+    int count = 0;
+    for(int i = 0; i < BF_FLUSH_SLOTS; i++){
+      if(slots[i].used && !slots[i].writing && !slots[i].failed){
+        slots[i].writing = 1;
+        batch[count++] = i;
+      }
+    }
+    pthread_mutex_unlock(&lock);
+
+    qsort(batch, count, sizeof(int), BF_FlushCompare);    // Block order, so the file is written front to back
+    BF_FlushWrite(batch, count);
+
+    pthread_mutex_lock(&lock);
+    for(int i = 0; i < count; i++){
+      BF_FlushSlot* slot = &slots[batch[i]];
+      slot->writing = 0;
+      pendingSlots--;
+      if(slot->failed){     // Its copy is still the newest one, BF_FlushRefresh keeps finding it
+        files[slot->file].failed++;
+        continue;
+      }
+      slot->used = 0;
+      // Counted before the slot goes, a refresh that sees pending drop sees written change too
+      __atomic_add_fetch(&files[slot->file].written, 1, __ATOMIC_RELEASE);
+      __atomic_sub_fetch(&files[slot->file].pending, 1, __ATOMIC_RELEASE);
+    }
+    pthread_cond_broadcast(&done);
+  }
+  pthread_mutex_unlock(&lock);
+
+  return NULL;
+}
+
+/**** Helpers (called with lock held) ****/
+
+static int BF_FlushValid(int file_desc){
+  return file_desc >= 0 && file_desc < BF_MAX_OPEN_FILES && files[file_desc].attached;
+}
+
+// Waits until every block of file_desc is written, the failed ones are tried once more
+// Return 0 if successfull, -1 if a block could not be written (its slot is kept)
+static int BF_FlushWait(int file_desc){
+  for(int i = 0; i < BF_FLUSH_SLOTS; i++){
+    if(slots[i].used && slots[i].failed && slots[i].file == file_desc){
+      slots[i].failed = 0;
+      pendingSlots++;
+    }
+  }
+  files[file_desc].failed = 0;
+
+  waiting++;
+  pthread_cond_signal(&wakeUp);
+  while(files[file_desc].pending > files[file_desc].failed){
+    pthread_cond_wait(&done, &lock);
+  }
+  waiting--;
+
+  return files[file_desc].failed > 0 ? -1 : 0;
+}
+
+// Every write of the writer is of whole blocks at block offsets from aligned slots, so that is all O_DIRECT may ask for
+// and BF_FlushRefresh reads the same way
+static int BF_FlushDirectAligned(int fd){
+#ifdef STATX_DIOALIGN
+  struct statx info;
+
+  if(statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &info) == 0 && (info.stx_mask & STATX_DIOALIGN)){
+    return info.stx_dio_offset_align != 0 && info.stx_dio_offset_align <= BF_BLOCK_SIZE && info.stx_dio_mem_align <= BF_BLOCK_SIZE;
+  }
+#endif
+
+  return 1;   // Unknown, 512 bytes is what almost every device asks for
+}
+
+static int BF_FlushOpen(const char* filename){
+  if(ioMode == BF_IO_DIRECT){
+    int fd = open(filename, O_RDWR | O_DIRECT);
+    if(fd >= 0 && BF_FlushDirectAligned(fd)){
+      return fd;
+    }
+    if(fd >= 0){
+      close(fd);
+    }
+    printf("No direct I/O for %s, it is written through the page cache.\n", filename);
+  }
+
+  return open(filename, O_RDWR);
+}
+
+/**** Flush functions ****/
+
+void BF_SetIoMode(const BF_IoMode mode){
+  ioMode = mode;
+}
+
+BF_IoMode BF_GetIoMode(void){
+  return ioMode;
+}
+
+void BF_FlushAttach(const char* filename, const int file_desc){
+  if(file_desc < 0 || file_desc >= BF_MAX_OPEN_FILES){
+    return;
+  }
+
+  int fd = BF_FlushOpen(filename);
+  if(fd < 0){
+    perror("BF flush");
+    return;
+  }
+
+  pthread_mutex_lock(&lock);
+  files[file_desc].attached = 1;
+  files[file_desc].fd = fd;
+  files[file_desc].pending = 0;
+  files[file_desc].failed = 0;
+  files[file_desc].written = 0;
+  files[file_desc].dirtied = 0;
+
+  if(attachedFiles++ == 0){
+    running = 1;
+    pthread_create(&thread, NULL, BF_FlushThread, NULL);
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+int BF_FlushDetach(const int file_desc){
+  int stop = 0;
+
+  pthread_mutex_lock(&lock);
+  if(!BF_FlushValid(file_desc)){
+    pthread_mutex_unlock(&lock);
+    return 0;
+  }
+
+  int result = BF_FlushWait(file_desc);
+  for(int i = 0; i < BF_FLUSH_SLOTS; i++){   // The blocks that could not be written are lost, only a log has them
+    if(slots[i].used && slots[i].file == file_desc){
+      slots[i].used = 0;
+      slots[i].failed = 0;
+    }
+  }
+  files[file_desc].pending = 0;
+  files[file_desc].failed = 0;
+
+  if(close(files[file_desc].fd) != 0){
+    perror("BF flush");
+    result = -1;
+  }
+  files[file_desc].attached = 0;
+
+  if(--attachedFiles == 0){
+    running = 0;
+    stop = 1;
+    pthread_cond_signal(&wakeUp);
+  }
+  pthread_mutex_unlock(&lock);
+
+  if(stop){
+    pthread_join(thread, NULL);
+  }
+
+  return result;
+}
+
+int BF_FlushBlock(const int file_desc, const int block_num, const char* data){
+  BF_FlushSlot* slot = NULL;
+
+  pthread_mutex_lock(&lock);
+  if(!BF_FlushValid(file_desc)){
+    pthread_mutex_unlock(&lock);
+    return -1;
+  }
+
+  while(slot == NULL){
+    int free = -1;
+    for(int i = 0; i < BF_FLUSH_SLOTS; i++){
+      if(slots[i].used && !slots[i].writing && slots[i].file == file_desc && slots[i].block == block_num){
+        slot = &slots[i];   // Still pending, the new copy replaces it
+        if(slot->failed){   // And is written again
+          slot->failed = 0;
+          files[file_desc].failed--;
+          pendingSlots++;
+        }
+        break;
+      }
+      if(!slots[i].used && free == -1){
+        free = i;
+      }
+    }
+
+    if(slot == NULL && free != -1){
+      slot = &slots[free];
+      slot->used = 1;
+      slot->writing = 0;
+      slot->failed = 0;
+      slot->file = file_desc;
+      slot->block = block_num;
+      __atomic_add_fetch(&files[file_desc].pending, 1, __ATOMIC_RELEASE);
+      pendingSlots++;
+    }else if(slot == NULL && pendingSlots == 0){    // Every slot is kept by a failed write, nothing frees one
+      files[file_desc].dirtied = 1;
+      pthread_mutex_unlock(&lock);
+      return -1;
+    }else if(slot == NULL){   // Every slot is taken, the only case the foreground waits for a write
+      waiting++;
+      pthread_cond_signal(&wakeUp);
+      pthread_cond_wait(&done, &lock);
+      waiting--;
+    }
+  }
+
+  memcpy(slot->data, data, BF_BLOCK_SIZE);
+
+  if(pendingSlots >= BF_FLUSH_BATCH){
+    pthread_cond_signal(&wakeUp);
+  }
+  pthread_mutex_unlock(&lock);
+
+  return 0;
+}
+
+unsigned int BF_FlushWritten(const int file_desc){
+  if(file_desc < 0 || file_desc >= BF_MAX_OPEN_FILES){
+    return 0;
+  }
+
+  return __atomic_load_n(&files[file_desc].written, __ATOMIC_ACQUIRE);
+}
+
+void BF_FlushRefresh(const int file_desc, const int block_num, char* data, const unsigned int written){
+  if(file_desc < 0 || file_desc >= BF_MAX_OPEN_FILES){
+    return;
+  }
+  if(__atomic_load_n(&files[file_desc].pending, __ATOMIC_ACQUIRE) == 0 &&
+     __atomic_load_n(&files[file_desc].written, __ATOMIC_ACQUIRE) == written){
+    return;     // Nothing pending and nothing written while the frame was read, the common case for reads
+  }
+
+  pthread_mutex_lock(&lock);
+  if(!BF_FlushValid(file_desc)){
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+
+  BF_FlushSlot* newest = NULL;
+  for(int i = 0; i < BF_FLUSH_SLOTS; i++){
+    if(slots[i].used && slots[i].file == file_desc && slots[i].block == block_num){
+      newest = &slots[i];
+      if(!slots[i].writing){    // A slot being written is older than the one that is not
+        break;
+      }
+    }
+  }
+
+  if(newest != NULL){
+    memcpy(data, newest->data, BF_BLOCK_SIZE);
+  }else if(files[file_desc].written != written && !files[file_desc].dirtied){
+    // Its slot may have been written and freed after the BF layer read the frame, the file has the newest copy now
+    if(pread(files[file_desc].fd, refreshCopy, BF_BLOCK_SIZE, (off_t) block_num * BF_BLOCK_SIZE) == BF_BLOCK_SIZE){
+      memcpy(data, refreshCopy, BF_BLOCK_SIZE);
+    }else{
+      perror("BF flush");
+    }
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+int BF_FlushSync(const int file_desc){
+  pthread_mutex_lock(&lock);
+  if(!BF_FlushValid(file_desc)){
+    pthread_mutex_unlock(&lock);
+    return -1;
+  }
+
+  int result = BF_FlushWait(file_desc);
+  int fd = files[file_desc].fd;
+  pthread_mutex_unlock(&lock);
+
+  if(result != 0){
+    return -1;
+  }
+  if(fdatasync(fd) != 0){
+    perror("BF flush");
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,73 @@
+#include <string.h>
+#include <stdint.h>
+
+#include "bf.h"
+#include "bf_header.h"
+
+/**** Little endian fields ****/
+
+static void BF_HeaderPut(BF_Header* header, uint64_t value, int bytes){
+  if(header->offset + bytes > BF_BLOCK_SIZE){
+    header->overflow = 1;
+    return;
+  }
+
+  for(int i = 0; i < bytes; i++, value >>= 8){
+    header->data[header->offset++] = (char) (value & 0xff);
+  }
+}
+
+static uint64_t BF_HeaderGet(BF_Header* header, int bytes){
+  uint64_t value = 0;
+
+  if(header->offset + bytes > BF_BLOCK_SIZE){
+    header->overflow = 1;
+    return 0;
+  }
+
+  for(int i = 0; i < bytes; i++){
+    value |= (uint64_t) (unsigned char) header->data[header->offset++] << (8 * i);
+  }
+
+  return value;
+}
+
+/**** Header ****/
+
+void BF_HeaderWrite(BF_Header* header, char* data, const char* identifier, const int version){
+  memset(data, 0, BF_BLOCK_SIZE);
+  memcpy(data, identifier, strlen(identifier) + 1);
+
+  header->data = data;
+  header->offset = strlen(identifier) + 1;
+  header->overflow = 0;
+  BF_HeaderPutInt(header, version);
+}
+
+int BF_HeaderRead(BF_Header* header, const char* data, const char* identifier){
+  if(strncmp(data, identifier, BF_BLOCK_SIZE) != 0){
+    return -1;
+  }
+
+  header->data = (char*) data;    // Only read
+  header->offset = strlen(identifier) + 1;
+  header->overflow = 0;
+
+  return BF_HeaderGetInt(header);
+}
+
+void BF_HeaderPutInt(BF_Header* header, const int value){
+  BF_HeaderPut(header, (uint32_t) value, 4);
+}
+
+void BF_HeaderPutLong(BF_Header* header, const long value){
+  BF_HeaderPut(header, (uint64_t) value, 8);
+}
+
+int BF_HeaderGetInt(BF_Header* header){
+  return (int32_t) (uint32_t) BF_HeaderGet(header, 4);
+}
+
+long BF_HeaderGetLong(BF_Header* header){
+  return (long) (int64_t) BF_HeaderGet(header, 8);
+}
@@ -0,0 +1,258 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "bf.h"
+#include "bf_latch.h"
+#include "bf_checksum.h"
+#include "bf_flush.h"
+
+#define BF_PIN_SLOTS 256     // More than the frames of the BF layer, so the table never fills
+
+typedef struct{
+  char* frame;          // Data of the frame (the same for every BF_Block of the block), NULL if the slot is free
+  int file;
+  int pins;
+  int shared;           // Pinned by two holders at once, the one that unpins last may not be the one that changed it
+}BF_FramePins;
+
+typedef struct{
+  int buckets;                    // 0 if the file has no latches
+  pthread_rwlock_t directory;
+  pthread_rwlock_t* bucketLatches;
+  pthread_mutex_t file;
+}BF_FileLatches;
+
+static pthread_mutex_t bfLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static BF_FileLatches latches[BF_MAX_OPEN_FILES];
+static BF_FramePins framePins[BF_PIN_SLOTS];      // Open addressing by frame, linear probing
+
+static BF_FileLatches* BF_LatchesOf(int file_desc){
+  if(file_desc < 0 || file_desc >= BF_MAX_OPEN_FILES || latches[file_desc].buckets == 0){
+    return NULL;
+  }
+
+  return &latches[file_desc];
+}
+
+/**** BF lock ****/
+
+void BF_Lock(void){
+  pthread_mutex_lock(&bfLock);
+}
+
+void BF_Unlock(void){
+  pthread_mutex_unlock(&bfLock);
+}
+
+/**** Pin counts (called with the BF lock held) ****/
+
+static int BF_PinsSlot(char* frame){
+  return (int) (((uintptr_t) frame / BF_BLOCK_SIZE) % BF_PIN_SLOTS);
+}
+
+static BF_FramePins* BF_PinsFind(char* frame){
+  for(int slot = BF_PinsSlot(frame), probes = 0; framePins[slot].frame != NULL && probes < BF_PIN_SLOTS; slot = (slot + 1) % BF_PIN_SLOTS, probes++){
+    if(framePins[slot].frame == frame){
+      return &framePins[slot];
+    }
+  }
+
+  return NULL;
+}
+
+static void BF_PinsAdd(int file_desc, char* frame){
+  BF_FramePins* pins = BF_PinsFind(frame);
+
+  if(pins != NULL){
+    pins->pins++;
+    pins->shared = 1;
+    return;
+  }
+
+  int slot = BF_PinsSlot(frame);
+  for(int probes = 0; framePins[slot].frame != NULL; probes++){
+    if(probes == BF_PIN_SLOTS){   // Full, the pin is not counted
+      return;
+    }
+    slot = (slot + 1) % BF_PIN_SLOTS;
+  }
+  framePins[slot].frame = frame;
+  framePins[slot].file = file_desc;
+  framePins[slot].pins = 1;
+  framePins[slot].shared = 0;
+}
+
+// Frees the slot, moving back the frames after it that probed past it
+static void BF_PinsRemove(BF_FramePins* pins){
+  int hole = pins - framePins;
+
+  framePins[hole].frame = NULL;
+  for(int slot = (hole + 1) % BF_PIN_SLOTS; framePins[slot].frame != NULL; slot = (slot + 1) % BF_PIN_SLOTS){
+    int home = BF_PinsSlot(framePins[slot].frame);
+    if((slot > hole && (home <= hole || home > slot)) || (slot < hole && home <= hole && home > slot)){
+      framePins[hole] = framePins[slot];
+      framePins[slot].frame = NULL;
+      hole = slot;
+    }
+  }
+}
+
+/**** Counted pins ****/
+
+BF_ErrorCode BF_GetBlockCounted(const int file_desc, const int block_num, BF_Block* block){
+  BF_Lock();
+  unsigned int written = BF_FlushWritten(file_desc);
+  BF_ErrorCode code = BF_GetBlock(file_desc, block_num, block);
+  if(code == BF_OK){
+    BF_PinsAdd(file_desc, BF_Block_GetData(block));
+    BF_FlushRefresh(file_desc, block_num, BF_Block_GetData(block), written);   // Checked as the newest copy, the frame may be older
+    if(BF_ChecksumVerify(file_desc, block_num, BF_Block_GetData(block)) != 0){
+      BF_UnpinBlockCounted(block);
+      code = BF_ERROR;
+    }
+  }
+  BF_Unlock();
+
+  return code;
+}
+
+BF_ErrorCode BF_AllocateBlockCounted(const int file_desc, BF_Block* block){
+  BF_Lock();
+  BF_ErrorCode code = BF_AllocateBlock(file_desc, block);
+  if(code == BF_OK){
+    BF_PinsAdd(file_desc, BF_Block_GetData(block));
+  }
+  BF_Unlock();
+
+  return code;
+}
+
+BF_ErrorCode BF_UnpinBlockCounted(BF_Block* block){
+  BF_ErrorCode code = BF_OK;
+
+  BF_Lock();
+  BF_FramePins* pins = BF_PinsFind(BF_Block_GetData(block));
+  if(pins == NULL || --pins->pins == 0){
+    if(pins != NULL){
+      if(pins->shared){
+        BF_Block_SetDirty(block);
+      }
+      BF_PinsRemove(pins);
+    }
+    code = BF_UnpinBlock(block);
+  }
+  BF_Unlock();
+
+  return code;
+}
+
+/**** Latches of a file ****/
+
+int BF_LatchAttach(const int file_desc, const int buckets){
+  if(file_desc < 0 || file_desc >= BF_MAX_OPEN_FILES || buckets < 1){
+    return -1;
+  }
+
+  BF_FileLatches* file = &latches[file_desc];
+  file->bucketLatches = malloc(buckets * sizeof(pthread_rwlock_t));
+  if(file->bucketLatches == NULL){
+    return -1;
+  }
+
+  pthread_rwlockattr_t writerFirst;
+  pthread_rwlockattr_init(&writerFirst);
+  pthread_rwlockattr_setkind_np(&writerFirst, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+  pthread_rwlock_init(&file->directory, &writerFirst);
+  pthread_rwlockattr_destroy(&writerFirst);
+
+  for(int i = 0; i < buckets; i++){
+    pthread_rwlock_init(&file->bucketLatches[i], NULL);
+  }
+  pthread_mutex_init(&file->file, NULL);
+  file->buckets = buckets;
+
+  return 0;
+}
+
+void BF_LatchDetach(const int file_desc){
+  BF_FileLatches* file = BF_LatchesOf(file_desc);
+
+  BF_Lock();    // Pins left by the file would stay on frames that libbf gives to other blocks
+  for(int slot = 0; slot < BF_PIN_SLOTS; slot++){
+    while(framePins[slot].frame != NULL && framePins[slot].file == file_desc){
+      BF_PinsRemove(&framePins[slot]);
+    }
+  }
+  BF_Unlock();
+
+  if(file == NULL){
+    return;
+  }
+
+  for(int i = 0; i < file->buckets; i++){
+    pthread_rwlock_destroy(&file->bucketLatches[i]);
+  }
+  free(file->bucketLatches);
+  pthread_rwlock_destroy(&file->directory);
+  pthread_mutex_destroy(&file->file);
+  file->buckets = 0;
+}
+
+void BF_LatchDirectory(const int file_desc, const BF_LatchMode mode){
+  BF_FileLatches* file = BF_LatchesOf(file_desc);
+
+  if(file != NULL){
+    if(mode == BF_LATCH_EXCLUSIVE){
+      pthread_rwlock_wrlock(&file->directory);
+    }else{
+      pthread_rwlock_rdlock(&file->directory);
+    }
+  }
+}
+
+void BF_UnlatchDirectory(const int file_desc){
+  BF_FileLatches* file = BF_LatchesOf(file_desc);
+
+  if(file != NULL){
+    pthread_rwlock_unlock(&file->directory);
+  }
+}
+
+void BF_LatchBucket(const int file_desc, const int bucket, const BF_LatchMode mode){
+  BF_FileLatches* file = BF_LatchesOf(file_desc);
+
+  if(file != NULL && bucket >= 0 && bucket < file->buckets){
+    if(mode == BF_LATCH_EXCLUSIVE){
+      pthread_rwlock_wrlock(&file->bucketLatches[bucket]);
+    }else{
+      pthread_rwlock_rdlock(&file->bucketLatches[bucket]);
+    }
+  }
+}
+
+void BF_UnlatchBucket(const int file_desc, const int bucket){
+  BF_FileLatches* file = BF_LatchesOf(file_desc);
+
+  if(file != NULL && bucket >= 0 && bucket < file->buckets){
+    pthread_rwlock_unlock(&file->bucketLatches[bucket]);
+  }
+}
+
+void BF_LatchFile(const int file_desc){
+  BF_FileLatches* file = BF_LatchesOf(file_desc);
+
+  if(file != NULL){
+    pthread_mutex_lock(&file->file);
+  }
+}
+
+void BF_UnlatchFile(const int file_desc){
+  BF_FileLatches* file = BF_LatchesOf(file_desc);
+
+  if(file != NULL){
+    pthread_mutex_unlock(&file->file);
+  }
+}
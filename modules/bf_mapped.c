@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "bf.h"
+#include "bf_mapped.h"
+#include "bf_pool.h"
+#include "bf_latch.h"
+#include "bf_checksum.h"
+
+typedef struct{
+  char* data;           // Start of the mapping (NULL if the slot is free)
+  size_t size;          // Bytes mapped
+  int blocks;           // Blocks of the file
+}BF_MappedFile;
+
+static BF_MappedFile mappedFiles[BF_MAX_OPEN_FILES];
+
+static BF_MappedFile* BF_MappedGet(int file_desc){
+  int slot = file_desc - BF_MAPPED_FILE_BASE;
+
+  if(slot < 0 || slot >= BF_MAX_OPEN_FILES || mappedFiles[slot].data == NULL){
+    return NULL;
+  }
+
+  return &mappedFiles[slot];
+}
+
+/**** Mapped file functions ****/
+
+BF_ErrorCode BF_OpenFileMapped(const char* filename, int *file_desc){
+  int slot = 0;
+  while(slot < BF_MAX_OPEN_FILES && mappedFiles[slot].data != NULL){
+    slot++;
+  }
+  if(slot == BF_MAX_OPEN_FILES){
+    return BF_OPEN_FILES_LIMIT_ERROR;
+  }
+
+  int fd = open(filename, O_RDONLY);
+  if(fd < 0){
+    return BF_ERROR;
+  }
+
+  struct stat info;
+  if(fstat(fd, &info) != 0 || info.st_size < BF_BLOCK_SIZE){   // At least block 0 must exist
+    close(fd);
+    return BF_ERROR;
+  }
+
+  // Private and writable only so the caller can fill runtime fields of the header (e.g. fileDesc)
+  void* data = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);    // The mapping keeps its own reference to the file
+  if(data == MAP_FAILED){
+    return BF_ERROR;
+  }
+
+  mappedFiles[slot].data = data;
+  mappedFiles[slot].size = info.st_size;
+  mappedFiles[slot].blocks = info.st_size / BF_BLOCK_SIZE;
+
+  *file_desc = BF_MAPPED_FILE_BASE + slot;
+
+  return BF_OK;
+}
+
+BF_ErrorCode BF_CloseFileMapped(const int file_desc){
+  BF_MappedFile* file = BF_MappedGet(file_desc);
+
+  if(file == NULL){
+    return BF_INVALID_FILE_ERROR;
+  }
+
+  munmap(file->data, file->size);
+  file->data = NULL;
+
+  return BF_OK;
+}
+
+int BF_IsMappedFile(const int file_desc){
+  return BF_MappedGet(file_desc) != NULL;
+}
+
+void BF_AdviseMapped(const int file_desc, const BF_MappedAdvice advice){
+  BF_MappedFile* file = BF_MappedGet(file_desc);
+
+  if(file != NULL){
+    madvise(file->data, file->size, advice == BF_ADVICE_SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM);
+  }
+}
+
+BF_ErrorCode BF_GetBlockData(const int file_desc, const int block_num, BF_Block *block, char** data){
+  BF_MappedFile* file = BF_MappedGet(file_desc);
+
+  if(file == NULL){   // A file of the BF layer
+    if(block_num > 0 && BF_PoolGet(file_desc, block_num, block, data) == 0){
+      return BF_OK;   // Found in the pool of the file, no frame of the BF layer is used
+    }
+
+    BF_ErrorCode code = BF_GetBlockCounted(file_desc, block_num, block);
+    if(code == BF_OK){
+      *data = BF_Block_GetData(block);    // Refreshed from a pending copy by BF_GetBlockCounted
+
+      // Block 0 is never pooled, the access methods keep it pinned while the file is open
+      char* copy = block_num > 0 ? BF_PoolPut(file_desc, block_num, block, *data) : NULL;
+      if(copy != NULL){
+        *data = copy;
+        code = BF_UnpinBlockCounted(block);    // The pool has its own copy, the frame can go
+      }
+    }
+    return code;
+  }
+
+  if(block_num < 0 || block_num >= file->blocks){
+    return BF_INVALID_BLOCK_NUMBER_ERROR;
+  }
+
+  *data = file->data + (size_t) block_num * BF_BLOCK_SIZE;
+
+  return BF_ChecksumVerify(file_desc, block_num, *data) == 0 ? BF_OK : BF_ERROR;
+}
+
+BF_ErrorCode BF_ReleaseBlock(const int file_desc, BF_Block *block){
+  if(BF_IsMappedFile(file_desc) || BF_PoolRelease(file_desc, block)){
+    return BF_OK;
+  }
+
+  return BF_UnpinBlockCounted(block);
+}
@@ -0,0 +1,373 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bf.h"
+#include "bf_pool.h"
+#include "bf_latch.h"
+
+typedef struct{
+  int file;             // file_desc of the BF layer, -1 if the frame is free
+  int block;
+  int pins;             // Holders of the frame, a held frame is never replaced
+  int hashNext;         // Next frame of the same hash chain
+  int newer, older;     // Neighbours in the list of frames by last use
+}BF_PoolFrame;
+
+typedef struct{
+  char* name;           // NULL if the pool is free
+  int blocks;
+  ReplacementAlgorithm policy;
+  BF_PoolFrame* frames;
+  int* hashHeads;       // blocks chains of frames, by file and block
+  int newest, oldest;   // Ends of the use list
+  char* data;           // blocks * BF_BLOCK_SIZE bytes, frame i is at i * BF_BLOCK_SIZE
+  long hits, misses;    // Of BF_PoolGet
+}BF_Pool;
+
+typedef struct{
+  char* filename;
+  int pool;
+}BF_PoolFile;
+
+typedef struct{
+  BF_Block* block;      // NULL if the hold is free
+  int pool;
+  int frame;
+}BF_PoolHold;
+
+static BF_Pool pools[BF_POOL_MAX];
+static BF_PoolFile poolFiles[BF_POOL_FILES];
+static BF_PoolHold holds[BF_POOL_HOLDS];
+static int filePool[BF_MAX_OPEN_FILES];     // Pool + 1 of every open file, 0 for no pool
+
+/**** Helpers ****/
+
+static int BF_PoolFind(const char* name){
+  for(int i = 0; i < BF_POOL_MAX; i++){
+    if(pools[i].name != NULL && strcmp(pools[i].name, name) == 0){
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+static BF_Pool* BF_PoolOf(int file_desc){
+  if(file_desc < 0 || file_desc >= BF_MAX_OPEN_FILES || filePool[file_desc] == 0){
+    return NULL;
+  }
+
+  return &pools[filePool[file_desc] - 1];
+}
+
+static int BF_PoolHash(BF_Pool* pool, int file_desc, int block_num){
+  return (unsigned int) (block_num * 31 + file_desc) % pool->blocks;
+}
+
+static int BF_PoolFrameOf(BF_Pool* pool, int file_desc, int block_num){
+  int frame = pool->hashHeads[BF_PoolHash(pool, file_desc, block_num)];
+
+  while(frame != -1 && (pool->frames[frame].file != file_desc || pool->frames[frame].block != block_num)){
+    frame = pool->frames[frame].hashNext;
+  }
+
+  return frame;
+}
+
+static void BF_PoolUnhash(BF_Pool* pool, int frame){
+  int* link = &pool->hashHeads[BF_PoolHash(pool, pool->frames[frame].file, pool->frames[frame].block)];
+
+  while(*link != frame){
+    link = &pool->frames[*link].hashNext;
+  }
+  *link = pool->frames[frame].hashNext;
+  pool->frames[frame].file = -1;
+}
+
+static void BF_PoolUnlink(BF_Pool* pool, int frame){
+  BF_PoolFrame* unlinked = &pool->frames[frame];
+
+  if(unlinked->newer != -1){
+    pool->frames[unlinked->newer].older = unlinked->older;
+  }else{
+    pool->newest = unlinked->older;
+  }
+
+  if(unlinked->older != -1){
+    pool->frames[unlinked->older].newer = unlinked->newer;
+  }else{
+    pool->oldest = unlinked->newer;
+  }
+}
+
+static void BF_PoolTouch(BF_Pool* pool, int frame){
+  BF_PoolUnlink(pool, frame);
+
+  pool->frames[frame].older = pool->newest;
+  pool->frames[frame].newer = -1;
+  if(pool->newest != -1){
+    pool->frames[pool->newest].newer = frame;
+  }
+  pool->newest = frame;
+  if(pool->oldest == -1){
+    pool->oldest = frame;
+  }
+}
+
+// A free frame, or else the least (LRU) or most (MRU) recently used one that is not held
+// Free frames are kept at the old end of the use list, so LRU finds them first
+static int BF_PoolVictim(BF_Pool* pool){
+  if(pool->frames[pool->oldest].file == -1){
+    return pool->oldest;
+  }
+
+  int frame = pool->policy == LRU ? pool->oldest : pool->newest;
+  while(frame != -1 && pool->frames[frame].pins > 0){
+    frame = pool->policy == LRU ? pool->frames[frame].newer : pool->frames[frame].older;
+  }
+
+  return frame;
+}
+
+// Moves a frame that no longer holds a block to the old end of the use list
+static void BF_PoolFree(BF_Pool* pool, int frame){
+  BF_PoolUnhash(pool, frame);
+  BF_PoolUnlink(pool, frame);
+
+  pool->frames[frame].older = -1;
+  pool->frames[frame].newer = pool->oldest;
+  if(pool->oldest != -1){
+    pool->frames[pool->oldest].older = frame;
+  }else{
+    pool->newest = frame;
+  }
+  pool->oldest = frame;
+}
+
+static int BF_PoolHoldFrame(BF_Block* block, int pool, int frame){
+  for(int i = 0; i < BF_POOL_HOLDS; i++){
+    if(holds[i].block == NULL){
+      holds[i].block = block;
+      holds[i].pool = pool;
+      holds[i].frame = frame;
+      pools[pool].frames[frame].pins++;
+      BF_PoolTouch(&pools[pool], frame);
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+/**** Pool functions ****/
+
+BF_ErrorCode BF_PoolCreate(const char* name, const int blocks, const ReplacementAlgorithm policy){
+  if(blocks <= 0 || BF_PoolFind(name) != -1){
+    return BF_ERROR;
+  }
+
+  int slot = 0;
+  while(slot < BF_POOL_MAX && pools[slot].name != NULL){
+    slot++;
+  }
+  if(slot == BF_POOL_MAX){
+    return BF_ERROR;
+  }
+
+  BF_Pool* pool = &pools[slot];
+  pool->frames = malloc(blocks * sizeof(BF_PoolFrame));
+  pool->hashHeads = malloc(blocks * sizeof(int));
+  pool->data = malloc((size_t) blocks * BF_BLOCK_SIZE);
+  if(pool->frames == NULL || pool->hashHeads == NULL || pool->data == NULL){
+    free(pool->frames);
+    free(pool->hashHeads);
+    free(pool->data);
+    return BF_FULL_MEMORY_ERROR;
+  }
+
+  for(int i = 0; i < blocks; i++){    // All free, in one use list
+    pool->frames[i].file = -1;
+    pool->frames[i].pins = 0;
+    pool->frames[i].newer = i + 1 < blocks ? i + 1 : -1;
+    pool->frames[i].older = i - 1;
+    pool->hashHeads[i] = -1;
+  }
+  pool->oldest = 0;
+  pool->newest = blocks - 1;
+  pool->name = strdup(name);
+  pool->blocks = blocks;
+  pool->policy = policy;
+  pool->hits = 0;
+  pool->misses = 0;
+
+  return BF_OK;
+}
+
+void BF_PoolDestroy(const char* name){
+  int slot = BF_PoolFind(name);
+
+  if(slot == -1){
+    return;
+  }
+
+  for(int i = 0; i < BF_POOL_FILES; i++){   // The files named for it go back to the BF layer only
+    if(poolFiles[i].filename != NULL && poolFiles[i].pool == slot){
+      free(poolFiles[i].filename);
+      poolFiles[i].filename = NULL;
+    }
+  }
+
+  free(pools[slot].name);
+  free(pools[slot].frames);
+  free(pools[slot].hashHeads);
+  free(pools[slot].data);
+  pools[slot].name = NULL;
+}
+
+BF_ErrorCode BF_PoolUse(const char* filename, const char* name){
+  int pool = BF_PoolFind(name);
+  int free = -1;
+
+  if(pool == -1){
+    return BF_ERROR;
+  }
+
+  for(int i = 0; i < BF_POOL_FILES; i++){
+    if(poolFiles[i].filename != NULL && strcmp(poolFiles[i].filename, filename) == 0){
+      poolFiles[i].pool = pool;   // Moving the file to another pool
+      return BF_OK;
+    }
+    if(poolFiles[i].filename == NULL && free == -1){
+      free = i;
+    }
+  }
+
+  if(free == -1){
+    return BF_ERROR;
+  }
+
+  poolFiles[free].filename = strdup(filename);
+  poolFiles[free].pool = pool;
+
+  return BF_OK;
+}
+
+void BF_PoolAttach(const char* filename, const int file_desc){
+  if(file_desc < 0 || file_desc >= BF_MAX_OPEN_FILES){
+    return;
+  }
+
+  filePool[file_desc] = 0;
+  for(int i = 0; i < BF_POOL_FILES; i++){
+    if(poolFiles[i].filename != NULL && strcmp(poolFiles[i].filename, filename) == 0){
+      filePool[file_desc] = poolFiles[i].pool + 1;
+      return;
+    }
+  }
+}
+
+void BF_PoolDetach(const int file_desc){
+  BF_Pool* pool = BF_PoolOf(file_desc);
+
+  if(pool == NULL){
+    return;
+  }
+
+  for(int i = 0; i < pool->blocks; i++){    // The next file with this file_desc must not find these blocks
+    if(pool->frames[i].file == file_desc){
+      BF_PoolFree(pool, i);
+    }
+  }
+  filePool[file_desc] = 0;
+}
+
+int BF_PoolGet(const int file_desc, const int block_num, BF_Block* block, char** data){
+  BF_Pool* pool = BF_PoolOf(file_desc);
+
+  if(pool == NULL){
+    return -1;
+  }
+
+  int frame = BF_PoolFrameOf(pool, file_desc, block_num);
+  if(frame == -1 || BF_PoolHoldFrame(block, pool - pools, frame) != 0){
+    pool->misses++;
+    return -1;
+  }
+
+  pool->hits++;
+  *data = pool->data + (size_t) frame * BF_BLOCK_SIZE;
+
+  return 0;
+}
+
+char* BF_PoolPut(const int file_desc, const int block_num, BF_Block* block, const char* data){
+  BF_Pool* pool = BF_PoolOf(file_desc);
+
+  if(pool == NULL){
+    return NULL;
+  }
+
+  int frame = BF_PoolVictim(pool);
+  if(frame == -1 || BF_PoolHoldFrame(block, pool - pools, frame) != 0){
+    return NULL;
+  }
+
+  if(pool->frames[frame].file != -1){
+    BF_PoolUnhash(pool, frame);
+  }
+  pool->frames[frame].file = file_desc;
+  pool->frames[frame].block = block_num;
+  int hash = BF_PoolHash(pool, file_desc, block_num);
+  pool->frames[frame].hashNext = pool->hashHeads[hash];
+  pool->hashHeads[hash] = frame;
+
+  char* copy = pool->data + (size_t) frame * BF_BLOCK_SIZE;
+  memcpy(copy, data, BF_BLOCK_SIZE);
+
+  return copy;
+}
+
+int BF_PoolRelease(const int file_desc, BF_Block* block){
+  if(BF_PoolOf(file_desc) == NULL){
+    return 0;
+  }
+
+  for(int i = 0; i < BF_POOL_HOLDS; i++){
+    if(holds[i].block == block){
+      pools[holds[i].pool].frames[holds[i].frame].pins--;
+      holds[i].block = NULL;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+void BF_PoolUpdate(const int file_desc, const int block_num, const char* data){
+  BF_Pool* pool = BF_PoolOf(file_desc);
+
+  if(pool == NULL){
+    return;
+  }
+
+  BF_Lock();    // Writers of different buckets update the pool, the BF calls of the others may be replacing its frames
+  int frame = BF_PoolFrameOf(pool, file_desc, block_num);
+  if(frame != -1){
+    memcpy(pool->data + (size_t) frame * BF_BLOCK_SIZE, data, BF_BLOCK_SIZE);
+  }
+  BF_Unlock();
+}
+
+int BF_PoolCounters(const char* name, long* hits, long* misses){
+  int slot = BF_PoolFind(name);
+
+  if(slot == -1){
+    return -1;
+  }
+
+  *hits = pools[slot].hits;
+  *misses = pools[slot].misses;
+
+  return 0;
+}
@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "bf.h"
+#include "bf_prefetch.h"
+#include "bf_flush.h"
+#include "trace.h"
+
+#define BF_PREFETCH_QUEUE 256       // Pending requests, more than that are dropped
+#define BF_PREFETCH_MAX_RUN 128     // Max blocks read with one pread
+#define BF_PREFETCH_SEQUENTIAL 2    // Consecutive blocks read before the read-ahead starts
+
+typedef struct{
+  int file;             // file_desc of the BF layer
+  int first;            // First block to read
+  int count;            // Adjacent blocks to read
+}BF_PrefetchRequest;
+
+typedef struct{
+  int attached;
+  int fd;               // Our own read only open of the file, the I/O thread reads from this
+  int lastBlock;        // Last block given to BF_PrefetchAccess
+  int sequential;       // Consecutive blocks read until lastBlock
+  int prefetchedUpTo;   // Read-ahead has been asked up to this block
+}BF_PrefetchFile;
+
+/**** State shared with the I/O thread (protected by lock) ****/
+
+static BF_PrefetchFile files[BF_MAX_OPEN_FILES];
+static BF_PrefetchRequest queue[BF_PREFETCH_QUEUE];
+static int queueHead = 0;
+static int queueCount = 0;
+static int attachedFiles = 0;
+static int running = 0;
+static int stopping = 0;      // The I/O thread was told to stop and is not joined yet
+static int activeFile = -1;   // File the I/O thread is reading right now
+
+static pthread_t thread;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeUp = PTHREAD_COND_INITIALIZER;    // A request was queued or the thread must stop
+static pthread_cond_t done = PTHREAD_COND_INITIALIZER;      // The I/O thread finished a request
+
+/**** I/O thread ****/
+
+static void* BF_PrefetchThread(void* argument){
+  static char buffer[BF_PREFETCH_MAX_RUN * BF_BLOCK_SIZE];  // Only the page cache keeps what we read
+  (void) argument;
+
+  pthread_mutex_lock(&lock);
+  while(1){
+    while(queueCount == 0 && running){
+      pthread_cond_wait(&wakeUp, &lock);
+    }
+    if(!running){
+      break;
+    }
+
+    BF_PrefetchRequest request = queue[queueHead];
+    queueHead = (queueHead + 1) % BF_PREFETCH_QUEUE;
+    queueCount--;
+
+    activeFile = request.file;
+    int fd = files[request.file].fd;
+    pthread_mutex_unlock(&lock);
+
+    if(pread(fd, buffer, (size_t) request.count * BF_BLOCK_SIZE, (off_t) request.first * BF_BLOCK_SIZE) < 0){
+      perror("BF prefetch");    // Nothing else to do, BF_GetBlock will just read from disk
+    }
+    for(int i = 0; i < request.count; i++){
+      TRACE_PAGE(TRACE_READ, request.file, request.first + i);
+    }
+
+    pthread_mutex_lock(&lock);
+    activeFile = -1;
+    pthread_cond_broadcast(&done);
+  }
+  pthread_mutex_unlock(&lock);
+
+  return NULL;
+}
+
+/**** Queue (called with lock held) ****/
+
+static void BF_PrefetchEnqueue(int file, int first, int count){
+  while(count > 0){
+    if(queueCount == BF_PREFETCH_QUEUE){    // The thread is behind, this is only a hint so drop it
+      return;
+    }
+
+    int run = count < BF_PREFETCH_MAX_RUN ? count : BF_PREFETCH_MAX_RUN;
+
+    BF_PrefetchRequest* request = &queue[(queueHead + queueCount) % BF_PREFETCH_QUEUE];
+    request->file = file;
+    request->first = first;
+    request->count = run;
+    queueCount++;
+
+    first += run;
+    count -= run;
+  }
+
+  pthread_cond_signal(&wakeUp);
+}
+
+static int BF_PrefetchValid(int file_desc){
+  return file_desc >= 0 && file_desc < BF_MAX_OPEN_FILES && files[file_desc].attached;
+}
+
+/**** Prefetch functions ****/
+
+void BF_PrefetchAttach(const char* filename, const int file_desc){
+  if(file_desc < 0 || file_desc >= BF_MAX_OPEN_FILES || BF_GetIoMode() == BF_IO_DIRECT){
+    return;
+  }
+
+  int fd = open(filename, O_RDONLY);
+  if(fd < 0){
+    perror("BF prefetch");
+    return;
+  }
+
+  pthread_mutex_lock(&lock);
+  while(stopping){    // The thread of the last detach is joined before a new one starts
+    pthread_cond_wait(&done, &lock);
+  }
+  files[file_desc].attached = 1;
+  files[file_desc].fd = fd;
+  files[file_desc].lastBlock = -1;
+  files[file_desc].sequential = 0;
+  files[file_desc].prefetchedUpTo = -1;
+
+  if(attachedFiles++ == 0){
+    running = 1;
+    pthread_create(&thread, NULL, BF_PrefetchThread, NULL);
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+void BF_PrefetchDetach(const int file_desc){
+  int stop = 0;
+
+  pthread_mutex_lock(&lock);
+  if(!BF_PrefetchValid(file_desc)){
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+
+  int kept = 0;   // Removing the pending requests of this file
+  for(int i = 0; i < queueCount; i++){
+    BF_PrefetchRequest request = queue[(queueHead + i) % BF_PREFETCH_QUEUE];
+    if(request.file != file_desc){
+      queue[(queueHead + kept) % BF_PREFETCH_QUEUE] = request;
+      kept++;
+    }
+  }
+  queueCount = kept;
+
+  while(activeFile == file_desc){   // And waiting for the one being read
+    pthread_cond_wait(&done, &lock);
+  }
+
+  close(files[file_desc].fd);
+  files[file_desc].attached = 0;
+
+  if(--attachedFiles == 0){
+    running = 0;
+    stopping = 1;
+    stop = 1;
+    pthread_cond_signal(&wakeUp);
+  }
+  pthread_mutex_unlock(&lock);
+
+  if(stop){
+    pthread_join(thread, NULL);
+    pthread_mutex_lock(&lock);
+    stopping = 0;
+    pthread_cond_broadcast(&done);
+    pthread_mutex_unlock(&lock);
+  }
+}
+
+void BF_Prefetch(const int file_desc, const int block_nums[], const int n){
+  pthread_mutex_lock(&lock);
+  if(!BF_PrefetchValid(file_desc)){
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+
+  int i = 0;
+  while(i < n){
+    if(block_nums[i] < 0){
+      i++;
+      continue;
+    }
+
+    int run = 1;    // Adjacent blocks become one request
+    while(i + run < n && block_nums[i + run] == block_nums[i] + run){
+      run++;
+    }
+
+    BF_PrefetchEnqueue(file_desc, block_nums[i], run);
+    i += run;
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+void BF_PrefetchAccess(const int file_desc, const int block_num){
+  pthread_mutex_lock(&lock);
+  if(!BF_PrefetchValid(file_desc)){
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+
+  BF_PrefetchFile* file = &files[file_desc];
+
+  if(block_num == file->lastBlock + 1){
+    file->sequential++;
+  }else{
+    file->sequential = 0;
+    file->prefetchedUpTo = block_num;
+  }
+  file->lastBlock = block_num;
+
+  // Asking for the next window when we have used half of the previous one, so the thread stays ahead
+  if(file->sequential >= BF_PREFETCH_SEQUENTIAL && block_num + BF_PREFETCH_WINDOW / 2 > file->prefetchedUpTo){
+    int first = file->prefetchedUpTo + 1 > block_num + 1 ? file->prefetchedUpTo + 1 : block_num + 1;
+    int last = block_num + BF_PREFETCH_WINDOW;
+
+    BF_PrefetchEnqueue(file_desc, first, last - first + 1);
+    file->prefetchedUpTo = last;
+  }
+  pthread_mutex_unlock(&lock);
+}
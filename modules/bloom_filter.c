@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bloom_filter.h"
+
+#define BLOOM_MAX_HASHES 16
+
+/**** Hash function (64 bit FNV-1a with a final mix) ****/
+
+static unsigned long long BLOOM_Hash(const void* key, int length){
+  const unsigned char* bytes = key;
+  unsigned long long hash = 14695981039346656037ULL;
+
+  for(int i = 0; i < length; i++){
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+
+  hash ^= hash >> 33;   // FNV alone spreads short keys (like an int id) badly in the high bits
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+
+  return hash;
+}
+
+/**** Bloom filter functions ****/
+
+int BLOOM_HashFunctions(double falsePositiveRate){
+  int hashes = 0;
+
+  if(falsePositiveRate <= 0 || falsePositiveRate >= 1){
+    return 0;
+  }
+
+  // Optimal amount is log2(1/rate), every hash function halves the false positives
+  while(falsePositiveRate < 1 && hashes < BLOOM_MAX_HASHES){
+    falsePositiveRate *= 2;
+    hashes++;
+  }
+
+  return hashes;
+}
+
+void BLOOM_Add(unsigned char* filter, int bits, int hashes, const void* key, int length){
+  unsigned long long hash = BLOOM_Hash(key, length);
+  unsigned int h1 = (unsigned int) hash;
+  unsigned int h2 = (unsigned int) (hash >> 32) | 1;  // Double hashing, the i-th bit is h1 + i * h2
+
+  for(int i = 0; i < hashes; i++){
+    unsigned int bit = (h1 + i * h2) % bits;
+    filter[bit / 8] |= 1 << (bit % 8);
+  }
+}
+
+int BLOOM_MayContain(const unsigned char* filter, int bits, int hashes, const void* key, int length){
+  unsigned long long hash = BLOOM_Hash(key, length);
+  unsigned int h1 = (unsigned int) hash;
+  unsigned int h2 = (unsigned int) (hash >> 32) | 1;
+
+  for(int i = 0; i < hashes; i++){
+    unsigned int bit = (h1 + i * h2) % bits;
+    if((filter[bit / 8] & (1 << (bit % 8))) == 0){
+      return 0;
+    }
+  }
+
+  return 1;
+}
@@ -0,0 +1,384 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bf.h"
+#include "record.h"
+#include "hp_file.h"
+#include "ht_table.h"
+#include "wal.h"
+#include "external_sort.h"
+
+typedef int (*SORT_Scan)(void* info, Record_PageVisitor visitor, void* context);
+
+typedef struct{
+  int run;            // Run the record goes to, records of a later run sort after every record of this one
+  Record record;
+}SORT_Entry;
+
+// Replacement selection, the heap is ordered by (run, key) so a record smaller than the last one written waits for the next run
+typedef struct{
+  SORT_Entry* heap;
+  int capacity;
+  int count;
+  Record_Attribute attribute;
+  int runs;           // Runs started so far, the last one is being written
+  HP_info* output;    // File of the last run, NULL before the first record
+  long records;
+  int sort;           // Of this process, in the names of the runs
+  int failed;
+}SORT_Generator;
+
+typedef struct{
+  HP_info* info;
+  Record* page;       // Records of the block being merged
+  int count;
+  int index;
+  int next;           // Block to read after this one, 0 at the end of the file
+  int done;
+}SORT_Source;
+
+// Loser tree, tree[0] is the source with the smallest record and tree[1..k-1] the losers of the matches on the way up
+typedef struct{
+  SORT_Source sources[SORT_MAX_FAN_IN];
+  int tree[SORT_MAX_FAN_IN];
+  int k;
+  Record_Attribute attribute;
+}SORT_Merge;
+
+static int sorts = 0;    // Sorts started by this process, they name their runs
+
+// The process and the sort are in the name, so sorts running at the same time never share a run
+static void SORT_RunName(char* name, int sort, int pass, int run){
+  sprintf(name, "sort_%d_%d_%d_%d.tmp", (int) getpid(), sort, pass, run);
+}
+
+static void SORT_RemoveRuns(int sort, int pass, int first, int count){
+  char name[64];
+
+  for(int i = first; i < first + count; i++){
+    SORT_RunName(name, sort, pass, i);
+    remove(name);
+  }
+}
+
+static HP_info* SORT_CreateFile(char* name){
+  if(HP_CreateFile(name) != HP_OK){
+    return NULL;
+  }
+
+  return HP_OpenFile(name);
+}
+
+/**** Run generation ****/
+
+static int SORT_EntryLess(const SORT_Entry* first, const SORT_Entry* second, Record_Attribute attribute){
+  if(first->run != second->run){
+    return first->run < second->run;
+  }
+
+  return recordCompare(&first->record, &second->record, attribute) < 0;
+}
+
+static void SORT_Push(SORT_Generator* generator, const Record* record, int run){
+  SORT_Entry* heap = generator->heap;
+  int child = generator->count++;
+
+  heap[child].run = run;
+  heap[child].record = *record;
+  while(child > 0 && SORT_EntryLess(&heap[child], &heap[(child - 1) / 2], generator->attribute)){
+    SORT_Entry swap = heap[child];
+    heap[child] = heap[(child - 1) / 2];
+    heap[(child - 1) / 2] = swap;
+    child = (child - 1) / 2;
+  }
+}
+
+static SORT_Entry SORT_Pop(SORT_Generator* generator){
+  SORT_Entry* heap = generator->heap;
+  SORT_Entry top = heap[0];
+
+  heap[0] = heap[--generator->count];
+  for(int parent = 0; 2 * parent + 1 < generator->count; ){
+    int child = 2 * parent + 1;
+    if(child + 1 < generator->count && SORT_EntryLess(&heap[child + 1], &heap[child], generator->attribute)){
+      child++;
+    }
+    if(!SORT_EntryLess(&heap[child], &heap[parent], generator->attribute)){
+      break;
+    }
+
+    SORT_Entry swap = heap[child];
+    heap[child] = heap[parent];
+    heap[parent] = swap;
+    parent = child;
+  }
+
+  return top;
+}
+
+// Writes the smallest record of the heap to its run, returns it
+static SORT_Entry SORT_WriteTop(SORT_Generator* generator){
+  SORT_Entry top = SORT_Pop(generator);
+
+  if(generator->failed){
+    return top;
+  }
+
+  if(top.run == generator->runs){   // Every record left belongs to a later run, the next one starts
+    char name[64];
+
+    if(generator->output != NULL){
+      HP_CloseFile(generator->output);
+    }
+    SORT_RunName(name, generator->sort, 0, generator->runs++);
+    remove(name);   // Left by a crashed process with the same pid
+    if((generator->output = SORT_CreateFile(name)) == NULL){
+      generator->failed = 1;
+      return top;
+    }
+  }
+
+  if(HP_InsertEntry(generator->output, top.record) < 0){
+    generator->failed = 1;
+  }
+  generator->records++;
+
+  return top;
+}
+
+static void SORT_GeneratePage(void* context, const Record* records, int count){
+  SORT_Generator* generator = context;
+
+  for(int i = 0; i < count; i++){
+    int run = 0;    // The first records fill the heap
+
+    if(generator->count == generator->capacity){
+      SORT_Entry top = SORT_WriteTop(generator);
+      run = recordCompare(&records[i], &top.record, generator->attribute) >= 0 ? top.run : top.run + 1;
+    }
+    SORT_Push(generator, &records[i], run);
+  }
+}
+
+/**** Merge ****/
+
+static int SORT_Advance(SORT_Source* source){
+  source->index++;
+
+  while(source->index == source->count){
+    if(source->next == 0){
+      source->done = 1;
+      return 0;
+    }
+    if((source->count = HP_ReadPage(source->info, source->next, source->page, &source->next)) < 0){
+      return -1;
+    }
+    source->index = 0;
+  }
+
+  return 0;
+}
+
+// Source k stands for a record smaller than every other one, so the first adjustments fill the tree
+static int SORT_SourceLess(SORT_Merge* merge, int first, int second){
+  if(first == merge->k || second == merge->k){
+    return first == merge->k;
+  }
+
+  SORT_Source* a = &merge->sources[first];
+  SORT_Source* b = &merge->sources[second];
+  if(a->done || b->done){
+    return !a->done;
+  }
+
+  int compare = recordCompare(&a->page[a->index], &b->page[b->index], merge->attribute);
+
+  return compare < 0 || (compare == 0 && first < second);
+}
+
+// Replays the matches from leaf source to the root, after the record of source changed
+static void SORT_Adjust(SORT_Merge* merge, int source){
+  int winner = source;
+
+  for(int node = (source + merge->k) / 2; node > 0; node /= 2){
+    if(SORT_SourceLess(merge, merge->tree[node], winner)){
+      int swap = merge->tree[node];
+      merge->tree[node] = winner;
+      winner = swap;
+    }
+  }
+  merge->tree[0] = winner;
+}
+
+// Merges the runs first .. first + count - 1 of pass into outputName, the runs are removed
+static long SORT_MergeRuns(int sort, int pass, int first, int count, char* outputName, Record_Attribute attribute){
+  SORT_Merge merge;
+  char name[64];
+  long records = 0;
+  int failed = 0;
+
+  merge.k = count;
+  merge.attribute = attribute;
+
+  HP_info* output = SORT_CreateFile(outputName);
+  if(output == NULL){
+    failed = 1;
+  }
+
+  int opened = 0;
+  for(; opened < count && !failed; opened++){
+    SORT_Source* source = &merge.sources[opened];
+
+    SORT_RunName(name, sort, pass, first + opened);
+    if((source->info = HP_OpenFile(name)) == NULL){
+      failed = 1;
+      break;
+    }
+    source->page = malloc(source->info->maxBlockRecs * sizeof(Record));
+    source->count = 0;
+    source->index = -1;
+    source->next = source->info->lastBlockId == 0 ? 0 : 1;
+    source->done = 0;
+    if(SORT_Advance(source) != 0){
+      failed = 1;
+    }
+  }
+
+  if(!failed){
+    for(int node = 0; node < merge.k; node++){
+      merge.tree[node] = merge.k;
+    }
+    for(int source = merge.k - 1; source >= 0; source--){
+      SORT_Adjust(&merge, source);
+    }
+
+    while(merge.k > 0 && !merge.sources[merge.tree[0]].done){
+      int winner = merge.tree[0];
+      SORT_Source* source = &merge.sources[winner];
+
+      if(HP_InsertEntry(output, source->page[source->index]) < 0 || SORT_Advance(source) != 0){
+        failed = 1;
+        break;
+      }
+      records++;
+      SORT_Adjust(&merge, winner);
+    }
+  }
+
+  for(int i = 0; i < opened; i++){
+    if(merge.sources[i].info != NULL){
+      HP_CloseFile(merge.sources[i].info);
+      free(merge.sources[i].page);
+    }
+  }
+  SORT_RemoveRuns(sort, pass, first, count);
+  if(output != NULL){
+    HP_CloseFile(output);
+  }
+
+  return failed ? -1 : records;
+}
+
+/**** Sort ****/
+
+static int SORT_ScanHeap(void* info, Record_PageVisitor visitor, void* context){
+  return HP_ScanPages(info, visitor, context);
+}
+
+static int SORT_ScanHashtable(void* info, Record_PageVisitor visitor, void* context){
+  return HT_ScanPages(info, visitor, context);
+}
+
+static long SORT_File(void* info, SORT_Scan scan, Record_Attribute attribute, char* outputName, size_t memoryBudget, int fanIn, SORT_Stats* stats){
+  SORT_Generator generator;
+  char name[64];
+
+  if(memoryBudget < SORT_MIN_BUDGET){
+    memoryBudget = SORT_MIN_BUDGET;
+  }
+  if(fanIn > (int) (memoryBudget / BF_BLOCK_SIZE)){   // Every source of a merge holds a block
+    fanIn = memoryBudget / BF_BLOCK_SIZE;
+  }
+  if(fanIn > SORT_MAX_FAN_IN){
+    fanIn = SORT_MAX_FAN_IN;
+  }
+  if(fanIn < 2){
+    fanIn = 2;
+  }
+
+  WAL_Mode mode = WAL_GetMode();
+  WAL_SetMode(WAL_NONE);    // Runs are thrown away and the output is complete only when the sort returns
+
+  generator.capacity = memoryBudget / sizeof(SORT_Entry);
+  generator.heap = malloc(generator.capacity * sizeof(SORT_Entry));
+  generator.count = 0;
+  generator.attribute = attribute;
+  generator.runs = 0;
+  generator.output = NULL;
+  generator.records = 0;
+  generator.sort = __atomic_add_fetch(&sorts, 1, __ATOMIC_RELAXED);
+  generator.failed = generator.heap == NULL;
+  if(!generator.failed && scan(info, SORT_GeneratePage, &generator) < 0){
+    generator.failed = 1;
+  }
+
+  while(generator.count > 0){
+    SORT_WriteTop(&generator);
+  }
+  if(generator.output != NULL){
+    HP_CloseFile(generator.output);
+  }
+  free(generator.heap);
+
+  if(generator.failed){
+    SORT_RemoveRuns(generator.sort, 0, 0, generator.runs);
+    WAL_SetMode(mode);
+    return -1;
+  }
+
+  int runs = generator.runs;
+  int pass = 0;
+  long records = 0;
+  while(runs > fanIn && records >= 0){    // Intermediate passes, until one merge can write the output
+    int merged = 0;
+
+    for(int first = 0; first < runs; first += fanIn, merged++){
+      int count = runs - first < fanIn ? runs - first : fanIn;
+
+      SORT_RunName(name, generator.sort, pass + 1, merged);
+      remove(name);
+      if(records < 0 || SORT_MergeRuns(generator.sort, pass, first, count, name, attribute) < 0){
+        records = -1;
+        SORT_RemoveRuns(generator.sort, pass, first, count);
+      }
+    }
+    runs = merged;
+    pass++;
+  }
+
+  if(records >= 0){
+    records = SORT_MergeRuns(generator.sort, pass, 0, runs, outputName, attribute);
+  }else{
+    SORT_RemoveRuns(generator.sort, pass, 0, runs);
+  }
+
+  WAL_SetMode(mode);
+
+  if(stats != NULL){
+    stats->records = generator.records;
+    stats->runs = generator.runs;
+    stats->passes = pass + 1;
+  }
+
+  return records;
+}
+
+long SORT_HeapFile(HP_info* header_info, Record_Attribute attribute, char* outputName, size_t memoryBudget, int fanIn, SORT_Stats* stats){
+  return SORT_File(header_info, SORT_ScanHeap, attribute, outputName, memoryBudget, fanIn, stats);
+}
+
+long SORT_HashtableFile(HT_info* header_info, Record_Attribute attribute, char* outputName, size_t memoryBudget, int fanIn, SORT_Stats* stats){
+  return SORT_File(header_info, SORT_ScanHashtable, attribute, outputName, memoryBudget, fanIn, stats);
+}
@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bf.h"
+#include "record.h"
+#include "hp_file.h"
+#include "ht_table.h"
+#include "wal.h"
+#include "hash_aggregate.h"
+
+typedef int (*AGG_Scan)(void* info, Record_PageVisitor visitor, void* context);
+
+typedef struct{
+  unsigned int hash;
+  int group;          // Index in groups, -1 if the slot is empty
+}AGG_Slot;
+
+typedef struct{
+  AGG_Slot* slots;
+  unsigned int mask;            // Slots - 1, the slots are a power of 2
+  AGG_Group* groups;
+  int count;
+  int capacity;
+  int maxGroups;                // Groups that fit in the budget, -1 for no limit
+  Record_Attribute attribute;
+  int aggregation;              // Of this process, in the names of the partition files with depth
+  int depth;
+  HP_info* spill[AGG_PARTITIONS];   // Opened at the first spilled record
+  int spilling;
+  int failed;
+}AGG_Table;
+
+static int aggregations = 0;    // Aggregations started by this process, they name their partition files
+
+// The process and the aggregation are in the name, so aggregations running at the same time never share a partition file
+static void AGG_PartitionName(char* name, int aggregation, int depth, int partition){
+  sprintf(name, "agg_%d_%d_%d_%d.tmp", (int) getpid(), aggregation, depth, partition);
+}
+
+/**** Group table ****/
+
+static unsigned int AGG_FreeSlot(AGG_Table* table, unsigned int hash){
+  unsigned int slot = hash & table->mask;
+
+  while(table->slots[slot].group != -1){
+    slot = (slot + 1) & table->mask;
+  }
+
+  return slot;
+}
+
+// Allocates room for capacity groups and at least twice as many slots, returns -1 if out of memory
+static int AGG_TableAlloc(AGG_Table* table, int capacity){
+  unsigned int slots = 2;
+  while(slots < 2 * (unsigned int) capacity){
+    slots *= 2;
+  }
+
+  AGG_Group* groups = realloc(table->groups, capacity * sizeof(AGG_Group));
+  if(groups == NULL){
+    return -1;
+  }
+  table->groups = groups;
+  table->capacity = capacity;
+
+  if(table->slots != NULL && slots == table->mask + 1){
+    return 0;
+  }
+
+  AGG_Slot* old = table->slots;
+  unsigned int oldSlots = old == NULL ? 0 : table->mask + 1;
+  if((table->slots = malloc(slots * sizeof(AGG_Slot))) == NULL){
+    table->slots = old;
+    return -1;
+  }
+
+  table->mask = slots - 1;
+  for(unsigned int i = 0; i < slots; i++){
+    table->slots[i].group = -1;
+  }
+  for(unsigned int i = 0; i < oldSlots; i++){
+    if(old[i].group != -1){
+      table->slots[AGG_FreeSlot(table, old[i].hash)] = old[i];
+    }
+  }
+  free(old);
+
+  return 0;
+}
+
+static int AGG_TableInit(AGG_Table* table, Record_Attribute attribute, int maxGroups, int aggregation, int depth){
+  table->groups = NULL;
+  table->slots = NULL;
+  table->count = 0;
+  table->maxGroups = maxGroups;
+  table->attribute = attribute;
+  table->aggregation = aggregation;
+  table->depth = depth;
+  table->spilling = 0;
+  table->failed = AGG_TableAlloc(table, maxGroups >= 0 && maxGroups < 1024 ? maxGroups : 1024) != 0;
+
+  return table->failed ? -1 : 0;
+}
+
+static void AGG_TableDestroy(AGG_Table* table){
+  free(table->groups);
+  free(table->slots);
+}
+
+/**** Spilling ****/
+
+static void AGG_Spill(AGG_Table* table, const Record* record){
+  char name[64];
+
+  if(!table->spilling){
+    for(int i = 0; i < AGG_PARTITIONS; i++){
+      AGG_PartitionName(name, table->aggregation, table->depth, i);
+      remove(name);   // Left by a crashed process with the same pid
+      if(HP_CreateFile(name) != HP_OK || (table->spill[i] = HP_OpenFile(name)) == NULL){
+        table->failed = 1;
+        for(int j = 0; j <= i; j++){
+          if(j < i){
+            HP_CloseFile(table->spill[j]);
+          }
+          AGG_PartitionName(name, table->aggregation, table->depth, j);
+          remove(name);
+        }
+        return;
+      }
+    }
+    table->spilling = 1;
+  }
+
+  // Another seed than the table, so a partition spilled again is split differently
+  int partition = recordHash(record, table->attribute, table->depth + 1) % AGG_PARTITIONS;
+  if(HP_InsertEntry(table->spill[partition], *record) < 0){
+    table->failed = 1;
+  }
+}
+
+/**** Page visitor ****/
+
+static void AGG_Page(void* context, const Record* records, int count){
+  AGG_Table* table = context;
+
+  for(int i = 0; i < count && !table->failed; i++){
+    const Record* record = &records[i];
+    unsigned int hash = recordHash(record, table->attribute, 0);
+    unsigned int slot = hash & table->mask;
+
+    while(table->slots[slot].group != -1){
+      AGG_Group* group = &table->groups[table->slots[slot].group];
+      if(table->slots[slot].hash == hash && recordCompare(&group->key, record, table->attribute) == 0){
+        break;
+      }
+      slot = (slot + 1) & table->mask;
+    }
+
+    if(table->slots[slot].group != -1){
+      AGG_Group* group = &table->groups[table->slots[slot].group];
+      group->count++;
+      if(record->id < group->minId){
+        group->minId = record->id;
+      }
+      if(record->id > group->maxId){
+        group->maxId = record->id;
+      }
+      continue;
+    }
+
+    if(table->count == table->maxGroups){   // A new group that does not fit, every record of it is spilled
+      AGG_Spill(table, record);
+      continue;
+    }
+
+    if(table->count == table->capacity){
+      int capacity = 2 * table->capacity;
+      if(table->maxGroups >= 0 && capacity > table->maxGroups){
+        capacity = table->maxGroups;
+      }
+      if(AGG_TableAlloc(table, capacity) != 0){
+        table->failed = 1;
+        continue;
+      }
+      slot = AGG_FreeSlot(table, hash);
+    }
+
+    AGG_Group* group = &table->groups[table->count];
+    group->key = *record;
+    group->count = 1;
+    group->minId = record->id;
+    group->maxId = record->id;
+    table->slots[slot].hash = hash;
+    table->slots[slot].group = table->count++;
+  }
+}
+
+/**** Aggregation ****/
+
+static int AGG_ScanHeap(void* info, Record_PageVisitor visitor, void* context){
+  return HP_ScanPages(info, visitor, context);
+}
+
+static int AGG_ScanHashtable(void* info, Record_PageVisitor visitor, void* context){
+  return HT_ScanPages(info, visitor, context);
+}
+
+static long AGG_Run(void* info, AGG_Scan scan, Record_Attribute attribute, size_t memoryBudget, int aggregation, int depth,
+                    AGG_Emit emit, void* context){
+  AGG_Table table;
+  char name[64];
+
+  int maxGroups = memoryBudget / (sizeof(AGG_Group) + 2 * sizeof(AGG_Slot));
+  if(maxGroups < 1){
+    maxGroups = 1;
+  }
+  if(depth == AGG_MAX_DEPTH){
+    maxGroups = -1;
+  }
+
+  if(AGG_TableInit(&table, attribute, maxGroups, aggregation, depth) != 0){
+    AGG_TableDestroy(&table);
+    return -1;
+  }
+  if(scan(info, AGG_Page, &table) < 0){
+    table.failed = 1;
+  }
+
+  long groups = table.failed ? -1 : table.count;
+  for(int i = 0; i < table.count && groups >= 0; i++){
+    emit(context, &table.groups[i]);
+  }
+
+  int spilling = table.spilling;
+  if(spilling){
+    for(int i = 0; i < AGG_PARTITIONS; i++){
+      HP_CloseFile(table.spill[i]);
+    }
+  }
+  AGG_TableDestroy(&table);   // Freed before the partitions, they get the whole budget
+
+  for(int i = 0; i < AGG_PARTITIONS && spilling; i++){
+    AGG_PartitionName(name, aggregation, depth, i);
+
+    HP_info* partition = groups >= 0 ? HP_OpenFile(name) : NULL;
+    if(partition != NULL){
+      long partitionGroups = partition->lastBlockId == 0 ? 0 :
+                             AGG_Run(partition, AGG_ScanHeap, attribute, memoryBudget, aggregation, depth + 1, emit, context);
+      groups = partitionGroups < 0 ? -1 : groups + partitionGroups;
+      HP_CloseFile(partition);
+    }else{
+      groups = -1;
+    }
+    remove(name);
+  }
+
+  return groups;
+}
+
+static long AGG_File(void* info, AGG_Scan scan, Record_Attribute attribute, size_t memoryBudget, AGG_Emit emit, void* context){
+  WAL_Mode mode = WAL_GetMode();
+  WAL_SetMode(WAL_NONE);    // Partition files are thrown away, a crash only needs the aggregation to run again
+
+  long groups = AGG_Run(info, scan, attribute, memoryBudget, __atomic_add_fetch(&aggregations, 1, __ATOMIC_RELAXED), 0, emit, context);
+
+  WAL_SetMode(mode);
+
+  return groups;
+}
+
+long AGG_HeapFile(HP_info* header_info, Record_Attribute attribute, size_t memoryBudget, AGG_Emit emit, void* context){
+  return AGG_File(header_info, AGG_ScanHeap, attribute, memoryBudget, emit, context);
+}
+
+long AGG_HashtableFile(HT_info* header_info, Record_Attribute attribute, size_t memoryBudget, AGG_Emit emit, void* context){
+  return AGG_File(header_info, AGG_ScanHashtable, attribute, memoryBudget, emit, context);
+}
@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bf.h"
+#include "record.h"
+#include "hp_file.h"
+#include "ht_table.h"
+#include "wal.h"
+#include "hash_join.h"
+
+typedef struct{
+  unsigned int hash;
+  const Record* record;     // NULL if the slot is empty
+}JOIN_Slot;
+
+typedef struct JOIN_Chunk{
+  struct JOIN_Chunk* next;
+  int used;
+  Record records[JOIN_ARENA_CHUNK];
+}JOIN_Chunk;
+
+// Build side in memory, the slots only point to the records so probing touches 16 bytes per slot
+typedef struct{
+  JOIN_Slot* slots;
+  unsigned int mask;        // Slots - 1, the slots are a power of 2
+  long count;
+  JOIN_Chunk* chunks;       // Arena of the records, freed all at once
+  Record_Attribute attribute;
+  int failed;               // An allocation failed while it was built
+}JOIN_Table;
+
+typedef struct{
+  JOIN_Table* table;
+  Record_Attribute attribute;   // Key of the probe side
+  int buildIsLeft;
+  JOIN_Emit emit;
+  void* context;
+  long pairs;
+}JOIN_Probe;
+
+typedef struct{
+  HP_info* files[JOIN_MAX_PARTITIONS];
+  int partitions;
+  Record_Attribute attribute;
+  unsigned int seed;
+  int failed;
+}JOIN_Split;
+
+static int joins = 0;   // Joins started by this process, they name their partition files
+
+/**** Keys ****/
+
+static int JOIN_KeysEqual(const Record* first, Record_Attribute firstAttribute, const Record* second, Record_Attribute secondAttribute){
+  int firstLength, secondLength;
+  const void* firstKey = recordKey(first, firstAttribute, &firstLength);
+  const void* secondKey = recordKey(second, secondAttribute, &secondLength);
+
+  return firstLength == secondLength && memcmp(firstKey, secondKey, firstLength) == 0;
+}
+
+/**** Inputs ****/
+
+static long JOIN_Records(JOIN_Input input){   // Upper bound, from the blocks of the file
+  if(input.type == JOIN_HEAP){
+    HP_info* info = input.info;
+    return (long) info->lastBlockId * info->maxBlockRecs;
+  }
+
+  HT_info* info = input.info;
+  return (long) HT_DataBlocks(info) * info->maxBlockRecs;   // Not the blocks emptied by a rehash
+}
+
+static int JOIN_Scan(JOIN_Input input, Record_PageVisitor visitor, void* context){
+  if(input.type == JOIN_HEAP){
+    return HP_ScanPages(input.info, visitor, context);
+  }
+
+  return HT_ScanPages(input.info, visitor, context);
+}
+
+// Bytes of a table of records records, with the slots at most half full
+static size_t JOIN_TableBytes(long records){
+  return records * (sizeof(Record) + 4 * sizeof(JOIN_Slot));
+}
+
+/**** In-memory table ****/
+
+// Return 0 if successfull, -1 if the slots could not be allocated (the table can still be destroyed)
+static int JOIN_TableInit(JOIN_Table* table, long expected, Record_Attribute attribute){
+  unsigned int slots = 16;
+  while(slots < 2 * expected){
+    slots *= 2;
+  }
+
+  table->slots = calloc(slots, sizeof(JOIN_Slot));
+  table->mask = slots - 1;
+  table->count = 0;
+  table->chunks = NULL;
+  table->attribute = attribute;
+  table->failed = table->slots == NULL;
+
+  return table->failed ? -1 : 0;
+}
+
+static void JOIN_TableDestroy(JOIN_Table* table){
+  while(table->chunks != NULL){
+    JOIN_Chunk* next = table->chunks->next;
+    free(table->chunks);
+    table->chunks = next;
+  }
+  free(table->slots);
+}
+
+static void JOIN_TablePlace(JOIN_Table* table, unsigned int hash, const Record* record){
+  unsigned int slot = hash & table->mask;
+
+  while(table->slots[slot].record != NULL){   // Linear probing, equal keys end up next to each other
+    slot = (slot + 1) & table->mask;
+  }
+  table->slots[slot].hash = hash;
+  table->slots[slot].record = record;
+}
+
+// Return 0 if successfull, -1 if the new slots could not be allocated (the old ones are kept)
+static int JOIN_TableGrow(JOIN_Table* table){
+  JOIN_Slot* old = table->slots;
+  unsigned int oldSlots = table->mask + 1;
+
+  JOIN_Slot* slots = calloc(2 * oldSlots, sizeof(JOIN_Slot));
+  if(slots == NULL){
+    return -1;
+  }
+  table->slots = slots;
+  table->mask = 2 * oldSlots - 1;
+  for(unsigned int i = 0; i < oldSlots; i++){
+    if(old[i].record != NULL){
+      JOIN_TablePlace(table, old[i].hash, old[i].record);
+    }
+  }
+  free(old);
+
+  return 0;
+}
+
+// Return 0 if successfull, -1 if there is no memory for the record
+static int JOIN_TableAdd(JOIN_Table* table, const Record* record){
+  if(2 * (table->count + 1) > table->mask + 1 && JOIN_TableGrow(table) != 0){
+    return -1;
+  }
+
+  if(table->chunks == NULL || table->chunks->used == JOIN_ARENA_CHUNK){
+    JOIN_Chunk* chunk = malloc(sizeof(JOIN_Chunk));
+    if(chunk == NULL){
+      return -1;
+    }
+    chunk->next = table->chunks;
+    chunk->used = 0;
+    table->chunks = chunk;
+  }
+
+  Record* copy = &table->chunks->records[table->chunks->used++];
+  *copy = *record;
+
+  JOIN_TablePlace(table, recordHash(copy, table->attribute, 0), copy);
+  table->count++;
+
+  return 0;
+}
+
+/**** Page visitors ****/
+
+static void JOIN_BuildPage(void* context, const Record* records, int count){
+  JOIN_Table* table = context;
+
+  for(int i = 0; i < count && !table->failed; i++){
+    if(JOIN_TableAdd(table, &records[i]) != 0){
+      table->failed = 1;
+    }
+  }
+}
+
+static void JOIN_ProbePage(void* context, const Record* records, int count){
+  JOIN_Probe* probe = context;
+  JOIN_Table* table = probe->table;
+
+  for(int i = 0; i < count; i++){
+    unsigned int hash = recordHash(&records[i], probe->attribute, 0);
+
+    for(unsigned int slot = hash & table->mask; table->slots[slot].record != NULL; slot = (slot + 1) & table->mask){
+      const Record* match = table->slots[slot].record;
+      if(table->slots[slot].hash != hash || !JOIN_KeysEqual(match, table->attribute, &records[i], probe->attribute)){
+        continue;
+      }
+
+      if(probe->buildIsLeft){
+        probe->emit(probe->context, match, &records[i]);
+      }else{
+        probe->emit(probe->context, &records[i], match);
+      }
+      probe->pairs++;
+    }
+  }
+}
+
+static void JOIN_SplitPage(void* context, const Record* records, int count){
+  JOIN_Split* split = context;
+
+  for(int i = 0; i < count; i++){
+    int partition = recordHash(&records[i], split->attribute, split->seed) % split->partitions;
+    if(HP_InsertEntry(split->files[partition], records[i]) < 0){
+      split->failed = 1;
+    }
+  }
+}
+
+/**** Join ****/
+
+// The process and the join are in the name, so joins running at the same time never share a partition file
+static void JOIN_PartitionName(char* name, int join, int depth, char side, int partition){
+  sprintf(name, "join_%d_%d_%d_%c_%d.tmp", (int) getpid(), join, depth, side, partition);
+}
+
+// Writes every record of input to the partitions files of side, they are closed when it returns
+static int JOIN_Partition(JOIN_Input input, int partitions, int join, int depth, char side){
+  JOIN_Split split;
+  char name[64];
+
+  split.partitions = partitions;
+  split.attribute = input.attribute;
+  split.seed = depth + 1;
+  split.failed = 0;
+
+  for(int i = 0; i < partitions; i++){
+    JOIN_PartitionName(name, join, depth, side, i);
+    remove(name);   // Left by a crashed process with the same pid
+    if(HP_CreateFile(name) != HP_OK || (split.files[i] = HP_OpenFile(name)) == NULL){
+      remove(name);
+      for(int j = 0; j < i; j++){   // The ones already opened are closed and thrown away too
+        HP_CloseFile(split.files[j]);
+        JOIN_PartitionName(name, join, depth, side, j);
+        remove(name);
+      }
+      return -1;
+    }
+  }
+
+  if(JOIN_Scan(input, JOIN_SplitPage, &split) < 0){
+    split.failed = 1;
+  }
+
+  for(int i = 0; i < partitions; i++){
+    HP_CloseFile(split.files[i]);
+  }
+
+  return split.failed ? -1 : 0;
+}
+
+static long JOIN_Run(JOIN_Input build, JOIN_Input probe, int buildIsLeft, size_t memoryBudget, int join, int depth, JOIN_Emit emit, void* context){
+  if(JOIN_Records(build) > JOIN_Records(probe)){    // The table is built on the smaller input
+    JOIN_Input swap = build;
+    build = probe;
+    probe = swap;
+    buildIsLeft = !buildIsLeft;
+  }
+
+  long expected = JOIN_Records(build);
+
+  if(JOIN_TableBytes(expected) <= memoryBudget || depth == JOIN_MAX_DEPTH){
+    JOIN_Table table;
+    JOIN_Probe state = {&table, probe.attribute, buildIsLeft, emit, context, 0};
+
+    int failed = JOIN_TableInit(&table, expected, build.attribute) != 0 || JOIN_Scan(build, JOIN_BuildPage, &table) < 0 ||
+                 table.failed || (table.count > 0 && JOIN_Scan(probe, JOIN_ProbePage, &state) < 0);
+    JOIN_TableDestroy(&table);
+
+    return failed ? -1 : state.pairs;
+  }
+
+  /* Grace hash join, both sides are split with the same hash so matching records meet in the same partition */
+
+  int partitions = 2 * (JOIN_TableBytes(expected) / memoryBudget + 1);   // Room for an uneven split
+  if(partitions > JOIN_MAX_PARTITIONS){
+    partitions = JOIN_MAX_PARTITIONS;
+  }
+
+  WAL_Mode mode = WAL_GetMode();
+  WAL_SetMode(WAL_NONE);    // Partition files are thrown away, a crash only needs the join to run again
+
+  long pairs = 0;
+  if(JOIN_Partition(build, partitions, join, depth, 'b') != 0 || JOIN_Partition(probe, partitions, join, depth, 'p') != 0){
+    pairs = -1;
+  }
+
+  char buildName[64], probeName[64];
+  for(int i = 0; i < partitions; i++){
+    JOIN_PartitionName(buildName, join, depth, 'b', i);
+    JOIN_PartitionName(probeName, join, depth, 'p', i);
+
+    if(pairs >= 0){
+      HP_info* buildInfo = HP_OpenFile(buildName);
+      HP_info* probeInfo = HP_OpenFile(probeName);
+
+      if(buildInfo == NULL || probeInfo == NULL){
+        pairs = -1;
+      }else if(buildInfo->lastBlockId > 0 && probeInfo->lastBlockId > 0){
+        long partitionPairs = JOIN_Run(JOIN_HeapInput(buildInfo, build.attribute), JOIN_HeapInput(probeInfo, probe.attribute),
+                                       buildIsLeft, memoryBudget, join, depth + 1, emit, context);
+        pairs = partitionPairs < 0 ? -1 : pairs + partitionPairs;
+      }
+
+      if(buildInfo != NULL){
+        HP_CloseFile(buildInfo);
+      }
+      if(probeInfo != NULL){
+        HP_CloseFile(probeInfo);
+      }
+    }
+
+    remove(buildName);
+    remove(probeName);
+  }
+
+  WAL_SetMode(mode);
+
+  return pairs;
+}
+
+JOIN_Input JOIN_HeapInput(HP_info* info, Record_Attribute attribute){
+  JOIN_Input input = {JOIN_HEAP, info, attribute};
+  return input;
+}
+
+JOIN_Input JOIN_HashtableInput(HT_info* info, Record_Attribute attribute){
+  JOIN_Input input = {JOIN_HASHTABLE, info, attribute};
+  return input;
+}
+
+long JOIN_HashJoin(JOIN_Input left, JOIN_Input right, size_t memoryBudget, JOIN_Emit emit, void* context){
+  return JOIN_Run(left, right, 1, memoryBudget, __atomic_add_fetch(&joins, 1, __ATOMIC_RELAXED), 0, emit, context);
+}
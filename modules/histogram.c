@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "histogram.h"
+
+#define HIST_HALF (HIST_SUB_BUCKETS / 2)
+
+// Values below HIST_SUB_BUCKETS are kept exactly, above that bucket b keeps the sub buckets [HIST_HALF, HIST_SUB_BUCKETS)
+// of value >> b, so the index is b * HIST_HALF + (value >> b)
+static int HIST_Index(uint64_t value){
+  if(value >= (1ULL << HIST_MAX_BITS)){
+    value = (1ULL << HIST_MAX_BITS) - 1;
+  }
+  if(value < HIST_SUB_BUCKETS){
+    return (int) value;
+  }
+
+  int bucket = 63 - __builtin_clzll(value) - (HIST_SUB_BITS - 1);
+
+  return bucket * HIST_HALF + (int) (value >> bucket);
+}
+
+// Largest value that goes to index
+static uint64_t HIST_Value(int index){
+  if(index < HIST_SUB_BUCKETS){
+    return index;
+  }
+
+  int bucket = (index - HIST_SUB_BUCKETS) / HIST_HALF + 1;
+  uint64_t sub = (index - HIST_SUB_BUCKETS) % HIST_HALF + HIST_HALF;
+
+  return ((sub + 1) << bucket) - 1;
+}
+
+void HIST_Init(HIST_Histogram* histogram){
+  memset(histogram, 0, sizeof(HIST_Histogram));
+  histogram->min = UINT64_MAX;
+}
+
+void HIST_Record(HIST_Histogram* histogram, uint64_t value){
+  histogram->counts[HIST_Index(value)]++;
+  histogram->total++;
+  histogram->sum += value;
+  if(value < histogram->min){
+    histogram->min = value;
+  }
+  if(value > histogram->max){
+    histogram->max = value;
+  }
+}
+
+void HIST_Merge(HIST_Histogram* histogram, const HIST_Histogram* from){
+  for(int i = 0; i < HIST_COUNTS; i++){
+    histogram->counts[i] += from->counts[i];
+  }
+  histogram->total += from->total;
+  histogram->sum += from->sum;
+  if(from->min < histogram->min){
+    histogram->min = from->min;
+  }
+  if(from->max > histogram->max){
+    histogram->max = from->max;
+  }
+}
+
+uint64_t HIST_Percentile(const HIST_Histogram* histogram, double percentile){
+  if(histogram->total == 0){
+    return 0;
+  }
+
+  uint64_t rank = (uint64_t) (percentile / 100.0 * histogram->total + 0.5);
+  if(rank < 1){
+    rank = 1;
+  }
+
+  uint64_t seen = 0;
+  for(int i = 0; i < HIST_COUNTS; i++){
+    seen += histogram->counts[i];
+    if(seen >= rank){
+      uint64_t value = HIST_Value(i);
+      return value < histogram->max ? value : histogram->max;   // The top bucket is no wider than what was seen
+    }
+  }
+
+  return histogram->max;
+}
+
+double HIST_Mean(const HIST_Histogram* histogram){
+  return histogram->total == 0 ? 0 : histogram->sum / histogram->total;
+}
@@ -1,10 +1,26 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "bf.h"
+#include "bf_prefetch.h"
+#include "bf_mapped.h"
+#include "bf_flush.h"
 #include "record.h"
 #include "hp_file.h"
+#include "predicate.h"
+#include "wal.h"
+#include "bf_pool.h"
+#include "bf_latch.h"
+#include "bf_checksum.h"
+#include "bf_compress.h"
+#include "bf_header.h"
+#include "bf_env.h"
+#include "trace.h"
 
 #define CALL_BF(call){      \
   BF_ErrorCode code = call; \
@@ -14,20 +30,77 @@
   }                         \
 }
 
+#define CALL_BF_NULL(call){ \
+  BF_ErrorCode code = call; \
+  if (code != BF_OK) {      \
+    BF_PrintError(code);    \
+    return NULL;            \
+  }                         \
+}
+
+#define CALL_OR_DIE(call){  \
+  BF_ErrorCode code = call; \
+  if (code != BF_OK) {      \
+    BF_PrintError(code);    \
+    exit(code);             \
+  }                         \
+}
+
+#define HP_MORSEL_BLOCKS 16   // Blocks a worker of the parallel scan takes each time
+#define HP_EXTENT_BLOCKS 16   // Blocks compressed together by HP_SealFile, so a morsel is one extent
+#define HP_EXTENT_FRAMES 8    // Extents kept decompressed for every open sealed file, one for each worker of a parallel scan
+
 /**** File "identifier" ****/
 
 static const char* string = "Heap file";
 
-/**** Offset functions  ****/
+#define HP_HEADER_VERSION 2   // Version of the header in block 0, a file with another one is not opened
+
+/**** Header (see bf_header.h) ****/
 
-static int HP_InfoOffset(void){
-  return strlen(string) + 1;
+static void HP_EncodeHeader(HP_info* hp_info, char* data){
+  BF_Header header;
+
+  BF_HeaderWrite(&header, data, string, HP_HEADER_VERSION);
+  BF_HeaderPutInt(&header, hp_info->lastBlockId);
+  BF_HeaderPutInt(&header, hp_info->lastBlockRecs);
+  BF_HeaderPutInt(&header, hp_info->maxBlockRecs);
+  BF_HeaderPutInt(&header, hp_info->sealedBlocks);
+  BF_HeaderPutInt(&header, hp_info->extents);
+  BF_HeaderPutInt(&header, hp_info->tailShift);
+  BF_HeaderPutInt(&header, hp_info->flags);
 }
 
-static int HP_BlockInfoOffset(HP_info* hp_info){
-  return HP_InfoOffset() + sizeof(HP_info);
+// An HP_info of its own for the header in data (block 0 of fileName), NULL if it is not a heap file of this version
+static HP_info* HP_DecodeHeader(const char* data, const char* fileName){
+  BF_Header header;
+
+  int version = BF_HeaderRead(&header, data, string);
+  if(version < 0){
+    printf("This is not o heap file.\n");
+    return NULL;
+  }
+  if(version != HP_HEADER_VERSION){
+    printf("The header of %s is version %d, only version %d can be read.\n", fileName, version, HP_HEADER_VERSION);
+    return NULL;
+  }
+
+  HP_info* hp_info = malloc(sizeof(HP_info));
+  hp_info->blockId = 0;
+  hp_info->fileDesc = -1;
+  hp_info->lastBlockId = BF_HeaderGetInt(&header);
+  hp_info->lastBlockRecs = BF_HeaderGetInt(&header);
+  hp_info->maxBlockRecs = BF_HeaderGetInt(&header);
+  hp_info->sealedBlocks = BF_HeaderGetInt(&header);
+  hp_info->extents = BF_HeaderGetInt(&header);
+  hp_info->tailShift = BF_HeaderGetInt(&header);
+  hp_info->flags = BF_HeaderGetInt(&header);
+
+  return hp_info;
 }
 
+/**** Offset functions  ****/
+
 static int HP_MetadataOffset(HP_info* hp_info){
   return hp_info->maxBlockRecs * sizeof(Record);
 }
@@ -36,9 +109,315 @@ static int HP_RecordOffset(HP_block_info* block_info){
   return block_info->recNumber * sizeof(Record);
 }
 
+/**** Predicate on the ids of a block (bit i is set if record i matches) ****/
+
+static unsigned int HP_MatchBlock(void* data, HP_block_info* block_info, const Predicate* predicate){
+  return PRED_EvaluatePage(data, block_info->recNumber, sizeof(Record), offsetof(Record, id), predicate);
+}
+
+/**** Sealed files ****/
+
+// The bytes of extent e (blocks [e * HP_EXTENT_BLOCKS + 1, ...]) start offset bytes into the block after the map
+typedef struct{
+  int offset;
+  int length;               // The bytes of the blocks themselves if they did not compress
+  unsigned int checksum;    // CRC32C of the stored bytes, 0 if none
+}HP_extent;
+
+#define HP_EXTENT_MAP_ENTRIES (BF_BLOCK_SIZE / (int) sizeof(HP_extent))
+
+typedef struct{
+  int extent;               // -1 if the frame is free
+  char pages[HP_EXTENT_BLOCKS * BF_BLOCK_SIZE];
+}HP_extentFrame;
+
+typedef struct{
+  HP_extent* map;
+  HP_extentFrame frames[HP_EXTENT_FRAMES];
+  int hand;                 // Next frame to replace, round robin
+}HP_sealed;
+
+static HP_sealed* sealed[BF_MAPPED_FILE_BASE + BF_MAX_OPEN_FILES];   // By file descriptor, NULL if the file is not sealed
+
+static int HP_MapBlocks(HP_info* hp_info){
+  return (hp_info->extents + HP_EXTENT_MAP_ENTRIES - 1) / HP_EXTENT_MAP_ENTRIES;
+}
+
+static int HP_ExtentBlocks(HP_info* hp_info, int extent){
+  int blocks = hp_info->sealedBlocks - extent * HP_EXTENT_BLOCKS;
+
+  return blocks < HP_EXTENT_BLOCKS ? blocks : HP_EXTENT_BLOCKS;
+}
+
+// Block of the file that keeps block_num, for the blocks after the sealed ones
+static int HP_PhysicalBlock(HP_info* hp_info, int block_num){
+  return block_num + hp_info->tailShift;
+}
+
+// Copies length bytes that start offset bytes into block first (and go on in the blocks after it)
+static int HP_ReadBytes(int file, int first, int offset, char* bytes, int length){
+  char* data;
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+
+  for(int block_num = first + offset / BF_BLOCK_SIZE, start = offset % BF_BLOCK_SIZE; length > 0; block_num++, start = 0){
+    int size = BF_BLOCK_SIZE - start < length ? BF_BLOCK_SIZE - start : length;
+
+    CALL_BF(BF_GetBlockData(file, block_num, block, &data));
+    memcpy(bytes, data + start, size);
+    CALL_BF(BF_ReleaseBlock(file, block));
+
+    bytes += size;
+    length -= size;
+  }
+
+  BF_Block_Destroy(&block);
+
+  return HP_OK;
+}
+
+static int HP_SealedAttach(HP_info* hp_info){
+  if(hp_info->sealedBlocks == 0){
+    return HP_OK;
+  }
+
+  HP_sealed* file = malloc(sizeof(HP_sealed));
+  file->map = malloc(HP_MapBlocks(hp_info) * BF_BLOCK_SIZE);
+  for(int i = 0; i < HP_EXTENT_FRAMES; i++){
+    file->frames[i].extent = -1;
+  }
+  file->hand = 0;
+
+  if(HP_ReadBytes(hp_info->fileDesc, 1, 0, (char*) file->map, HP_MapBlocks(hp_info) * BF_BLOCK_SIZE) != HP_OK){
+    free(file->map);
+    free(file);
+    return HP_ERROR;
+  }
+  sealed[hp_info->fileDesc] = file;
+
+  return HP_OK;
+}
+
+static void HP_SealedDetach(int file_desc){
+  if(sealed[file_desc] != NULL){
+    free(sealed[file_desc]->map);
+    free(sealed[file_desc]);
+    sealed[file_desc] = NULL;
+  }
+}
+
+// Block block_num of a sealed extent, decompressed in a frame of the file. It stays there until HP_EXTENT_FRAMES other extents are read
+static char* HP_ExtentPage(HP_info* hp_info, int block_num){
+  HP_sealed* file = sealed[hp_info->fileDesc];
+  int extent = (block_num - 1) / HP_EXTENT_BLOCKS;
+
+  if(file == NULL){
+    return NULL;
+  }
+
+  HP_extentFrame* frame = NULL;
+  for(int i = 0; i < HP_EXTENT_FRAMES && frame == NULL; i++){
+    if(file->frames[i].extent == extent){
+      frame = &file->frames[i];
+    }
+  }
+
+  if(frame == NULL){
+    HP_extent* entry = &file->map[extent];
+    int length = HP_ExtentBlocks(hp_info, extent) * BF_BLOCK_SIZE;
+    char* stored = malloc(entry->length);
+
+    frame = &file->frames[file->hand];
+    file->hand = (file->hand + 1) % HP_EXTENT_FRAMES;
+    frame->extent = -1;
+
+    if(HP_ReadBytes(hp_info->fileDesc, 1 + HP_MapBlocks(hp_info), entry->offset, stored, entry->length) != HP_OK){
+      free(stored);
+      return NULL;
+    }
+
+    unsigned int checksum = BF_Crc32c(0, stored, entry->length);
+    if(BF_ChecksumEnabled() && entry->checksum != 0 && entry->checksum != (checksum != 0 ? checksum : 1)){
+      fprintf(stderr, "Checksum mismatch in extent %d of file %d, the extent is torn or corrupted.\n", extent, hp_info->fileDesc);
+      free(stored);
+      return NULL;
+    }
+
+    if(entry->length == length){
+      memcpy(frame->pages, stored, length);
+    }else if(BF_Decompress(stored, entry->length, frame->pages, length) != length){
+      fprintf(stderr, "Extent %d of file %d does not decompress.\n", extent, hp_info->fileDesc);
+      free(stored);
+      return NULL;
+    }
+    free(stored);
+    frame->extent = extent;
+  }
+
+  return frame->pages + (block_num - 1 - extent * HP_EXTENT_BLOCKS) * BF_BLOCK_SIZE;
+}
+
+// BF_GetBlockData for the data blocks, the sealed ones come from their extents and nothing is pinned for them
+static BF_ErrorCode HP_ReadBlock(HP_info* hp_info, int block_num, BF_Block* block, char** data){
+  if(block_num > hp_info->sealedBlocks){
+    return BF_GetBlockData(hp_info->fileDesc, HP_PhysicalBlock(hp_info, block_num), block, data);
+  }
+
+  *data = HP_ExtentPage(hp_info, block_num);
+
+  return *data != NULL ? BF_OK : BF_ERROR;
+}
+
+static BF_ErrorCode HP_ReleaseBlock(HP_info* hp_info, int block_num, BF_Block* block){
+  return block_num > hp_info->sealedBlocks ? BF_ReleaseBlock(hp_info->fileDesc, block) : BF_OK;
+}
+
+// Appends a block with data to file, the file being written by HP_SealFile
+static int HP_SealBlock(int file, const char* data){
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+  BF_ErrorCode code = BF_AllocateBlock(file, block);
+  if(code == BF_OK){
+    memcpy(BF_Block_GetData(block), data, BF_BLOCK_SIZE);
+    BF_Block_SetDirty(block);
+    code = BF_UnpinBlock(block);
+  }
+  BF_Block_Destroy(&block);
+  if(code != BF_OK){
+    BF_PrintError(code);
+    return HP_ERROR;
+  }
+
+  return HP_OK;
+}
+
+// Appends length bytes to the extents of file, pending keeps the *filled bytes that do not make a block yet
+static int HP_SealBytes(int file, char* pending, int* filled, const char* bytes, int length){
+  while(length > 0){
+    int size = BF_BLOCK_SIZE - *filled < length ? BF_BLOCK_SIZE - *filled : length;
+    memcpy(pending + *filled, bytes, size);
+    *filled += size;
+    bytes += size;
+    length -= size;
+
+    if(*filled == BF_BLOCK_SIZE){
+      if(HP_SealBlock(file, pending) != HP_OK){
+        return HP_ERROR;
+      }
+      *filled = 0;
+    }
+  }
+
+  return HP_OK;
+}
+
+static void HP_PrefetchAccess(HP_info* hp_info, int block_num){
+  if(block_num > hp_info->sealedBlocks){
+    BF_PrefetchAccess(hp_info->fileDesc, HP_PhysicalBlock(hp_info, block_num));
+  }
+}
+
+/**** Changed blocks go to the background writer, so their frames stay clean and are evicted without a write ****/
+
+// Only blocks after the sealed ones change, block_num is their id and they are found at HP_PhysicalBlock
+static BF_ErrorCode HP_GetBlock(HP_info* hp_info, int block_num, BF_Block* block){
+  block_num = HP_PhysicalBlock(hp_info, block_num);
+  unsigned int written = BF_FlushWritten(hp_info->fileDesc);
+  BF_ErrorCode code = BF_GetBlock(hp_info->fileDesc, block_num, block);
+  if(code == BF_OK){
+    // The frame may be older than its pending copy
+    BF_FlushRefresh(hp_info->fileDesc, block_num, BF_Block_GetData(block), written);
+    if(BF_ChecksumVerify(hp_info->fileDesc, block_num, BF_Block_GetData(block)) != 0){
+      BF_UnpinBlock(block);
+      code = BF_ERROR;
+    }
+  }
+  return code;
+}
+
+static void HP_BlockChanged(HP_info* hp_info, int block_num, BF_Block* block){
+  block_num = HP_PhysicalBlock(hp_info, block_num);
+  BF_ChecksumSeal(hp_info->fileDesc, block_num, BF_Block_GetData(block));
+  BF_PoolUpdate(hp_info->fileDesc, block_num, BF_Block_GetData(block));
+  if(BF_FlushBlock(hp_info->fileDesc, block_num, BF_Block_GetData(block)) != 0){
+    BF_Block_SetDirty(block);   // Without a writer thread the BF layer writes it
+  }
+}
+
+// Every block but block 0 (the header) keeps records, so it has a checksum (see bf_checksum.h)
+// In a sealed file the extent map and the extents come first, the extents have their checksums in the map
+static int HP_IsDataBlock(void* context, int block_num){
+  HP_info* hp_info = context;
+
+  return block_num > 0 && block_num - hp_info->tailShift > hp_info->sealedBlocks;
+}
+
+/**** Redo records of the write ahead log ****/
+
+// record was written at slot of blockId, slot 0 also means blockId was linked after blockId - 1
+typedef struct{
+  int blockId;
+  int slot;
+  Record record;
+}HP_redo;
+
+// Applying a redo record twice gives the same blocks, so the log can be replayed over any mix of written blocks
+static void HP_Redo(void* context, const void* payload, int length){
+  HP_info* hp_info = context;
+  const HP_redo* redo = payload;
+  (void) length;    // The type of the redo record tells how much of it was logged
+
+  int blocks;
+  void* data;
+  HP_block_info* block_info;
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+
+  CALL_OR_DIE(BF_GetBlockCounter(hp_info->fileDesc, &blocks));
+  while(blocks <= HP_PhysicalBlock(hp_info, redo->blockId)){     // The block was allocated but never reached the file
+    CALL_OR_DIE(BF_AllocateBlock(hp_info->fileDesc, block));
+    block_info = (void*) BF_Block_GetData(block) + HP_MetadataOffset(hp_info);
+    block_info->recNumber = 0;
+    block_info->nextBlock = 0;
+    HP_BlockChanged(hp_info, blocks - hp_info->tailShift, block);
+    CALL_OR_DIE(BF_UnpinBlock(block));
+    blocks++;
+  }
+
+  if(redo->slot == 0 && redo->blockId > 1){    // The first block is linked by nothing, the scans start from it
+    CALL_OR_DIE(HP_GetBlock(hp_info, redo->blockId - 1, block));
+    block_info = (void*) BF_Block_GetData(block) + HP_MetadataOffset(hp_info);
+    block_info->nextBlock = redo->blockId;
+    HP_BlockChanged(hp_info, redo->blockId - 1, block);
+    CALL_OR_DIE(BF_UnpinBlock(block));
+  }
+
+  CALL_OR_DIE(HP_GetBlock(hp_info, redo->blockId, block));
+  data = BF_Block_GetData(block);
+  block_info = data + HP_MetadataOffset(hp_info);
+
+  memcpy(data + redo->slot * sizeof(Record), &redo->record, sizeof(Record));
+  if(block_info->recNumber <= redo->slot){
+    block_info->recNumber = redo->slot + 1;
+  }
+
+  if(redo->blockId >= hp_info->lastBlockId){
+    hp_info->lastBlockId = redo->blockId;
+    hp_info->lastBlockRecs = block_info->recNumber;
+  }
+
+  HP_BlockChanged(hp_info, redo->blockId, block);
+  CALL_OR_DIE(BF_UnpinBlock(block));
+  BF_Block_Destroy(&block);
+}
+
 /**** Heap File functions ****/
 
 int HP_CreateFile(char *fileName){
+  TRACE_FUNCTION();
   int file;
   void* data;
 
@@ -46,12 +425,23 @@ int HP_CreateFile(char *fileName){
 
   BF_Block_Init(&block);
   CALL_BF(BF_CreateFile(fileName));
+  WAL_Discard(fileName);    // A log left by an older file with this name is not ours
   CALL_BF(BF_OpenFile(fileName, &file));
 
   CALL_BF(BF_AllocateBlock(file, block));
   data = BF_Block_GetData(block);
 
-  memcpy(data, string, strlen(string));   // Copy to metadata block the string to identify this is a heap
+  HP_info hp_info;
+  hp_info.blockId = 0;
+  hp_info.fileDesc = file;
+  hp_info.lastBlockId = 0;
+  hp_info.lastBlockRecs = 0;
+  hp_info.maxBlockRecs = (BF_BLOCK_SIZE - sizeof(HP_block_info))/sizeof(Record);
+  hp_info.sealedBlocks = 0;
+  hp_info.extents = 0;
+  hp_info.tailShift = 0;
+  hp_info.flags = BF_ChecksumEnabled() ? HP_FLAG_CHECKSUMS : 0;
+  HP_EncodeHeader(&hp_info, data);    // The string that identifies a heap file comes first
 
   BF_Block_SetDirty(block);
   CALL_BF(BF_UnpinBlock(block));
@@ -62,6 +452,7 @@ int HP_CreateFile(char *fileName){
 }
 
 HP_info* HP_OpenFile(char *fileName){
+  TRACE_FUNCTION();
   int file;
   void* data;
 
@@ -72,138 +463,418 @@ HP_info* HP_OpenFile(char *fileName){
   BF_PrintError(BF_GetBlock(file, 0, block));
   data = BF_Block_GetData(block);
 
-  if(strcmp(data, string) != 0){            // This must be a heap file
-    printf("This is not o heap file.\n");
-    BF_PrintError(BF_UnpinBlock(block));
-    BF_Block_Destroy(&block);
+  // hp_info is ours until HP_CloseFile writes it back, so the inserts update it without getting block 0
+  HP_info* hp_info = HP_DecodeHeader(data, fileName);    // This must be a heap file
+  BF_PrintError(BF_UnpinBlock(block));
+  BF_Block_Destroy(&block);
+
+  if(hp_info == NULL){
     BF_PrintError(BF_CloseFile(file));
     return NULL;
   }
-
-  // No need to memcopy to initializing, having pointer to our structs 
-  HP_info* hp_info = data + HP_InfoOffset();    
-  hp_info->blockId = 0;
   hp_info->fileDesc = file;
-  hp_info->lastBlockId = 0;
-  hp_info->maxBlockRecs = (BF_BLOCK_SIZE - sizeof(HP_block_info))/sizeof(Record);
 
-  HP_block_info* block_info = data + HP_BlockInfoOffset(hp_info);
-  block_info->recNumber = 0;
-  block_info->nextBlock = 0;
+  BF_FlushAttach(fileName, file);
+  BF_PoolAttach(fileName, file);
+  BF_ChecksumAttach(file, HP_IsDataBlock, hp_info, 0);   // Strict after the replay, see below
+  if(HP_SealedAttach(hp_info) != HP_OK){
+    printf("Could not read the extent map of %s.\n", fileName);
+  }
 
-  BF_Block_SetDirty(block);
-  BF_PrintError(BF_UnpinBlock(block));
-  BF_Block_Destroy(&block);
+  // Replaying what a crash left in the log, the header on disk is the one of the last checkpoint or clean close
+  WAL_Attach(fileName, file);
+  int redone = WAL_Replay(file, HP_Redo, hp_info);
+  if(redone > 0){
+    printf("Recovered %d log records of %s.\n", redone, fileName);
+  }
+  // The log may be replayed over blocks that never reached the file (0 at the end), they have their checksums now
+  BF_ChecksumAttach(file, HP_IsDataBlock, hp_info, hp_info->flags & HP_FLAG_CHECKSUMS);
+
+  BF_PrefetchAttach(fileName, file);
+
+  return hp_info;
+}
+
+HP_info* HP_OpenFileMapped(char *fileName){
+  TRACE_FUNCTION();
+  int file;
+  char* data;
+
+  if(BF_OpenFileMapped(fileName, &file) != BF_OK){
+    printf("Could not map the file %s.\n", fileName);
+    return NULL;
+  }
+  CALL_BF_NULL(BF_GetBlockData(file, 0, NULL, &data));
+
+  HP_info* hp_info = HP_DecodeHeader(data, fileName);    // This must be a heap file
+  if(hp_info == NULL){
+    BF_PrintError(BF_CloseFileMapped(file));
+    return NULL;
+  }
+  hp_info->fileDesc = file;   // Never written back, the file stays as it is
+
+  BF_AdviseMapped(file, BF_ADVICE_SEQUENTIAL);  // Heap lookups are scans
+  BF_ChecksumAttach(file, HP_IsDataBlock, hp_info, hp_info->flags & HP_FLAG_CHECKSUMS);
+  if(HP_SealedAttach(hp_info) != HP_OK){
+    printf("Could not read the extent map of %s.\n", fileName);
+  }
+
+  return hp_info;
+}
+
+static int HP_EnvClose(void* hp_info){
+  return HP_CloseFile(hp_info);
+}
+
+HP_info* HP_OpenFileEnv(BF_Env* env, char *fileName){
+  TRACE_FUNCTION();
+  if(BF_EnvUse(env, fileName) != BF_OK){
+    printf("Could not open the file %s in the env %s.\n", fileName, BF_EnvName(env));
+    return NULL;
+  }
+
+  HP_info* hp_info = HP_OpenFile(fileName);
+  if(hp_info != NULL && BF_EnvAdd(env, hp_info, HP_EnvClose) != BF_OK){
+    printf("The env %s has too many open files.\n", BF_EnvName(env));
+    HP_CloseFile(hp_info);
+    return NULL;
+  }
 
   return hp_info;
 }
 
 int HP_CloseFile(HP_info* hp_info){
-  CALL_BF(BF_CloseFile(hp_info->fileDesc));
+  TRACE_FUNCTION();
+  BF_EnvRemove(hp_info);   // Nothing if it was opened in no env
+  int file = hp_info->fileDesc;
+
+  BF_ChecksumDetach(file);
+  HP_SealedDetach(file);
+  if(BF_IsMappedFile(file)){
+    CALL_BF(BF_CloseFileMapped(file));
+    free(hp_info);
+    return HP_OK;
+  }
+
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+  CALL_BF(BF_GetBlock(file, 0, block));   // hp_info is written back
+  HP_EncodeHeader(hp_info, BF_Block_GetData(block));
+  BF_Block_SetDirty(block);
+  CALL_BF(BF_UnpinBlock(block));
+  BF_Block_Destroy(&block);
+
+  int flushed = BF_FlushDetach(file) == 0;
+  BF_PrefetchDetach(file);
+  BF_PoolDetach(file);
+  CALL_BF(BF_CloseFile(file));
+  if(!flushed){         // The log is kept, the next open replays the blocks the writer could not write
+    WAL_Close(file);
+    free(hp_info);
+    return HP_ERROR;
+  }
+  int result = WAL_Detach(file) == 0 ? HP_OK : HP_ERROR;   // Only after every block is in the file
+  free(hp_info);
+
+  return result;
+}
+
+int HP_Checkpoint(HP_info* hp_info){
+  TRACE_FUNCTION();
+  int file = hp_info->fileDesc;
+
+  if(BF_IsMappedFile(file)){
+    printf("The file is opened read only.\n");
+    return HP_ERROR;
+  }
+
+  // hp_info is written back only by HP_CloseFile, so the checkpoint writes its header too
+  // The inserts are not stopped, the checkpoint covers what was inserted before it and the log keeps the rest
+  char header[BF_BLOCK_SIZE];
+  HP_EncodeHeader(hp_info, header);
+  if(BF_FlushBlock(file, 0, header) != 0 || BF_FlushSync(file) != 0){
+    return HP_ERROR;
+  }
+
+  WAL_Truncate(file);   // Every logged change is in the file now
+
+  return HP_OK;
+}
+
+// Writes the sealed copy of hp_info into file: block 0, the map, the extents and the blocks after them
+// Nothing is left pinned when it fails, the caller frees the buffers and removes the file
+static int HP_SealExtents(HP_info* hp_info, HP_info* sealedInfo, int file, int mapBlocks,
+                          HP_extent* map, char* pages, char* compressed, BF_Block* block){
+  char* data;
+  int blocks = sealedInfo->sealedBlocks;
+
+  char empty[BF_BLOCK_SIZE] = {0};
+  for(int i = 0; i <= mapBlocks; i++){    // Written at the end, when the map is known
+    if(HP_SealBlock(file, empty) != HP_OK){
+      return HP_ERROR;
+    }
+  }
+
+  char pending[BF_BLOCK_SIZE];
+  int filled = 0;
+  int offset = 0;
+
+  for(int extent = 0; extent < sealedInfo->extents; extent++){
+    int length = HP_ExtentBlocks(sealedInfo, extent) * BF_BLOCK_SIZE;
+
+    for(int i = 0; i < HP_ExtentBlocks(sealedInfo, extent); i++){
+      int block_num = extent * HP_EXTENT_BLOCKS + i + 1;
+      CALL_BF(HP_ReadBlock(hp_info, block_num, block, &data));    // Checked against its checksum on the way
+      memcpy(pages + i * BF_BLOCK_SIZE, data, BF_BLOCK_SIZE);
+      CALL_BF(HP_ReleaseBlock(hp_info, block_num, block));
+    }
+
+    // Kept as they are if they do not get smaller
+    int size = BF_Compress(pages, length, compressed, length - 1);
+    char* stored = size > 0 ? compressed : pages;
+    size = size > 0 ? size : length;
+
+    unsigned int checksum = BF_Crc32c(0, stored, size);
+    map[extent].offset = offset;
+    map[extent].length = size;
+    map[extent].checksum = BF_ChecksumEnabled() ? (checksum != 0 ? checksum : 1) : 0;
+    offset += size;
+
+    if(HP_SealBytes(file, pending, &filled, stored, size) != HP_OK){
+      return HP_ERROR;
+    }
+  }
+  if(filled > 0){
+    memset(pending + filled, 0, BF_BLOCK_SIZE - filled);
+    if(HP_SealBlock(file, pending) != HP_OK){
+      return HP_ERROR;
+    }
+  }
+
+  int tail;   // The blocks after the sealed ones are copied as they are, their checksums do not depend on where they are
+  CALL_BF(BF_GetBlockCounter(file, &tail));
+  sealedInfo->tailShift = tail - (blocks + 1);
+  for(int block_num = blocks + 1; block_num <= hp_info->lastBlockId; block_num++){
+    CALL_BF(HP_ReadBlock(hp_info, block_num, block, &data));
+    if(HP_SealBlock(file, data) != HP_OK){
+      HP_ReleaseBlock(hp_info, block_num, block);
+      return HP_ERROR;
+    }
+    CALL_BF(HP_ReleaseBlock(hp_info, block_num, block));
+  }
+
+  CALL_BF(BF_GetBlock(file, 0, block));
+  HP_EncodeHeader(sealedInfo, BF_Block_GetData(block));
+  BF_Block_SetDirty(block);
+  CALL_BF(BF_UnpinBlock(block));
+
+  for(int i = 0; i < mapBlocks; i++){
+    CALL_BF(BF_GetBlock(file, i + 1, block));
+    memcpy(BF_Block_GetData(block), (char*) map + i * BF_BLOCK_SIZE, BF_BLOCK_SIZE);
+    BF_Block_SetDirty(block);
+    CALL_BF(BF_UnpinBlock(block));
+  }
 
   return HP_OK;
 }
 
+// BF_CloseFile writes the blocks back but does not sync them, the sealed copy must be on the disk before it replaces the file
+static int HP_SyncSealed(const char* path){
+  int fd = open(path, O_RDWR);
+  if(fd < 0 || fsync(fd) != 0){
+    perror(path);
+    if(fd >= 0){
+      close(fd);
+    }
+    return HP_ERROR;
+  }
+
+  return close(fd) == 0 ? HP_OK : HP_ERROR;
+}
+
+int HP_SealFile(char* fileName){
+  TRACE_FUNCTION();
+  int file;
+
+  HP_info* hp_info = HP_OpenFile(fileName);
+  if(hp_info == NULL){
+    return HP_ERROR;
+  }
+
+  int blocks = hp_info->lastBlockId - 1;    // The last block stays as it is, the inserts go on in it
+  if(blocks <= hp_info->sealedBlocks){      // Nothing new to seal
+    blocks = hp_info->sealedBlocks;
+    return HP_CloseFile(hp_info) == HP_OK ? blocks : HP_ERROR;
+  }
+
+  // The sealed copy is written next to the file: block 0, the extent map, the extents and the blocks after them
+  char* path = malloc(strlen(fileName) + strlen(".seal") + 1);
+  if(path == NULL){
+    HP_CloseFile(hp_info);
+    return HP_ERROR;
+  }
+  sprintf(path, "%s.seal", fileName);
+  remove(path);   // Left by a seal that did not finish, the file itself was not replaced
+
+  BF_ErrorCode code = BF_CreateFile(path);
+  if(code == BF_OK){
+    code = BF_OpenFile(path, &file);
+  }
+  if(code != BF_OK){
+    BF_PrintError(code);
+    HP_CloseFile(hp_info);
+    remove(path);
+    free(path);
+    return HP_ERROR;
+  }
+
+  HP_info sealedInfo = *hp_info;
+  sealedInfo.sealedBlocks = blocks;
+  sealedInfo.extents = (blocks + HP_EXTENT_BLOCKS - 1) / HP_EXTENT_BLOCKS;
+  int mapBlocks = HP_MapBlocks(&sealedInfo);
+
+  HP_extent* map = calloc(mapBlocks, BF_BLOCK_SIZE);
+  char* pages = malloc(HP_EXTENT_BLOCKS * BF_BLOCK_SIZE);
+  char* compressed = malloc(HP_EXTENT_BLOCKS * BF_BLOCK_SIZE);
+
+  BF_Block* block;
+  BF_Block_Init(&block);
+
+  int result = HP_ERROR;
+  if(map != NULL && pages != NULL && compressed != NULL){
+    result = HP_SealExtents(hp_info, &sealedInfo, file, mapBlocks, map, pages, compressed, block);
+  }
+
+  BF_Block_Destroy(&block);
+  free(map);
+  free(pages);
+  free(compressed);
+
+  // The file is closed and hp_info freed whatever happened, the .seal file is kept only if it is complete and synced
+  code = BF_CloseFile(file);
+  if(code != BF_OK){
+    BF_PrintError(code);
+    result = HP_ERROR;
+  }
+  if(result == HP_OK){
+    result = HP_SyncSealed(path);
+  }
+  if(HP_CloseFile(hp_info) != HP_OK){
+    result = HP_ERROR;
+  }
+
+  if(result != HP_OK || rename(path, fileName) != 0){    // Until here the file is the one before the seal
+    if(result == HP_OK){
+      perror(path);
+    }
+    remove(path);
+    free(path);
+    return HP_ERROR;
+  }
+  free(path);
+
+  return blocks;
+}
+
 int HP_InsertEntry(HP_info* hp_info, Record record){
-  static int fileBlockSlot = 0;   // Know whenever we need to allocate a new block (initialize it's values)
+  TRACE_FUNCTION();
+  void* data;
+  HP_block_info* block_info;
 
-  void* firstBlockData;
-  void* currentBlockData;
-  void* previousBlockData;  // "Temp" block data to find the previous block data
+  BF_Block* block;
 
-  BF_Block* firstBlock;
-  BF_Block* currentBlock;
-  BF_Block* previousBlock;  // "Temp" block to find the previous block so we can make it to point to current
+  if(BF_IsMappedFile(hp_info->fileDesc)){
+    printf("The file is opened read only.\n");
+    return HP_ERROR;
+  }
 
-  BF_Block_Init(&firstBlock);
-  BF_Block_Init(&currentBlock);
-  BF_Block_Init(&previousBlock);
+  BF_Block_Init(&block);
 
-  CALL_BF(BF_GetBlock(hp_info->fileDesc, 0, firstBlock));
-  firstBlockData = BF_Block_GetData(firstBlock);
-  hp_info = firstBlockData + HP_InfoOffset();
-  
-  if(fileBlockSlot == 0){    
-    CALL_BF(BF_AllocateBlock(hp_info->fileDesc, currentBlock));                   // If the block has been full with records 
-    hp_info->lastBlockId++;                                                       // allocate a new block, the same if there is no block 
-  }else{                                                                          // (at the begging). If its not full just get the block
-    CALL_BF(BF_GetBlock(hp_info->fileDesc, hp_info->lastBlockId, currentBlock));
-  }
-
-  if(hp_info->lastBlockId - 1 == 0) {   // Updating what is the next block_info
-    CALL_BF(BF_GetBlock(hp_info->fileDesc, hp_info->lastBlockId - 1, previousBlock));     // If its the first block calculate different
-    currentBlockData = BF_Block_GetData(currentBlock);                                    // offset because block 0 has only metadata and 0 records
-    previousBlockData = BF_Block_GetData(previousBlock);
-    HP_block_info* previousBlock_info = previousBlockData + HP_BlockInfoOffset(hp_info);
-    previousBlock_info->nextBlock = hp_info->lastBlockId;
+  // Logged first, a new block changes the previous one before the BF calls that may evict it
+  HP_redo redo;
+  if(hp_info->lastBlockId == 0 || hp_info->lastBlockRecs == hp_info->maxBlockRecs){
+    redo.blockId = hp_info->lastBlockId + 1;
+    redo.slot = 0;
   }else{
-    CALL_BF(BF_GetBlock(hp_info->fileDesc, hp_info->lastBlockId - 1, previousBlock));     
-    currentBlockData = BF_Block_GetData(currentBlock);
-    previousBlockData = BF_Block_GetData(previousBlock);
-    HP_block_info* previousBlock_info = previousBlockData + HP_MetadataOffset(hp_info);
-    previousBlock_info->nextBlock = hp_info->lastBlockId;
+    redo.blockId = hp_info->lastBlockId;
+    redo.slot = hp_info->lastBlockRecs;
   }
+  redo.record = record;
+  WAL_Log(hp_info->fileDesc, &redo, sizeof(HP_redo));
+  WAL_Write(hp_info->fileDesc);
+
+  if(hp_info->lastBlockId == 0 || hp_info->lastBlockRecs == hp_info->maxBlockRecs){
+    if(hp_info->lastBlockId > 0){     // The last block is full, make it point to the block we are allocating
+      CALL_BF(HP_GetBlock(hp_info, hp_info->lastBlockId, block));
+      block_info = (void*) BF_Block_GetData(block) + HP_MetadataOffset(hp_info);
+      block_info->nextBlock = hp_info->lastBlockId + 1;
+      HP_BlockChanged(hp_info, hp_info->lastBlockId, block);
+      CALL_BF(BF_UnpinBlock(block));
+    }
+
+    CALL_BF(BF_AllocateBlock(hp_info->fileDesc, block));
+    hp_info->lastBlockId++;
+    hp_info->lastBlockRecs = 0;
 
-  HP_block_info* block_info = currentBlockData + HP_MetadataOffset(hp_info);
-  if(fileBlockSlot == 0){
+    data = BF_Block_GetData(block);
+    block_info = data + HP_MetadataOffset(hp_info);
     block_info->recNumber = 0;
     block_info->nextBlock = 0;
+  }else{                              // Common case, there is space in the last block so this is the only block we pin
+    CALL_BF(HP_GetBlock(hp_info, hp_info->lastBlockId, block));
+    data = BF_Block_GetData(block);
+    block_info = data + HP_MetadataOffset(hp_info);
   }
 
-  memcpy(currentBlockData + HP_RecordOffset(block_info), &record, sizeof(Record));  // Memcpy with offset to write it to the right "position"
+  memcpy(data + HP_RecordOffset(block_info), &record, sizeof(Record));  // Memcpy with offset to write it to the right "position"
   block_info->recNumber++;
+  hp_info->lastBlockRecs = block_info->recNumber;
 
-  BF_Block_SetDirty(firstBlock);
-  BF_Block_SetDirty(currentBlock);
-  BF_Block_SetDirty(previousBlock);
-  CALL_BF(BF_UnpinBlock(firstBlock));
-  CALL_BF(BF_UnpinBlock(currentBlock));
-  CALL_BF(BF_UnpinBlock(previousBlock));
-  BF_Block_Destroy(&firstBlock);
-  BF_Block_Destroy(&currentBlock);
-  BF_Block_Destroy(&previousBlock);
-
-  fileBlockSlot++;
-  if(hp_info->maxBlockRecs == block_info->recNumber){
-    fileBlockSlot = 0;
-  }
+  HP_BlockChanged(hp_info, hp_info->lastBlockId, block);
+  CALL_BF(BF_UnpinBlock(block));
+  BF_Block_Destroy(&block);
 
   return hp_info->lastBlockId;
 }
 
 int HP_GetAllEntries(HP_info* hp_info, int value){
+  TRACE_FUNCTION();
   int total = 0;
   int noEntry = 0;
 
   void* data;
   BF_Block* block;
 
+  if(hp_info->lastBlockId == 0){    // Nothing inserted yet
+    printf("There is no entry with this id.\n");
+    return total;
+  }
+
+  Predicate predicate = {PRED_EQUAL, value, value};
+
   BF_Block_Init(&block);
 
   int temp = 1; // Just a temp to use to get a block (at the end of the loop this will change)
   while(1){
-    CALL_BF(BF_GetBlock(hp_info->fileDesc, temp, block));
-    data = BF_Block_GetData(block);
+    HP_PrefetchAccess(hp_info, temp);   // Heap blocks are consecutive, so this starts the read-ahead
+    CALL_BF(HP_ReadBlock(hp_info, temp, block, (char**) &data));   // Works for mapped and sealed files too
 
     Record* record = data;
     HP_block_info* block_info = data + HP_MetadataOffset(hp_info);
 
-    for(int i = 0; i < block_info->recNumber; i++){
-      if(record->id == value){
-        printRecord(*record);
-        
-        CALL_BF(BF_UnpinBlock(block));  // Unpin for not having memory leaks
-        BF_Block_Destroy(&block);
+    unsigned int mask = HP_MatchBlock(data, block_info, &predicate);   // All the ids of the block are compared at once
+    if(mask != 0){
+      printRecord(record[__builtin_ctz(mask)]);
 
-        return total;
-        
-        noEntry++;
-      }
-      record = data + sizeof(Record) * (i + 1); // Going to the next record of the block
+      CALL_BF(HP_ReleaseBlock(hp_info, temp, block));  // Unpin for not having memory leaks
+      BF_Block_Destroy(&block);
+
+      return total;
     }
     total++;
 
-    CALL_BF(BF_UnpinBlock(block));  // Unpin for not having memory leaks
+    CALL_BF(HP_ReleaseBlock(hp_info, temp, block));  // Unpin for not having memory leaks
 
     if(block_info->nextBlock == 0){
       break;
@@ -219,4 +890,289 @@ int HP_GetAllEntries(HP_info* hp_info, int value){
   BF_Block_Destroy(&block);
   
   return total;
+}
+
+int HP_ScanPages(HP_info* hp_info, Record_PageVisitor visitor, void* context){
+  TRACE_FUNCTION();
+  int total = 0;
+
+  char* data;
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+
+  for(int temp = hp_info->lastBlockId == 0 ? 0 : 1; temp != 0; total++){   // Following nextBlock, like the lookups
+    HP_PrefetchAccess(hp_info, temp);
+    CALL_BF(HP_ReadBlock(hp_info, temp, block, &data));   // Works for mapped and sealed files too
+
+    HP_block_info* block_info = (void*) data + HP_MetadataOffset(hp_info);
+    visitor(context, (Record*) data, block_info->recNumber);
+    int next = block_info->nextBlock;
+
+    CALL_BF(HP_ReleaseBlock(hp_info, temp, block));
+    temp = next;
+  }
+
+  BF_Block_Destroy(&block);
+
+  return total;
+}
+
+int HP_ReadPage(HP_info* hp_info, int block_num, Record* records, int* next){
+  TRACE_FUNCTION();
+  char* data;
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+  CALL_BF(HP_ReadBlock(hp_info, block_num, block, &data));
+
+  HP_block_info* block_info = (void*) data + HP_MetadataOffset(hp_info);
+  int count = block_info->recNumber;
+  memcpy(records, data, count * sizeof(Record));
+  *next = block_info->nextBlock;
+
+  CALL_BF(HP_ReleaseBlock(hp_info, block_num, block));
+  BF_Block_Destroy(&block);
+
+  return count;
+}
+
+int HP_GetEntriesWhere(HP_info* hp_info, Predicate predicate){
+  TRACE_FUNCTION();
+  int total = 0;
+  int noEntry = 0;
+
+  void* data;
+  BF_Block* block;
+
+  if(hp_info->lastBlockId == 0){    // Nothing inserted yet
+    printf("There is no entry with this id.\n");
+    return total;
+  }
+
+  BF_Block_Init(&block);
+
+  int temp = 1;
+  while(1){
+    HP_PrefetchAccess(hp_info, temp);
+    CALL_BF(HP_ReadBlock(hp_info, temp, block, (char**) &data));   // Works for mapped and sealed files too
+
+    Record* record = data;
+    HP_block_info* block_info = data + HP_MetadataOffset(hp_info);
+
+    unsigned int mask = HP_MatchBlock(data, block_info, &predicate);
+    while(mask != 0){       // Visiting only the records that matched
+      printRecord(record[__builtin_ctz(mask)]);
+      mask &= mask - 1;
+      noEntry++;
+    }
+    total++;
+
+    CALL_BF(HP_ReleaseBlock(hp_info, temp, block));
+
+    if(block_info->nextBlock == 0){
+      break;
+    }
+
+    temp = block_info->nextBlock;
+  }
+
+  if(noEntry == 0){
+    printf("There is no entry with this id.\n");
+  }
+
+  BF_Block_Destroy(&block);
+
+  return total;
+}
+
+/**** Parallel scan ****/
+
+typedef struct{
+  int blockId;              // Block and slot of the record, so the 
+  int slot;                 // merged results keep the order of the file
+  Record record;
+}HP_match;
+
+typedef struct{
+  HP_info* hp_info;
+  Predicate predicate;
+  int nextBlock;            // First block of the next morsel, shared between the workers
+  int error;                // Set by a worker that failed, the others stop at their next morsel
+}HP_scan;
+
+typedef struct{
+  HP_scan* scan;
+  int total;                // Blocks this worker read
+  int matches;
+  int capacity;
+  HP_match* found;
+  pthread_t thread;
+}HP_worker;
+
+static int HP_MatchCompare(const void* a, const void* b){
+  const HP_match* first = a;
+  const HP_match* second = b;
+
+  if(first->blockId != second->blockId){
+    return first->blockId - second->blockId;
+  }
+
+  return first->slot - second->slot;
+}
+
+static void* HP_ScanWorker(void* argument){
+  HP_worker* worker = argument;
+  HP_scan* scan = worker->scan;
+  HP_info* hp_info = scan->hp_info;
+
+  char page[BF_BLOCK_SIZE];
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+
+  while(!__atomic_load_n(&scan->error, __ATOMIC_RELAXED)){
+    int first = __atomic_fetch_add(&scan->nextBlock, HP_MORSEL_BLOCKS, __ATOMIC_RELAXED);
+    if(first > hp_info->lastBlockId){
+      break;
+    }
+
+    int last = first + HP_MORSEL_BLOCKS - 1;
+    if(last > hp_info->lastBlockId){
+      last = hp_info->lastBlockId;
+    }
+
+    int morsel[HP_MORSEL_BLOCKS];   // The blocks of the morsel are read in the background while we wait for the BF lock
+    int prefetched = 0;
+    for(int blockId = first; blockId <= last; blockId++){
+      if(blockId > hp_info->sealedBlocks){    // A sealed one is read with its extent
+        morsel[prefetched++] = HP_PhysicalBlock(hp_info, blockId);
+      }
+    }
+    BF_Prefetch(hp_info->fileDesc, morsel, prefetched);
+
+    for(int blockId = first; blockId <= last; blockId++){
+      BF_Lock();    // The BF layer is not thread safe, copy the block and unpin it at once, the predicate is evaluated outside the lock
+      char* data;
+      BF_ErrorCode code = HP_ReadBlock(hp_info, blockId, block, &data);
+      if(code == BF_OK){
+        memcpy(page, data, BF_BLOCK_SIZE);
+        code = HP_ReleaseBlock(hp_info, blockId, block);
+      }
+      BF_Unlock();
+
+      if(code != BF_OK){
+        BF_PrintError(code);
+        __atomic_store_n(&scan->error, 1, __ATOMIC_RELAXED);
+        break;
+      }
+
+      Record* record = (Record*) page;
+      HP_block_info* block_info = (void*) page + HP_MetadataOffset(hp_info);
+
+      unsigned int mask = HP_MatchBlock(page, block_info, &scan->predicate);
+      while(mask != 0){
+        int i = __builtin_ctz(mask);
+        mask &= mask - 1;
+
+        if(worker->matches == worker->capacity){
+          int capacity = worker->capacity == 0 ? 16 : worker->capacity * 2;
+          HP_match* found = realloc(worker->found, capacity * sizeof(HP_match));
+          if(found == NULL){
+            __atomic_store_n(&scan->error, 1, __ATOMIC_RELAXED);
+            break;
+          }
+          worker->found = found;
+          worker->capacity = capacity;
+        }
+        worker->found[worker->matches].blockId = blockId;
+        worker->found[worker->matches].slot = i;
+        worker->found[worker->matches].record = record[i];
+        worker->matches++;
+      }
+      if(mask != 0){    // No memory for its matches
+        break;
+      }
+      worker->total++;
+    }
+  }
+
+  BF_Block_Destroy(&block);
+
+  return NULL;
+}
+
+int HP_ParallelGetAllEntries(HP_info* hp_info, int value, int threads){
+  TRACE_FUNCTION();
+  int total = 0;
+  int matches = 0;
+
+  if(hp_info->lastBlockId == 0){    // Nothing inserted yet
+    printf("There is no entry with this id.\n");
+    return total;
+  }
+
+  if(threads < 1){
+    threads = 1;
+  }
+
+  HP_scan scan;
+  scan.hp_info = hp_info;
+  scan.predicate.op = PRED_EQUAL;
+  scan.predicate.low = value;
+  scan.predicate.high = value;
+  scan.nextBlock = 1;   // Heap blocks are allocated one after the other, so [1, lastBlockId] are all the data blocks
+  scan.error = 0;
+
+  HP_worker* workers = calloc(threads, sizeof(HP_worker));
+  if(workers == NULL){
+    return HP_ERROR;
+  }
+
+  int started = 0;    // A worker that could not start fails the scan, the ones before it stop at their next morsel
+  while(started < threads){
+    workers[started].scan = &scan;
+    if(pthread_create(&workers[started].thread, NULL, HP_ScanWorker, &workers[started]) != 0){
+      __atomic_store_n(&scan.error, 1, __ATOMIC_RELAXED);
+      break;
+    }
+    started++;
+  }
+
+  for(int i = 0; i < started; i++){
+    pthread_join(workers[i].thread, NULL);
+    total += workers[i].total;
+    matches += workers[i].matches;
+  }
+
+  /**** Merge the results of the workers ****/
+
+  HP_match* found = scan.error ? NULL : malloc((matches > 0 ? matches : 1) * sizeof(HP_match));
+  if(found == NULL){
+    scan.error = 1;
+    matches = 0;
+  }
+  for(int i = 0, merged = 0; i < started; i++){
+    if(found != NULL && workers[i].matches > 0){
+      memcpy(found + merged, workers[i].found, workers[i].matches * sizeof(HP_match));
+      merged += workers[i].matches;
+    }
+    free(workers[i].found);
+  }
+  if(found != NULL){
+    qsort(found, matches, sizeof(HP_match), HP_MatchCompare);
+  }
+
+  for(int i = 0; i < matches; i++){
+    printRecord(found[i].record);
+  }
+
+  if(matches == 0 && !scan.error){
+    printf("There is no entry with this id.\n");
+  }
+
+  free(found);
+  free(workers);
+
+  return scan.error ? HP_ERROR : total;
 }
\ No newline at end of file
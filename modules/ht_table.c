@@ -1,13 +1,29 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
+#include <pthread.h>
 
 #include "bf.h"
+#include "bf_prefetch.h"
+#include "bf_mapped.h"
 #include "ht_table.h"
 #include "record.h"
+#include "bloom_filter.h"
+#include "wal.h"
+#include "bf_pool.h"
+#include "bf_latch.h"
+#include "bf_checksum.h"
+#include "bf_header.h"
+#include "bf_env.h"
+#include "trace.h"
+
+#define HT_REHASH_MIN_CHAIN 4     // Chains of fewer blocks are not worth a rehash, whatever the skew
 
 #define CALL_OR_DIE(call){  \
+  BF_Lock();                \
   BF_ErrorCode code = call; \
+  BF_Unlock();              \
   if (code != BF_OK) {      \
     BF_PrintError(code);    \
     exit(code);             \
@@ -18,15 +34,10 @@
 
 static const char* string = "Hashtable file";
 
-/**** Offset functions  ****/
-
-static int HT_InfoOffset(void){
-  return strlen(string) + 1;
-}
+#define HT_HEADER_VERSION 2           // Version of the header in block 0, a file with another one is not opened
+#define HT_HEADER_BYTES (4 + 10 * 4 + 8)  // The version, the int fields and numBuckets, then the table
 
-static int HT_BlockInfoOffset(HT_info* ht_info){
-  return HT_InfoOffset() + sizeof(HT_info) + (ht_info->numBuckets * sizeof(int));
-}
+/**** Offset functions  ****/
 
 static int HT_MetadataOffset(HT_info* ht_info){
   return ht_info->maxBlockRecs * sizeof(Record);
@@ -36,19 +47,464 @@ static int HT_RecordOffset(HT_block_info* block_info){
   return block_info->recNumber * sizeof(Record);
 }
 
+static int HT_MaxBuckets(void){
+  return (BF_BLOCK_SIZE - (int) strlen(string) - 1 - HT_HEADER_BYTES) / (int) sizeof(int);
+}
+
+/**** Header (see bf_header.h) ****/
+
+static void HT_EncodeHeader(HT_info* ht_info, char* data){
+  BF_Header header;
+
+  BF_HeaderWrite(&header, data, string, HT_HEADER_VERSION);
+  BF_HeaderPutInt(&header, ht_info->lastBlockId);
+  BF_HeaderPutInt(&header, ht_info->maxBlockRecs);
+  BF_HeaderPutInt(&header, ht_info->filterHashes);
+  BF_HeaderPutInt(&header, ht_info->filterBlock);
+  BF_HeaderPutInt(&header, ht_info->counterBlock);
+  BF_HeaderPutInt(&header, ht_info->hashSeed);
+  BF_HeaderPutInt(&header, ht_info->maxChain);
+  BF_HeaderPutInt(&header, ht_info->tableBlocks);
+  BF_HeaderPutInt(&header, ht_info->rehashBlock);
+  BF_HeaderPutInt(&header, ht_info->flags);
+  BF_HeaderPutLong(&header, ht_info->numBuckets);
+  for(int i = 0; i < ht_info->numBuckets; i++){
+    BF_HeaderPutInt(&header, ht_info->hashTable[i]);
+  }
+}
+
+HT_info* HT_DecodeHeader(const char* data){
+  BF_Header header;
+
+  if(BF_HeaderRead(&header, data, string) != HT_HEADER_VERSION){
+    return NULL;
+  }
+
+  HT_info* ht_info = malloc(sizeof(HT_info) + HT_MaxBuckets() * sizeof(int));   // Room for the table of any rehash
+  ht_info->blockId = 0;
+  ht_info->fileDesc = -1;
+  ht_info->scans = 0;
+  ht_info->lastBlockId = BF_HeaderGetInt(&header);
+  ht_info->maxBlockRecs = BF_HeaderGetInt(&header);
+  ht_info->filterHashes = BF_HeaderGetInt(&header);
+  ht_info->filterBlock = BF_HeaderGetInt(&header);
+  ht_info->counterBlock = BF_HeaderGetInt(&header);
+  ht_info->hashSeed = BF_HeaderGetInt(&header);
+  ht_info->maxChain = BF_HeaderGetInt(&header);
+  ht_info->tableBlocks = BF_HeaderGetInt(&header);
+  ht_info->rehashBlock = BF_HeaderGetInt(&header);
+  ht_info->flags = BF_HeaderGetInt(&header);
+  ht_info->numBuckets = BF_HeaderGetLong(&header);
+  if(ht_info->numBuckets < 1 || ht_info->numBuckets > HT_MaxBuckets()){
+    free(ht_info);
+    return NULL;
+  }
+  for(int i = 0; i < ht_info->numBuckets; i++){
+    ht_info->hashTable[i] = BF_HeaderGetInt(&header);
+  }
+
+  return ht_info;
+}
+
+/**** Open files, so HT_MarkIndexed finds the HT_info of an open file ****/
+
+static pthread_mutex_t openLock = PTHREAD_MUTEX_INITIALIZER;
+static HT_info* openInfos[BF_MAX_OPEN_FILES];    // By fileDesc, NULL if free (mapped files are not kept)
+static char* openNames[BF_MAX_OPEN_FILES];
+
+static void HT_Opened(HT_info* ht_info, const char* fileName){
+  if(ht_info->fileDesc < 0 || ht_info->fileDesc >= BF_MAX_OPEN_FILES){
+    return;
+  }
+
+  pthread_mutex_lock(&openLock);
+  openInfos[ht_info->fileDesc] = ht_info;
+  openNames[ht_info->fileDesc] = strdup(fileName);
+  pthread_mutex_unlock(&openLock);
+}
+
+static void HT_Closed(HT_info* ht_info){
+  if(ht_info->fileDesc < 0 || ht_info->fileDesc >= BF_MAX_OPEN_FILES){
+    return;
+  }
+
+  pthread_mutex_lock(&openLock);
+  openInfos[ht_info->fileDesc] = NULL;
+  free(openNames[ht_info->fileDesc]);
+  openNames[ht_info->fileDesc] = NULL;
+  pthread_mutex_unlock(&openLock);
+}
+
 /**** Hash function ****/
 
-static int HT_Function(int ID, int buckets){
-  return ID % buckets;
+// ID % buckets until the first rehash, then the ID is mixed with the seed first so IDs with a pattern are spread too
+static int HT_Function(int ID, int buckets, int seed){
+  if(seed == 0){
+    return ID % buckets;
+  }
+
+  unsigned int x = (unsigned int) ID ^ ((unsigned int) seed * 0x9e3779b9u);
+  x ^= x >> 16;
+  x *= 0x85ebca6bu;
+  x ^= x >> 13;
+  x *= 0xc2b2ae35u;
+  x ^= x >> 16;
+
+  return (int) (x % (unsigned int) buckets);
 }
 
-/**** Initialize block_info ****/
+/**** Bloom filters (block filterBlock + bucket is the filter of the bucket) ****/
 
-static HT_block_info* HT_MetadataBlockInitialize(HT_info* ht_info, BF_Block* block){
+static int HT_FilterBlock(HT_info* ht_info, int hash){
+  return ht_info->filterBlock + hash;
+}
+
+static void HT_FilterAdd(HT_info* ht_info, int hash, int value){
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+  CALL_OR_DIE(BF_GetBlockCounted(ht_info->fileDesc, HT_FilterBlock(ht_info, hash), block));
+
+  BLOOM_Add((unsigned char*) BF_Block_GetData(block), BF_BLOCK_SIZE * 8, ht_info->filterHashes, &value, sizeof(int));
+  BF_PoolUpdate(ht_info->fileDesc, HT_FilterBlock(ht_info, hash), BF_Block_GetData(block));
+
+  BF_Block_SetDirty(block);
+  CALL_OR_DIE(BF_UnpinBlockCounted(block));
+  BF_Block_Destroy(&block);
+}
+
+static int HT_FilterMayContain(HT_info* ht_info, int hash, int value){
+  int found;
+  char* data;
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+  CALL_OR_DIE(BF_GetBlockData(ht_info->fileDesc, HT_FilterBlock(ht_info, hash), block, &data));
+
+  found = BLOOM_MayContain((unsigned char*) data, BF_BLOCK_SIZE * 8, ht_info->filterHashes, &value, sizeof(int));
+
+  CALL_OR_DIE(BF_ReleaseBlock(ht_info->fileDesc, block));
+  BF_Block_Destroy(&block);
+
+  return found;
+}
+
+/**** Bucket counters (block counterBlock + bucket / HT_COUNTERS_PER_BLOCK has the counters of bucket) ****/
+
+static int HT_CounterBlocks(int buckets){
+  return (buckets + HT_COUNTERS_PER_BLOCK - 1) / HT_COUNTERS_PER_BLOCK;
+}
+
+// A counter block has the counters of many buckets, so they change under the file latch
+static void HT_CountersAdd(HT_info* ht_info, int hash, int newBlocks){
+  BF_Block* block;
+  int counterBlock = ht_info->counterBlock + hash / HT_COUNTERS_PER_BLOCK;
+
+  BF_Block_Init(&block);
+  BF_LatchFile(ht_info->fileDesc);
+  CALL_OR_DIE(BF_GetBlockCounted(ht_info->fileDesc, counterBlock, block));
+
+  HT_bucket_counters* counters = (HT_bucket_counters*) BF_Block_GetData(block) + hash % HT_COUNTERS_PER_BLOCK;
+  counters->records++;
+  counters->blocks += newBlocks;
+  BF_PoolUpdate(ht_info->fileDesc, counterBlock, BF_Block_GetData(block));
+
+  ht_info->tableBlocks += newBlocks;
+  if(counters->blocks > ht_info->maxChain){
+    ht_info->maxChain = counters->blocks;
+  }
+
+  BF_Block_SetDirty(block);
+  CALL_OR_DIE(BF_UnpinBlockCounted(block));
+  BF_UnlatchFile(ht_info->fileDesc);
+  BF_Block_Destroy(&block);
+}
+
+// The redo records can be replayed over any mix of written blocks but the counters are increments,
+// so after a recovery they are counted again from the chains
+static void HT_CountersRebuild(HT_info* ht_info){
+  void* data;
+  BF_Block* block;
+  BF_Block* counterBlock;
+
+  BF_Block_Init(&block);
+  BF_Block_Init(&counterBlock);
+
+  ht_info->maxChain = 0;
+  ht_info->tableBlocks = 0;
+  for(int first = 0; first < ht_info->numBuckets; first += HT_COUNTERS_PER_BLOCK){
+    int counterId = ht_info->counterBlock + first / HT_COUNTERS_PER_BLOCK;
+    CALL_OR_DIE(BF_GetBlockCounted(ht_info->fileDesc, counterId, counterBlock));
+    HT_bucket_counters* counters = (HT_bucket_counters*) BF_Block_GetData(counterBlock);
+    memset(counters, 0, BF_BLOCK_SIZE);
+
+    for(int bucket = first; bucket < ht_info->numBuckets && bucket < first + HT_COUNTERS_PER_BLOCK; bucket++){
+      int temp = ht_info->hashTable[bucket];
+      while(temp != -1){
+        CALL_OR_DIE(BF_GetBlockCounted(ht_info->fileDesc, temp, block));
+        data = BF_Block_GetData(block);
+        HT_block_info* block_info = data + HT_MetadataOffset(ht_info);
+
+        counters[bucket - first].records += block_info->recNumber;
+        counters[bucket - first].blocks++;
+        temp = block_info->hashBucket;
+
+        CALL_OR_DIE(BF_UnpinBlockCounted(block));
+      }
+
+      ht_info->tableBlocks += counters[bucket - first].blocks;
+      if(counters[bucket - first].blocks > ht_info->maxChain){
+        ht_info->maxChain = counters[bucket - first].blocks;
+      }
+    }
+
+    BF_PoolUpdate(ht_info->fileDesc, counterId, (char*) counters);
+    BF_Block_SetDirty(counterBlock);
+    CALL_OR_DIE(BF_UnpinBlockCounted(counterBlock));
+  }
+
+  BF_Block_Destroy(&block);
+  BF_Block_Destroy(&counterBlock);
+}
+
+/**** Redo records of the write ahead log ****/
+
+typedef enum HT_RedoType{
+  HT_REDO_LINK,           // blockId became the first block of bucket, pointing to next
+  HT_REDO_RECORD,         // record was written at slot of blockId
+  HT_REDO_REHASH,         // A rehash into bucket buckets with the hash seed next started, blockId keeps the old table
+  HT_REDO_MOVED,          // The records of bucket of the old table were moved, its blocks were emptied
+  HT_REDO_REHASHED        // Every bucket of the old table was moved
+}HT_RedoType;
+
+typedef struct{
+  HT_RedoType type;
+  int blockId;
+  int bucket;
+  int next;
+  int slot;               // A link, rehash, moved or rehashed record ends here
+  Record record;
+}HT_redo;
+
+// Gets block blockId, allocating the blocks up to it that never reached the file
+static void HT_EnsureBlock(HT_info* ht_info, int blockId, BF_Block* block){
+  int blocks;
+  void* data;
+
+  CALL_OR_DIE(BF_GetBlockCounter(ht_info->fileDesc, &blocks));
+  while(blocks <= blockId){
+    CALL_OR_DIE(BF_AllocateBlockCounted(ht_info->fileDesc, block));
+    data = BF_Block_GetData(block);
+    HT_block_info* block_info = data + HT_MetadataOffset(ht_info);
+    block_info->recNumber = 0;
+    block_info->hashBucket = -1;
+    BF_ChecksumSeal(ht_info->fileDesc, blocks, data);
+    BF_Block_SetDirty(block);
+    CALL_OR_DIE(BF_UnpinBlockCounted(block));
+    blocks++;
+  }
+
+  CALL_OR_DIE(BF_GetBlockCounted(ht_info->fileDesc, blockId, block));
+}
+
+// Gets block blockId and fills it with 0, a block of 0 reads as a data block without records
+// reused: a directory block that is a data block of no bucket from now on, it gets a checksum already
+static void HT_ZeroBlock(HT_info* ht_info, int blockId, BF_Block* block, int reused){
+  HT_EnsureBlock(ht_info, blockId, block);
+  memset(BF_Block_GetData(block), 0, BF_BLOCK_SIZE);
+  if(reused){
+    BF_ChecksumSealReused(ht_info->fileDesc, BF_Block_GetData(block));
+  }
+  BF_PoolUpdate(ht_info->fileDesc, blockId, BF_Block_GetData(block));
+  BF_Block_SetDirty(block);
+  CALL_OR_DIE(BF_UnpinBlockCounted(block));
+}
+
+/**** Online rehash (the old table is kept in block rehashBlock while its buckets are moved) ****/
+
+typedef struct{
+  int buckets;            // Of the old table
+  int hashSeed;
+  int next;               // The buckets before it are moved already
+  int blocks;             // Of the old table when the rehash began, its records not moved yet are in at most this many
+  int heads[];            // First block of every bucket of the old table
+}HT_rehash;
+
+static double skewThreshold = 0;
+
+// Block rehashBlock gets the old table, the filters and counters of the new one follow it
+// The old filters and counters are emptied, lookups of the buckets not moved yet walk their chains
+static void HT_RehashBegin(HT_info* ht_info, int rehashBlock, int buckets, int seed){
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+
+  HT_EnsureBlock(ht_info, rehashBlock, block);
+  HT_rehash* rehash = (HT_rehash*) BF_Block_GetData(block);
+  memset(rehash, 0, BF_BLOCK_SIZE);
+  rehash->buckets = ht_info->numBuckets;
+  rehash->hashSeed = ht_info->hashSeed;
+  rehash->next = 0;
+  rehash->blocks = ht_info->tableBlocks;
+  for(int i = 0; i < ht_info->numBuckets; i++){
+    rehash->heads[i] = ht_info->hashTable[i];
+  }
+  BF_PoolUpdate(ht_info->fileDesc, rehashBlock, (char*) rehash);
+  BF_Block_SetDirty(block);
+  CALL_OR_DIE(BF_UnpinBlockCounted(block));
+
+  int oldFirst = ht_info->filterHashes > 0 ? ht_info->filterBlock : ht_info->counterBlock;
+  int oldEnd = ht_info->counterBlock + HT_CounterBlocks(ht_info->numBuckets);
+  for(int i = oldFirst; i < oldEnd; i++){
+    HT_ZeroBlock(ht_info, i, block, 1);
+  }
+
+  ht_info->numBuckets = buckets;
+  ht_info->hashSeed = seed;
+  ht_info->rehashBlock = rehashBlock;
+  ht_info->filterBlock = rehashBlock + 1;
+  ht_info->counterBlock = ht_info->filterBlock + (ht_info->filterHashes > 0 ? buckets : 0);
+  int end = ht_info->counterBlock + HT_CounterBlocks(buckets);
+  for(int i = ht_info->filterBlock; i < end; i++){
+    HT_ZeroBlock(ht_info, i, block, 0);
+  }
+  if(end - 1 > ht_info->lastBlockId){
+    ht_info->lastBlockId = end - 1;
+  }
+
+  for(int i = 0; i < buckets; i++){
+    ht_info->hashTable[i] = -1;
+  }
+  ht_info->maxChain = 0;
+  ht_info->tableBlocks = 0;
+
+  BF_Block_Destroy(&block);
+}
+
+// Empties the blocks of bucket of the old table, once its records are in the new one
+// They are never reused, a replay of the log walks the chain of the bucket again through them, so the file keeps them
+static void HT_RehashMoved(HT_info* ht_info, HT_rehash* rehash, int bucket){
   void* data;
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+
+  int temp = rehash->heads[bucket];
+  while(temp != -1){
+    CALL_OR_DIE(BF_GetBlockCounted(ht_info->fileDesc, temp, block));
+    data = BF_Block_GetData(block);
+    HT_block_info* block_info = data + HT_MetadataOffset(ht_info);
+
+    block_info->recNumber = 0;    // hashBucket stays, a replay of the log walks the chain again
+    BF_ChecksumSeal(ht_info->fileDesc, temp, data);
+    BF_PoolUpdate(ht_info->fileDesc, temp, data);
+    temp = block_info->hashBucket;
+
+    BF_Block_SetDirty(block);
+    CALL_OR_DIE(BF_UnpinBlockCounted(block));
+  }
+  if(rehash->next <= bucket){
+    rehash->next = bucket + 1;
+  }
+
+  BF_Block_Destroy(&block);
+}
+
+static void HT_RehashEnd(HT_info* ht_info){
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+  HT_ZeroBlock(ht_info, ht_info->rehashBlock, block, 1);
+  BF_Block_Destroy(&block);
+
+  ht_info->rehashBlock = 0;
+}
+
+// First block of the bucket of value in the old table, -1 if it was moved already or there is no rehash
+static int HT_RehashHead(HT_info* ht_info, int value){
+  int head = -1;
+  char* data;
+  BF_Block* block;
+
+  if(ht_info->rehashBlock == 0){
+    return -1;
+  }
+
+  BF_Block_Init(&block);
+  CALL_OR_DIE(BF_GetBlockData(ht_info->fileDesc, ht_info->rehashBlock, block, &data));   // Works for mapped files too
+
+  HT_rehash* rehash = (HT_rehash*) data;
+  int bucket = HT_Function(value, rehash->buckets, rehash->hashSeed);
+  if(bucket >= rehash->next){
+    head = rehash->heads[bucket];
+  }
+
+  CALL_OR_DIE(BF_ReleaseBlock(ht_info->fileDesc, block));
+  BF_Block_Destroy(&block);
 
-  CALL_OR_DIE(BF_GetBlock(ht_info->fileDesc, ht_info->lastBlockId, block));
+  return head;
+}
+
+// Applying a redo record twice gives the same block, so the log can be replayed over any mix of written blocks
+static void HT_Redo(void* context, const void* payload, int length){
+  HT_info* ht_info = context;
+  const HT_redo* redo = payload;
+  (void) length;    // The type of the redo record tells how much of it was logged
+
+  void* data;
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+
+  if(redo->type == HT_REDO_REHASH){
+    if(ht_info->rehashBlock != redo->blockId){
+      HT_RehashBegin(ht_info, redo->blockId, redo->bucket, redo->next);
+    }
+    BF_Block_Destroy(&block);
+    return;
+  }
+  if(redo->type == HT_REDO_REHASHED){
+    if(ht_info->rehashBlock != 0){
+      HT_RehashEnd(ht_info);
+    }
+    BF_Block_Destroy(&block);
+    return;
+  }
+
+  HT_EnsureBlock(ht_info, redo->blockId, block);
   data = BF_Block_GetData(block);
+  HT_block_info* block_info = data + HT_MetadataOffset(ht_info);
+
+  if(redo->type == HT_REDO_MOVED){
+    HT_RehashMoved(ht_info, data, redo->bucket);    // blockId is the block of the old table
+  }else if(redo->type == HT_REDO_LINK){
+    block_info->hashBucket = redo->next;
+    ht_info->hashTable[redo->bucket] = redo->blockId;
+    if(redo->blockId > ht_info->lastBlockId){
+      ht_info->lastBlockId = redo->blockId;
+    }
+  }else{
+    memcpy(data + redo->slot * sizeof(Record), &redo->record, sizeof(Record));
+    if(block_info->recNumber <= redo->slot){
+      block_info->recNumber = redo->slot + 1;
+    }
+  }
+  BF_ChecksumSeal(ht_info->fileDesc, redo->blockId, data);    // The rehash block of a moved record has none
+  BF_PoolUpdate(ht_info->fileDesc, redo->blockId, data);
+
+  BF_Block_SetDirty(block);
+  CALL_OR_DIE(BF_UnpinBlockCounted(block));
+  BF_Block_Destroy(&block);
+
+  if(redo->type == HT_REDO_RECORD && ht_info->filterHashes > 0){
+    HT_FilterAdd(ht_info, HT_Function(redo->record.id, ht_info->numBuckets, ht_info->hashSeed), redo->record.id);
+  }
+}
+
+/**** Initialize block_info ****/
+
+static HT_block_info* HT_MetadataBlockInitialize(HT_info* ht_info, BF_Block* block){
+  void* data = BF_Block_GetData(block);
 
   // No need to memcopy to initializing, having pointer to our struct 
   HT_block_info* block_info = data + HT_MetadataOffset(ht_info);
@@ -58,40 +514,289 @@ static HT_block_info* HT_MetadataBlockInitialize(HT_info* ht_info, BF_Block* blo
   return block_info;
 }
 
+/**** Inserts ****/
+
+// Appends an empty block to the file and returns its number, the block is pinned in block
+// Inserts into every bucket allocate, the file latch keeps lastBlockId in step with the blocks of the file
+static int HT_AllocateBlock(HT_info* ht_info, BF_Block* block){
+  BF_LatchFile(ht_info->fileDesc);
+  CALL_OR_DIE(BF_AllocateBlockCounted(ht_info->fileDesc, block));
+  HT_MetadataBlockInitialize(ht_info, block);   // Before a page scan can see it in lastBlockId
+  int blockId = ++ht_info->lastBlockId;
+  BF_UnlatchFile(ht_info->fileDesc);
+
+  return blockId;
+}
+
+// Puts record in the bucket of the current table, with its redo records, filter and counters
+// Called with the bucket latched exclusive (or the directory for a rehash step)
+static int HT_Place(HT_info* ht_info, Record record){
+  void* data;
+  HT_block_info* block_info;
+
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+
+  int hash = HT_Function(record.id, ht_info->numBuckets, ht_info->hashSeed);
+  int previousHead = ht_info->hashTable[hash];
+  int blockId = previousHead;
+
+  /**** The first block of the bucket if the record fits in it, else a new block in front of the chain ****/
+
+  if(blockId != -1){
+    CALL_OR_DIE(BF_GetBlockCounted(ht_info->fileDesc, blockId, block));
+    block_info = (void*) BF_Block_GetData(block) + HT_MetadataOffset(ht_info);
+
+    if(block_info->recNumber == ht_info->maxBlockRecs){
+      CALL_OR_DIE(BF_UnpinBlockCounted(block));
+      blockId = -1;
+    }
+  }
+  if(blockId == -1){
+    blockId = HT_AllocateBlock(ht_info, block);
+    block_info = (void*) BF_Block_GetData(block) + HT_MetadataOffset(ht_info);
+    block_info->hashBucket = previousHead;
+  }
+  data = BF_Block_GetData(block);
+
+  /**** The record and its redo records under the BF lock, written before any other BF call so the changed blocks
+        cannot reach the file first. SHT lookups read the block without the bucket latch and the log has every bucket ****/
+
+  BF_Lock();
+  memcpy(data + HT_RecordOffset(block_info), &record, sizeof(Record));
+  block_info->recNumber++;
+  ht_info->hashTable[hash] = blockId;
+
+  HT_redo redo;
+  redo.blockId = blockId;
+  if(blockId != previousHead){   // A new block was allocated for the bucket
+    redo.type = HT_REDO_LINK;
+    redo.bucket = hash;
+    redo.next = previousHead;
+    WAL_Log(ht_info->fileDesc, &redo, offsetof(HT_redo, slot));
+  }
+  redo.type = HT_REDO_RECORD;
+  redo.slot = block_info->recNumber - 1;
+  redo.record = record;
+  WAL_Log(ht_info->fileDesc, &redo, sizeof(HT_redo));
+  WAL_Write(ht_info->fileDesc);
+
+  BF_ChecksumSeal(ht_info->fileDesc, blockId, data);
+  BF_PoolUpdate(ht_info->fileDesc, blockId, data);
+  BF_Block_SetDirty(block);
+  CALL_OR_DIE(BF_UnpinBlockCounted(block));
+  BF_Unlock();
+  BF_Block_Destroy(&block);
+
+  if(ht_info->filterHashes > 0){
+    HT_FilterAdd(ht_info, hash, record.id);
+  }
+  HT_CountersAdd(ht_info, hash, blockId != previousHead);
+
+  return blockId;
+}
+
+/**** Rehash steps of the inserts ****/
+
+// A rehash starts when an insert leaves the longest chain skewThreshold times longer than the average one
+// It doubles the buckets (as many as block 0 can have) and changes the hash seed, so it stops once both are done
+static int HT_ShouldRehash(HT_info* ht_info){
+  if(skewThreshold <= 0 || ht_info->rehashBlock != 0 || (ht_info->flags & HT_FLAG_INDEXED)){
+    return 0;
+  }
+  if(ht_info->numBuckets >= HT_MaxBuckets() && ht_info->hashSeed != 0){
+    return 0;
+  }
+
+  BF_LatchFile(ht_info->fileDesc);   // The counters change with the inserts into every bucket
+  int skewed = ht_info->maxChain >= HT_REHASH_MIN_CHAIN && (double) ht_info->maxChain * ht_info->numBuckets > skewThreshold * ht_info->tableBlocks;
+  BF_UnlatchFile(ht_info->fileDesc);
+
+  return skewed;
+}
+
+static void HT_RehashStart(HT_info* ht_info){
+  int buckets = ht_info->numBuckets * 2 < HT_MaxBuckets() ? ht_info->numBuckets * 2 : HT_MaxBuckets();
+
+  HT_redo redo;
+  redo.type = HT_REDO_REHASH;
+  redo.blockId = ht_info->lastBlockId + 1;
+  redo.bucket = buckets;
+  redo.next = ht_info->hashSeed + 1;
+  WAL_Log(ht_info->fileDesc, &redo, offsetof(HT_redo, slot));
+  WAL_Write(ht_info->fileDesc);
+
+  HT_RehashBegin(ht_info, redo.blockId, redo.bucket, redo.next);
+}
+
+// Moves the next bucket of the old table, its records are put in the new table before its blocks are emptied
+static void HT_RehashStep(HT_info* ht_info){
+  void* data;
+  BF_Block* block;
+  BF_Block* rehashBlock;
+  Record records[ht_info->maxBlockRecs];
+
+  BF_Block_Init(&block);
+  BF_Block_Init(&rehashBlock);
+  CALL_OR_DIE(BF_GetBlockCounted(ht_info->fileDesc, ht_info->rehashBlock, rehashBlock));
+  HT_rehash* rehash = (HT_rehash*) BF_Block_GetData(rehashBlock);
+
+  int bucket = rehash->next;
+  int temp = rehash->heads[bucket];
+  while(temp != -1){
+    CALL_OR_DIE(BF_GetBlockCounted(ht_info->fileDesc, temp, block));
+    data = BF_Block_GetData(block);
+    HT_block_info* block_info = data + HT_MetadataOffset(ht_info);
+
+    int count = block_info->recNumber;
+    memcpy(records, data, count * sizeof(Record));
+    temp = block_info->hashBucket;
+    CALL_OR_DIE(BF_UnpinBlockCounted(block));
+
+    for(int i = 0; i < count; i++){
+      HT_Place(ht_info, records[i]);
+    }
+  }
+
+  HT_redo redo;
+  redo.type = HT_REDO_MOVED;
+  redo.blockId = ht_info->rehashBlock;
+  redo.bucket = bucket;
+  WAL_Log(ht_info->fileDesc, &redo, offsetof(HT_redo, slot));
+  int finished = bucket + 1 == rehash->buckets;
+  if(finished){
+    redo.type = HT_REDO_REHASHED;
+    WAL_Log(ht_info->fileDesc, &redo, offsetof(HT_redo, slot));
+  }
+  WAL_Write(ht_info->fileDesc);
+
+  HT_RehashMoved(ht_info, rehash, bucket);
+  BF_PoolUpdate(ht_info->fileDesc, ht_info->rehashBlock, (char*) rehash);
+  BF_Block_SetDirty(rehashBlock);
+  CALL_OR_DIE(BF_UnpinBlockCounted(rehashBlock));
+
+  if(finished){
+    HT_RehashEnd(ht_info);
+  }
+
+  BF_Block_Destroy(&block);
+  BF_Block_Destroy(&rehashBlock);
+}
+
+/**** Lookups ****/
+
+// Prints the first record with id value of the chain that starts at block first, adding the blocks read before it to total
+// Return 1 if there was one, 0 if not
+static int HT_Search(HT_info* ht_info, int first, int value, int* total){
+  void* data;
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+
+  int temp = first;   // To go from block to block need to take a temporary because we cant change hashTable value at the end of the loop
+  while(temp != -1){
+    CALL_OR_DIE(BF_GetBlockData(ht_info->fileDesc, temp, block, (char**) &data));   // Works for mapped files too
+
+    Record* record = data;
+    HT_block_info* block_info = data + HT_MetadataOffset(ht_info);
+
+    for(int i = 0; i < block_info->recNumber; i++){
+      if(record->id == value){
+        printRecord(*record);
+
+        CALL_OR_DIE(BF_ReleaseBlock(ht_info->fileDesc, block));  // Unpin for not having memory leaks
+        BF_Block_Destroy(&block);
+
+        return 1;
+      }
+      record = data + sizeof(Record) * (i + 1); // Going to the next record of the block
+    }
+    (*total)++;
+
+    temp = block_info->hashBucket;    // Going from hashbucket to hashbucket until its over (hashbucket == -1), read before the frame can go
+    CALL_OR_DIE(BF_ReleaseBlock(ht_info->fileDesc, block));
+  }
+
+  BF_Block_Destroy(&block);
+
+  return 0;
+}
+
+int HT_IsDirectoryBlock(HT_info* ht_info, int blockId){
+  if(blockId == 0 || blockId == ht_info->rehashBlock){
+    return 1;
+  }
+  if(ht_info->filterHashes > 0 && blockId >= ht_info->filterBlock && blockId < ht_info->filterBlock + ht_info->numBuckets){
+    return 1;
+  }
+
+  return blockId >= ht_info->counterBlock && blockId < ht_info->counterBlock + HT_CounterBlocks(ht_info->numBuckets);
+}
+
+// The blocks that are not directory blocks keep records, so they have a checksum (see bf_checksum.h)
+static int HT_IsDataBlock(void* context, int block_num){
+  return !HT_IsDirectoryBlock(context, block_num);
+}
+
 /**** HashTable functions ****/
 
 int HT_CreateFile(char *fileName,  int buckets){
+  TRACE_FUNCTION();
+  return HT_CreateFileWithFilter(fileName, buckets, 0);
+}
+
+int HT_CreateFileWithFilter(char *fileName, int buckets, double falsePositiveRate){
+  TRACE_FUNCTION();
   int file;
   void* data;
   BF_Block* block;
 
   BF_Block_Init(&block);
   CALL_OR_DIE(BF_CreateFile(fileName));
+  WAL_Discard(fileName);    // A log left by an older file with this name is not ours
   CALL_OR_DIE(BF_OpenFile(fileName, &file));
 
   CALL_OR_DIE(BF_AllocateBlock(file, block));
   data = BF_Block_GetData(block);
 
-  memcpy(data, string, strlen(string) + 1);
-
-  // No need to memcopy to initializing, having pointer to our structs 
-  HT_info* ht_info = data + HT_InfoOffset();
+  HT_info* ht_info = malloc(sizeof(HT_info) + buckets * sizeof(int));
   ht_info->blockId = 0;
   ht_info->lastBlockId = 0;
+  ht_info->scans = 0;
   ht_info->fileDesc = file;
   ht_info->numBuckets = buckets;
   ht_info->maxBlockRecs = (BF_BLOCK_SIZE - sizeof(HT_block_info))/sizeof(Record);
-  ht_info->hashTable[buckets];
+  ht_info->filterHashes = BLOOM_HashFunctions(falsePositiveRate);
+  ht_info->filterBlock = 1;
+  ht_info->hashSeed = 0;
+  ht_info->maxChain = 0;
+  ht_info->tableBlocks = 0;
+  ht_info->rehashBlock = 0;
+  ht_info->flags = BF_ChecksumEnabled() ? HT_FLAG_CHECKSUMS : 0;
+  if(ht_info->filterHashes > 0){
+    ht_info->lastBlockId = buckets;   // Blocks 1 - buckets are the filters, data blocks start after them
+  }
+  ht_info->counterBlock = ht_info->lastBlockId + 1;   // Then the counters
+  ht_info->lastBlockId += HT_CounterBlocks(buckets);
   for(int i = 0; i < buckets; i++){
     ht_info->hashTable[i] = -1;
   }
+  HT_EncodeHeader(ht_info, data);     // The string that identifies a hashtable file comes first
 
-  HT_block_info* block_info = data + HT_BlockInfoOffset(ht_info);
-  block_info->recNumber = 0;
-  block_info->hashBucket = -1;    
+  int directoryBlocks = ht_info->lastBlockId;
+  free(ht_info);
 
   BF_Block_SetDirty(block);
   CALL_OR_DIE(BF_UnpinBlock(block));
+
+  for(int i = 0; i < directoryBlocks; i++){  // One empty filter block per bucket, then the counters all 0
+    CALL_OR_DIE(BF_AllocateBlock(file, block));
+    memset(BF_Block_GetData(block), 0, BF_BLOCK_SIZE);
+    BF_Block_SetDirty(block);
+    CALL_OR_DIE(BF_UnpinBlock(block));
+  }
+
   BF_Block_Destroy(&block);
   CALL_OR_DIE(BF_CloseFile(file));
 
@@ -99,6 +804,7 @@ int HT_CreateFile(char *fileName,  int buckets){
 }
 
 HT_info* HT_OpenFile(char *fileName){
+  TRACE_FUNCTION();
   int file;
   void* data;
   BF_Block* block;
@@ -108,152 +814,319 @@ HT_info* HT_OpenFile(char *fileName){
   BF_PrintError(BF_GetBlock(file, 0, block));
   data = BF_Block_GetData(block);
 
-  if(strcmp(data, string) != 0){              // This must be a hashtable file
+  // ht_info is ours until HT_CloseFile writes it back, so the inserts update it without getting block 0
+  HT_info* ht_info = HT_DecodeHeader(data);     // This must be a hashtable file
+  CALL_OR_DIE(BF_UnpinBlock(block));
+  BF_Block_Destroy(&block);
+
+  if(ht_info == NULL){
     printf("This is not a Hashtable file.\n");
-    CALL_OR_DIE(BF_UnpinBlock(block));
-    BF_Block_Destroy(&block);
     CALL_OR_DIE(BF_CloseFile(file));
     return NULL;
   }
+  ht_info->fileDesc = file;
+  HT_Opened(ht_info, fileName);
+
+  BF_PoolAttach(fileName, file);
+  BF_ChecksumAttach(file, HT_IsDataBlock, ht_info, 0);   // Strict after the replay, see below
+
+  // Replaying what a crash left in the log, the header on disk is the one of the last clean close
+  // because only HT_CloseFile writes the header
+  WAL_Attach(fileName, file);
+  int redone = WAL_Replay(file, HT_Redo, ht_info);
+  if(redone > 0){
+    printf("Recovered %d log records of %s.\n", redone, fileName);
+    HT_CountersRebuild(ht_info);
+  }
+  // The log may be replayed over blocks that never reached the file (0 at the end), they have their checksums now
+  BF_ChecksumAttach(file, HT_IsDataBlock, ht_info, ht_info->flags & HT_FLAG_CHECKSUMS);
 
-  HT_info* ht_info = data + HT_InfoOffset();
+  BF_PrefetchAttach(fileName, file);
+  BF_LatchAttach(file, HT_MaxBuckets());    // Room for the buckets of any rehash
 
-  BF_PrintError(BF_UnpinBlock(block));
-  BF_Block_Destroy(&block);
+  return ht_info;
+}
+
+HT_info* HT_OpenFileMapped(char *fileName){
+  TRACE_FUNCTION();
+  int file;
+  char* data;
+
+  if(BF_OpenFileMapped(fileName, &file) != BF_OK){
+    printf("Could not map the file %s.\n", fileName);
+    return NULL;
+  }
+  CALL_OR_DIE(BF_GetBlockData(file, 0, NULL, &data));
+
+  HT_info* ht_info = HT_DecodeHeader(data);     // This must be a hashtable file
+  if(ht_info == NULL){
+    printf("This is not a Hashtable file.\n");
+    CALL_OR_DIE(BF_CloseFileMapped(file));
+    return NULL;
+  }
+  ht_info->fileDesc = file;   // Never written back, the file stays as it is
+
+  BF_AdviseMapped(file, BF_ADVICE_RANDOM);  // Lookups read one bucket chain, reading ahead is wasted
+  BF_ChecksumAttach(file, HT_IsDataBlock, ht_info, ht_info->flags & HT_FLAG_CHECKSUMS);
 
   return ht_info;
 }
 
-int HT_CloseFile(HT_info* ht_info){
-  CALL_OR_DIE(BF_CloseFile(ht_info->fileDesc));
-  
-  return HT_OK;
+static int HT_EnvClose(void* ht_info){
+  return HT_CloseFile(ht_info);
 }
 
-int HT_InsertEntry(HT_info* ht_info, Record record){
-  void* data;
-  void* firstData;
+HT_info* HT_OpenFileEnv(BF_Env* env, char *fileName){
+  TRACE_FUNCTION();
+  if(BF_EnvUse(env, fileName) != BF_OK){
+    printf("Could not open the file %s in the env %s.\n", fileName, BF_EnvName(env));
+    return NULL;
+  }
+
+  HT_info* ht_info = HT_OpenFile(fileName);
+  if(ht_info != NULL && BF_EnvAdd(env, ht_info, HT_EnvClose) != BF_OK){
+    printf("The env %s has too many open files.\n", BF_EnvName(env));
+    HT_CloseFile(ht_info);
+    return NULL;
+  }
+
+  return ht_info;
+}
+
+int HT_CloseFile(HT_info* ht_info){
+  TRACE_FUNCTION();
+  BF_EnvRemove(ht_info);   // Nothing if it was opened in no env
+  BF_ChecksumDetach(ht_info->fileDesc);
+  if(BF_IsMappedFile(ht_info->fileDesc)){
+    CALL_OR_DIE(BF_CloseFileMapped(ht_info->fileDesc));
+    free(ht_info);
+    return HT_OK;
+  }
+
+  int file = ht_info->fileDesc;
+  HT_Closed(ht_info);
 
   BF_Block* block;
-  BF_Block* firstBlock;
-  
+
   BF_Block_Init(&block);
-  BF_Block_Init(&firstBlock);
-  
-  CALL_OR_DIE(BF_GetBlock(ht_info->fileDesc, 0, firstBlock));
-  firstData = BF_Block_GetData(firstBlock);
+  CALL_OR_DIE(BF_GetBlock(file, 0, block));   // ht_info is written back
+  HT_EncodeHeader(ht_info, BF_Block_GetData(block));
+  BF_Block_SetDirty(block);
+  CALL_OR_DIE(BF_UnpinBlock(block));
+  BF_Block_Destroy(&block);
 
-  int hash = HT_Function(record.id, ht_info->numBuckets);
+  BF_LatchDetach(file);
+  BF_PrefetchDetach(file);
+  BF_PoolDetach(file);
+  CALL_OR_DIE(BF_CloseFile(file));
+  int result = WAL_Detach(file) == 0 ? HT_OK : HT_ERROR;   // Only after every block is in the file
+  free(ht_info);
+  
+  return result;
+}
 
-  /**** Allocate block if the hashtable[hash] is empty or if it is full of records. Get the block if we can copy the record ****/
+int HT_InsertEntry(HT_info* ht_info, Record record){
+  TRACE_FUNCTION();
+  if(BF_IsMappedFile(ht_info->fileDesc)){
+    printf("The file is opened read only.\n");
+    return HT_ERROR;
+  }
 
-  if(ht_info->hashTable[hash] == -1){
-    CALL_OR_DIE(BF_AllocateBlock(ht_info->fileDesc, block));
-    ht_info->lastBlockId++;
+  int file = ht_info->fileDesc;
+
+  BF_LatchDirectory(file, BF_LATCH_SHARED);
+  int hash = HT_Function(record.id, ht_info->numBuckets, ht_info->hashSeed);
+  BF_LatchBucket(file, hash, BF_LATCH_EXCLUSIVE);
+  int blockId = HT_Place(ht_info, record);
+  BF_UnlatchBucket(file, hash);
+  int rehash = ht_info->rehashBlock != 0 || HT_ShouldRehash(ht_info);
+  BF_UnlatchDirectory(file);
+
+  if(rehash){   // The rehash moves one bucket with every insert, with the whole directory latched
+    BF_LatchDirectory(file, BF_LATCH_EXCLUSIVE);
+    if(__atomic_load_n(&ht_info->scans, __ATOMIC_SEQ_CST) > 0){
+      // A page scan is running, a later insert moves the bucket
+    }else if(ht_info->rehashBlock != 0){
+      HT_RehashStep(ht_info);
+    }else if(HT_ShouldRehash(ht_info)){   // Another insert may have started it while we waited
+      HT_RehashStart(ht_info);
+    }
+    BF_UnlatchDirectory(file);
+  }
 
-    CALL_OR_DIE(BF_GetBlock(ht_info->fileDesc, ht_info->lastBlockId, block));
-    data = BF_Block_GetData(block);
+  return blockId;
+}
 
-    HT_block_info* block_info = HT_MetadataBlockInitialize(ht_info, block); // Initialize via function
+int HT_ScanPages(HT_info* ht_info, Record_PageVisitor visitor, void* context){
+  TRACE_FUNCTION();
+  int total = 0;
 
-    ht_info->hashTable[hash] = ht_info->lastBlockId;
-    memcpy(data + HT_RecordOffset(block_info), &record, sizeof(Record));
+  char* data;
+  BF_Block* block;
+  Record* records = malloc(ht_info->maxBlockRecs * sizeof(Record));
+  if(records == NULL){
+    return HT_ERROR;
+  }
 
-    block_info->recNumber++;
-  }else{
-    CALL_OR_DIE(BF_GetBlock(ht_info->fileDesc, ht_info->hashTable[hash], block));
-    data = BF_Block_GetData(block);
+  // No rehash moves the records while the scan runs (the inserts put their steps off), and the latch is not held
+  // while visitor runs, so it may look up or insert into the same file
+  BF_LatchDirectory(ht_info->fileDesc, BF_LATCH_SHARED);
+  __atomic_add_fetch(&ht_info->scans, 1, __ATOMIC_SEQ_CST);
+  BF_LatchFile(ht_info->fileDesc);
+  int lastBlockId = ht_info->lastBlockId;   // Blocks added by the inserts after this are not visited
+  BF_UnlatchFile(ht_info->fileDesc);
+  BF_UnlatchDirectory(ht_info->fileDesc);
 
-    HT_block_info* block_info = data + HT_MetadataOffset(ht_info);
-    
-    if(block_info->recNumber == ht_info->maxBlockRecs){
-      BF_Block_SetDirty(block);
-      CALL_OR_DIE(BF_UnpinBlock(block));
+  BF_Block_Init(&block);
 
-      CALL_OR_DIE(BF_AllocateBlock(ht_info->fileDesc, block));
-      ht_info->lastBlockId++;
+  // Every block but block 0 and the directory blocks is a data block of some bucket, so they are read in file order
+  // Blocks emptied by a rehash and the directory blocks of older tables are filled with 0 and have no records
+  for(int temp = 1; temp <= lastBlockId; temp++){
+    if(HT_IsDirectoryBlock(ht_info, temp)){
+      continue;
+    }
 
-      CALL_OR_DIE(BF_GetBlock(ht_info->fileDesc, ht_info->lastBlockId, block));
-      data = BF_Block_GetData(block);
+    BF_PrefetchAccess(ht_info->fileDesc, temp);
+    CALL_OR_DIE(BF_GetBlockData(ht_info->fileDesc, temp, block, &data));   // Works for mapped files too
 
-      block_info = HT_MetadataBlockInitialize(ht_info, block);
+    BF_Lock();    // The inserts change the block under the BF lock, the visitor gets a copy
+    HT_block_info* block_info = (void*) data + HT_MetadataOffset(ht_info);
+    int count = block_info->recNumber;
+    memcpy(records, data, count * sizeof(Record));
+    BF_Unlock();
 
-      data = BF_Block_GetData(block);
-      block_info->hashBucket = ht_info->hashTable[hash];  // Update hasbucket before hashtable[hash] change it's value
-      ht_info->hashTable[hash] = ht_info->lastBlockId;    // And then update the hashtable[hash] to the last block we are
+    CALL_OR_DIE(BF_ReleaseBlock(ht_info->fileDesc, block));
 
-      memcpy(data + HT_RecordOffset(block_info), &record, sizeof(Record));
-      block_info->recNumber++;
-    }else{
-      memcpy(data + HT_RecordOffset(block_info), &record, sizeof(Record));
-      block_info->recNumber++;
-    }
+    visitor(context, records, count);
+    total++;
   }
 
-  BF_Block_SetDirty(block);
-  BF_Block_SetDirty(firstBlock);
-  CALL_OR_DIE(BF_UnpinBlock(block));
-  CALL_OR_DIE(BF_UnpinBlock(firstBlock));
+  __atomic_sub_fetch(&ht_info->scans, 1, __ATOMIC_SEQ_CST);
   BF_Block_Destroy(&block);
-  BF_Block_Destroy(&firstBlock);
+  free(records);
 
-  return ht_info->hashTable[hash];
+  return total;
 }
 
-int HT_GetAllEntries(HT_info* ht_info, int value){
+// HT_GetAllEntries with the bucket of value latched
+static int HT_Lookup(HT_info* ht_info, int hash, int value){
   int total = 0;
-  int noEntry = 0;
-
-  void* data;
-  
-  BF_Block* block;
 
-  BF_Block_Init(&block);
-
-  int hash = HT_Function(value, ht_info->numBuckets);
+  int oldHead = HT_RehashHead(ht_info, value);    // While a rehash moves the buckets, value may still be in the old table
 
-  if(ht_info->hashTable[hash] == -1){             // Check before get_block if a block exists
+  if(ht_info->hashTable[hash] == -1 && oldHead == -1){   // Check before get_block if a block exists
     printf("There is no entry with this id.\n");
     return -1;
   }
 
-  int temp = ht_info->hashTable[hash];  // To go from block to block need to take a temporary because we cant change hashTable value at the end of the loop
-  while(1){
-    CALL_OR_DIE(BF_GetBlock(ht_info->fileDesc, temp, block));
-    data = BF_Block_GetData(block);
+  // The filter knows it without reading the bucket
+  if(ht_info->hashTable[hash] != -1 && (ht_info->filterHashes == 0 || HT_FilterMayContain(ht_info, hash, value))){
+    if(HT_Search(ht_info, ht_info->hashTable[hash], value, &total)){
+      return total;
+    }
+  }
+  if(oldHead != -1 && HT_Search(ht_info, oldHead, value, &total)){
+    return total;
+  }
 
-    Record* record = data;
-    HT_block_info* block_info = data + HT_MetadataOffset(ht_info);
+  printf("There is no entry with this id.\n");
 
-    for(int i = 0; i < block_info->recNumber; i++){
-      if(record->id == value){
-        printRecord(*record);
+  return total;
+}
 
-        CALL_OR_DIE(BF_UnpinBlock(block));  // Unpin for not having memory leaks
-        BF_Block_Destroy(&block);
+int HT_GetAllEntries(HT_info* ht_info, int value){
+  TRACE_FUNCTION();
+  int file = ht_info->fileDesc;
+
+  BF_LatchDirectory(file, BF_LATCH_SHARED);
+  int hash = HT_Function(value, ht_info->numBuckets, ht_info->hashSeed);
+  BF_LatchBucket(file, hash, BF_LATCH_SHARED);
+  int total = HT_Lookup(ht_info, hash, value);
+  BF_UnlatchBucket(file, hash);
+  BF_UnlatchDirectory(file);
+
+  return total;
+}
 
-        return total;
+void HT_SetSkewThreshold(double threshold){
+  skewThreshold = threshold;
+}
+
+int HT_MarkIndexed(char* fileName){
+  TRACE_FUNCTION();
+  int file;
+  int opened = 0;
+  int rehashing = 0;
+  BF_Block* block;
 
-        noEntry++;
+  pthread_mutex_lock(&openLock);    // An open HT_info is newer than the header on disk and is written back on close
+  for(int i = 0; i < BF_MAX_OPEN_FILES; i++){
+    if(openInfos[i] != NULL && strcmp(openNames[i], fileName) == 0){
+      BF_LatchDirectory(i, BF_LATCH_EXCLUSIVE);   // A rehash starts with the directory latched exclusively
+      if(openInfos[i]->rehashBlock != 0){
+        rehashing = 1;
+      }else{
+        openInfos[i]->flags |= HT_FLAG_INDEXED;
       }
-      record = data + sizeof(Record) * (i + 1); // Going to the next record of the block
+      BF_UnlatchDirectory(i);
+      opened = 1;
     }
-    total++;
+  }
+  pthread_mutex_unlock(&openLock);
 
-    CALL_OR_DIE(BF_UnpinBlock(block));
+  BF_Block_Init(&block);
+  CALL_OR_DIE(BF_OpenFile(fileName, &file));
+  CALL_OR_DIE(BF_GetBlock(file, 0, block));
 
-    if(block_info->hashBucket == -1){
-      break;
-    }
-    
-    temp = block_info->hashBucket;    // Going from hashbucket to hashbucket until its over (hashbucket == -1)
+  HT_info* ht_info = HT_DecodeHeader(BF_Block_GetData(block));
+  if(ht_info != NULL && !opened){
+    rehashing = ht_info->rehashBlock != 0;
   }
 
-  if(noEntry == 0){
-    printf("There is no entry with this id.\n");
+  if(ht_info == NULL){
+    printf("This is not a Hashtable file.\n");
+  }else if(rehashing){
+    printf("A rehash of %s is in progress, it can be indexed once it is done.\n", fileName);
+  }else{
+    ht_info->flags |= HT_FLAG_INDEXED;
+    HT_EncodeHeader(ht_info, BF_Block_GetData(block));
+    BF_Block_SetDirty(block);
   }
-  
+  int marked = ht_info != NULL && !rehashing;
+  free(ht_info);
+
+  CALL_OR_DIE(BF_UnpinBlock(block));
   BF_Block_Destroy(&block);
+  CALL_OR_DIE(BF_CloseFile(file));
 
-  return total;
-}
\ No newline at end of file
+  return marked ? HT_OK : HT_ERROR;
+}
+
+int HT_DataBlocks(HT_info* ht_info){
+  char* data;
+  BF_Block* block;
+
+  BF_LatchDirectory(ht_info->fileDesc, BF_LATCH_SHARED);   // No rehash begins or ends meanwhile
+  BF_LatchFile(ht_info->fileDesc);
+  int blocks = ht_info->tableBlocks;
+  BF_UnlatchFile(ht_info->fileDesc);
+
+  if(ht_info->rehashBlock != 0){
+    BF_Block_Init(&block);
+    CALL_OR_DIE(BF_GetBlockData(ht_info->fileDesc, ht_info->rehashBlock, block, &data));   // Works for mapped files too
+    blocks += ((HT_rehash*) data)->blocks;
+    CALL_OR_DIE(BF_ReleaseBlock(ht_info->fileDesc, block));
+    BF_Block_Destroy(&block);
+  }
+  BF_UnlatchDirectory(ht_info->fileDesc);
+
+  return blocks;
+}
+
+double HT_Skew(HT_info* ht_info){
+  BF_LatchFile(ht_info->fileDesc);
+  double skew = ht_info->tableBlocks == 0 ? 0 : (double) ht_info->maxChain * ht_info->numBuckets / ht_info->tableBlocks;
+  BF_UnlatchFile(ht_info->fileDesc);
+
+  return skew;
+}
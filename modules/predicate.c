@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "predicate.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+typedef unsigned int (*PRED_Kernel)(const char*, int, int, const Predicate*);
+
+/**** Slot helpers ****/
+
+static int PRED_Value(const char* records, int slot, int stride){
+  int value;
+
+  memcpy(&value, records + slot * stride, sizeof(int));   // Slots are not always aligned to int
+
+  return value;
+}
+
+int PRED_Check(int value, const Predicate* predicate){
+  switch(predicate->op){
+    case PRED_EQUAL:
+      return value == predicate->low;
+    case PRED_LESS:
+      return value < predicate->low;
+    case PRED_GREATER:
+      return value > predicate->low;
+    case PRED_BETWEEN:
+      return value >= predicate->low && value <= predicate->high;
+  }
+
+  return 0;
+}
+
+/**** Scalar kernel (any cpu) ****/
+
+static unsigned int PRED_ScalarKernel(const char* records, int count, int stride, const Predicate* predicate){
+  unsigned int mask = 0;
+
+  for(int i = 0; i < count; i++){
+    if(PRED_Check(PRED_Value(records, i, stride), predicate)){
+      mask |= 1u << i;
+    }
+  }
+
+  return mask;
+}
+
+#if defined(__x86_64__)
+
+/**** SSE2 kernel (every x86-64 cpu), 4 slots at a time ****/
+
+static unsigned int PRED_SSE2Kernel(const char* records, int count, int stride, const Predicate* predicate){
+  unsigned int mask = 0;
+
+  __m128i low = _mm_set1_epi32(predicate->low);
+  __m128i high = _mm_set1_epi32(predicate->high);
+
+  int i = 0;
+  for(; i + 4 <= count; i += 4){
+    __m128i values = _mm_setr_epi32(PRED_Value(records, i, stride), PRED_Value(records, i + 1, stride),
+                                    PRED_Value(records, i + 2, stride), PRED_Value(records, i + 3, stride));
+    __m128i result;
+
+    switch(predicate->op){
+      case PRED_EQUAL:
+        result = _mm_cmpeq_epi32(values, low);
+        break;
+      case PRED_LESS:
+        result = _mm_cmplt_epi32(values, low);
+        break;
+      case PRED_GREATER:
+        result = _mm_cmpgt_epi32(values, low);
+        break;
+      default:    // BETWEEN is "not below low and not above high"
+        result = _mm_andnot_si128(_mm_or_si128(_mm_cmplt_epi32(values, low), _mm_cmpgt_epi32(values, high)), _mm_set1_epi32(-1));
+        break;
+    }
+
+    mask |= (unsigned int) _mm_movemask_ps(_mm_castsi128_ps(result)) << i;
+  }
+
+  if(i < count){   // The slots that do not fill a whole vector
+    mask |= PRED_ScalarKernel(records + i * stride, count - i, stride, predicate) << i;
+  }
+
+  return mask;
+}
+
+/**** AVX2 kernel, 8 slots at a time with one gather ****/
+
+__attribute__((target("avx2")))
+static unsigned int PRED_AVX2Kernel(const char* records, int count, int stride, const Predicate* predicate){
+  unsigned int mask = 0;
+
+  __m256i low = _mm256_set1_epi32(predicate->low);
+  __m256i high = _mm256_set1_epi32(predicate->high);
+  __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  __m256i offsets = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(stride));
+
+  for(int i = 0; i < count; i += 8){
+    // Lanes after count are masked out of the gather, so we never read past the last slot of the page
+    __m256i active = _mm256_cmpgt_epi32(_mm256_set1_epi32(count - i), lanes);
+    __m256i values = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int*) (records + i * stride), offsets, active, 1);
+    __m256i result;
+
+    switch(predicate->op){
+      case PRED_EQUAL:
+        result = _mm256_cmpeq_epi32(values, low);
+        break;
+      case PRED_LESS:
+        result = _mm256_cmpgt_epi32(low, values);
+        break;
+      case PRED_GREATER:
+        result = _mm256_cmpgt_epi32(values, low);
+        break;
+      default:
+        result = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpgt_epi32(low, values), _mm256_cmpgt_epi32(values, high)), active);
+        break;
+    }
+
+    result = _mm256_and_si256(result, active);
+    mask |= (unsigned int) _mm256_movemask_ps(_mm256_castsi256_ps(result)) << i;
+  }
+
+  return mask;
+}
+
+#endif
+
+/**** Kernel selection (once, by what the cpu supports) ****/
+
+static PRED_Kernel kernel = NULL;
+static pthread_once_t kernelOnce = PTHREAD_ONCE_INIT;   // The parallel scan workers evaluate pages at the same time
+
+static void PRED_SelectKernel(void){
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2")){
+    kernel = PRED_AVX2Kernel;
+    return;
+  }
+  kernel = PRED_SSE2Kernel;
+#else
+  kernel = PRED_ScalarKernel;
+#endif
+}
+
+/**** Predicate functions ****/
+
+unsigned int PRED_EvaluatePage(const void* records, int count, int stride, int offset, const Predicate* predicate){
+  pthread_once(&kernelOnce, PRED_SelectKernel);
+
+  if(count > PRED_MAX_SLOTS){
+    count = PRED_MAX_SLOTS;
+  }
+
+  return kernel((const char*) records + offset, count, stride, predicate);
+}
@@ -46,6 +46,10 @@ const char* cities[] = {
   "Miami"
 };
 
+const int nameCount = sizeof(names) / sizeof(names[0]);
+const int surnameCount = sizeof(surnames) / sizeof(surnames[0]);
+const int cityCount = sizeof(cities) / sizeof(cities[0]);
+
 static int id = 0;
 
 Record randomRecord(){
@@ -53,21 +57,74 @@ Record randomRecord(){
   memcpy(record.record, "record", strlen("record") + 1);
   record.id = id++;
 
-  int r = rand() % 12;
+  int r = rand() % nameCount;
   memcpy(record.name, names[r], strlen(names[r]) + 1);
 
-  r = rand() % 12;
+  r = rand() % surnameCount;
   memcpy(record.surname, surnames[r], strlen(surnames[r]) + 1);
 
-  r = rand() % 10;
+  r = rand() % cityCount;
   memcpy(record.city, cities[r], strlen(cities[r]) + 1);
 
   return record;
 }
 
+static int printing = 1;
+
+void setRecordPrinting(int on){
+  printing = on;
+}
+
 void printRecord(Record record){
+  if(!printing){
+    return;
+  }
   printf("(%d,%s,%s,%s)\n",record.id,record.name,record.surname,record.city);
 }
 
+const void* recordKey(const Record* record, Record_Attribute attribute, int* length){
+  switch(attribute){
+    case ID:
+      *length = sizeof(record->id);
+      return &record->id;
+    case NAME:
+      *length = strnlen(record->name, sizeof(record->name));
+      return record->name;
+    case SURNAME:
+      *length = strnlen(record->surname, sizeof(record->surname));
+      return record->surname;
+    default:
+      *length = strnlen(record->city, sizeof(record->city));
+      return record->city;
+  }
+}
+
+int recordCompare(const Record* first, const Record* second, Record_Attribute attribute){
+  switch(attribute){
+    case ID:
+      return (first->id > second->id) - (first->id < second->id);
+    case NAME:
+      return strncmp(first->name, second->name, sizeof(first->name));
+    case SURNAME:
+      return strncmp(first->surname, second->surname, sizeof(first->surname));
+    default:
+      return strncmp(first->city, second->city, sizeof(first->city));
+  }
+}
+
+unsigned int recordHash(const Record* record, Record_Attribute attribute, unsigned int seed){
+  int length;
+  const unsigned char* key = recordKey(record, attribute, &length);
+  unsigned int hash = 2166136261u ^ (seed * 0x9e3779b9u);
 
+  for(int i = 0; i < length; i++){    // FNV-1a, then mixed so the low bits depend on every byte
+    hash ^= key[i];
+    hash *= 16777619u;
+  }
 
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+
+  return hash;
+}
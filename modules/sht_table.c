@@ -1,14 +1,31 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
+#include <pthread.h>
 
 #include "bf.h"
+#include "bf_prefetch.h"
+#include "bf_mapped.h"
 #include "record.h"
 #include "ht_table.h"
 #include "sht_table.h"
+#include "bloom_filter.h"
+#include "wal.h"
+#include "bf_pool.h"
+#include "bf_latch.h"
+#include "bf_checksum.h"
+#include "bf_header.h"
+#include "bf_env.h"
+#include "trace.h"
+
+#define SHT_REHASH_MIN_CHAIN 4    // Chains of fewer blocks are not worth a rehash, whatever the skew
+#define SHT_BUILD_MORSEL 8        // Hashtable blocks a worker of SHT_BuildFromPrimary takes at once
 
 #define CALL_OR_DIE(call){  \
+  BF_Lock();                \
   BF_ErrorCode code = call; \
+  BF_Unlock();              \
   if (code != BF_OK) {      \
     BF_PrintError(code);    \
     exit(code);             \
@@ -19,15 +36,10 @@
 
 static const char* string = "SHash file";
 
-/**** Offset functions  ****/
-
-static int SHT_InfoOffset(void){
-  return strlen(string) + 1;
-}
+#define SHT_HEADER_VERSION 2          // Version of the header in block 0, a file with another one is not opened
+#define SHT_HEADER_BYTES (4 + 10 * 4 + 8)  // The version, the int fields and numBuckets, then the table
 
-static int SHT_BlockInfoOffset(SHT_info* sht_info){
-  return SHT_InfoOffset() + sizeof(HT_info) + (sht_info->numBuckets * sizeof(int));
-}
+/**** Offset functions  ****/
 
 static int SHT_MetadataOffset(SHT_info* sht_info){
   return sht_info->maxBlockRecs * (sizeof(char) * 15 + sizeof(unsigned int));
@@ -41,12 +53,80 @@ static int SHT_RecordNameOffset(void){
   return sizeof(char) * 15;
 }
 
+static int SHT_MaxBuckets(void){
+  return (BF_BLOCK_SIZE - (int) strlen(string) - 1 - SHT_HEADER_BYTES) / (int) sizeof(int);
+}
+
+/**** Header (see bf_header.h) ****/
+
+static void SHT_EncodeHeader(SHT_info* sht_info, char* data){
+  BF_Header header;
+
+  BF_HeaderWrite(&header, data, string, SHT_HEADER_VERSION);
+  BF_HeaderPutInt(&header, sht_info->lastBlockId);
+  BF_HeaderPutInt(&header, sht_info->maxBlockRecs);
+  BF_HeaderPutInt(&header, sht_info->filterHashes);
+  BF_HeaderPutInt(&header, sht_info->filterBlock);
+  BF_HeaderPutInt(&header, sht_info->counterBlock);
+  BF_HeaderPutInt(&header, sht_info->hashSeed);
+  BF_HeaderPutInt(&header, sht_info->maxChain);
+  BF_HeaderPutInt(&header, sht_info->tableBlocks);
+  BF_HeaderPutInt(&header, sht_info->rehashBlock);
+  BF_HeaderPutInt(&header, sht_info->flags);
+  BF_HeaderPutLong(&header, sht_info->numBuckets);
+  for(int i = 0; i < sht_info->numBuckets; i++){
+    BF_HeaderPutInt(&header, sht_info->hashTable[i]);
+  }
+}
+
+SHT_info* SHT_DecodeHeader(const char* data){
+  BF_Header header;
+
+  if(BF_HeaderRead(&header, data, string) != SHT_HEADER_VERSION){
+    return NULL;
+  }
+
+  SHT_info* sht_info = malloc(sizeof(SHT_info) + SHT_MaxBuckets() * sizeof(int));   // Room for the table of any rehash
+  sht_info->blockId = 0;
+  sht_info->fileDesc = -1;
+  sht_info->lastBlockId = BF_HeaderGetInt(&header);
+  sht_info->maxBlockRecs = BF_HeaderGetInt(&header);
+  sht_info->filterHashes = BF_HeaderGetInt(&header);
+  sht_info->filterBlock = BF_HeaderGetInt(&header);
+  sht_info->counterBlock = BF_HeaderGetInt(&header);
+  sht_info->hashSeed = BF_HeaderGetInt(&header);
+  sht_info->maxChain = BF_HeaderGetInt(&header);
+  sht_info->tableBlocks = BF_HeaderGetInt(&header);
+  sht_info->rehashBlock = BF_HeaderGetInt(&header);
+  sht_info->flags = BF_HeaderGetInt(&header);
+  sht_info->numBuckets = BF_HeaderGetLong(&header);
+  if(sht_info->numBuckets < 1 || sht_info->numBuckets > SHT_MaxBuckets()){
+    free(sht_info);
+    return NULL;
+  }
+  for(int i = 0; i < sht_info->numBuckets; i++){
+    sht_info->hashTable[i] = BF_HeaderGetInt(&header);
+  }
+
+  return sht_info;
+}
+
 /**** String hash function ****/
 
-static int SHT_Function(unsigned char *str, int buckets){
+// The sum of the characters until the first rehash, then FNV-1a started from the seed
+static int SHT_Function(unsigned char *str, int buckets, int seed){
   int c;
   int hash = 0;
 
+  if(seed != 0){
+    unsigned int fnv = 2166136261u ^ ((unsigned int) seed * 0x9e3779b9u);
+    while ((c = *str++)){
+      fnv = (fnv ^ c) * 16777619u;
+    }
+    fnv ^= fnv >> 15;
+    return (int) (fnv % (unsigned int) buckets);
+  }
+
   while (c = *str++){
     hash = hash + c;
   }
@@ -54,13 +134,356 @@ static int SHT_Function(unsigned char *str, int buckets){
   return (int) hash % buckets;
 }
 
-/**** Initialize block_info ****/
+/**** Bloom filters (block filterBlock + bucket is the filter of the bucket) ****/
+
+static int SHT_FilterBlock(SHT_info* sht_info, int hash){
+  return sht_info->filterBlock + hash;
+}
+
+static void SHT_FilterAdd(SHT_info* sht_info, int hash, char* name){
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+  CALL_OR_DIE(BF_GetBlockCounted(sht_info->fileDesc, SHT_FilterBlock(sht_info, hash), block));
+
+  BLOOM_Add((unsigned char*) BF_Block_GetData(block), BF_BLOCK_SIZE * 8, sht_info->filterHashes, name, strlen(name));
+  BF_PoolUpdate(sht_info->fileDesc, SHT_FilterBlock(sht_info, hash), BF_Block_GetData(block));
+
+  BF_Block_SetDirty(block);
+  CALL_OR_DIE(BF_UnpinBlockCounted(block));
+  BF_Block_Destroy(&block);
+}
+
+static int SHT_FilterMayContain(SHT_info* sht_info, int hash, char* name){
+  int found;
+  char* data;
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+  CALL_OR_DIE(BF_GetBlockData(sht_info->fileDesc, SHT_FilterBlock(sht_info, hash), block, &data));
+
+  found = BLOOM_MayContain((unsigned char*) data, BF_BLOCK_SIZE * 8, sht_info->filterHashes, name, strlen(name));
+
+  CALL_OR_DIE(BF_ReleaseBlock(sht_info->fileDesc, block));
+  BF_Block_Destroy(&block);
+
+  return found;
+}
+
+/**** Bucket counters, the same as in ht_table.c ****/
+
+static int SHT_CounterBlocks(int buckets){
+  return (buckets + HT_COUNTERS_PER_BLOCK - 1) / HT_COUNTERS_PER_BLOCK;
+}
+
+// Under the file latch, as in HT_CountersAdd
+static void SHT_CountersAdd(SHT_info* sht_info, int hash, int records, int newBlocks){
+  BF_Block* block;
+  int counterBlock = sht_info->counterBlock + hash / HT_COUNTERS_PER_BLOCK;
+
+  BF_Block_Init(&block);
+  BF_LatchFile(sht_info->fileDesc);
+  CALL_OR_DIE(BF_GetBlockCounted(sht_info->fileDesc, counterBlock, block));
+
+  HT_bucket_counters* counters = (HT_bucket_counters*) BF_Block_GetData(block) + hash % HT_COUNTERS_PER_BLOCK;
+  counters->records += records;
+  counters->blocks += newBlocks;
+  BF_PoolUpdate(sht_info->fileDesc, counterBlock, BF_Block_GetData(block));
+
+  sht_info->tableBlocks += newBlocks;
+  if(counters->blocks > sht_info->maxChain){
+    sht_info->maxChain = counters->blocks;
+  }
+
+  BF_Block_SetDirty(block);
+  CALL_OR_DIE(BF_UnpinBlockCounted(block));
+  BF_UnlatchFile(sht_info->fileDesc);
+  BF_Block_Destroy(&block);
+}
+
+// Counted again from the chains after a recovery, as in HT_CountersRebuild
+static void SHT_CountersRebuild(SHT_info* sht_info){
+  void* data;
+  BF_Block* block;
+  BF_Block* counterBlock;
+
+  BF_Block_Init(&block);
+  BF_Block_Init(&counterBlock);
+
+  sht_info->maxChain = 0;
+  sht_info->tableBlocks = 0;
+  for(int first = 0; first < sht_info->numBuckets; first += HT_COUNTERS_PER_BLOCK){
+    int counterId = sht_info->counterBlock + first / HT_COUNTERS_PER_BLOCK;
+    CALL_OR_DIE(BF_GetBlockCounted(sht_info->fileDesc, counterId, counterBlock));
+    HT_bucket_counters* counters = (HT_bucket_counters*) BF_Block_GetData(counterBlock);
+    memset(counters, 0, BF_BLOCK_SIZE);
+
+    for(int bucket = first; bucket < sht_info->numBuckets && bucket < first + HT_COUNTERS_PER_BLOCK; bucket++){
+      int temp = sht_info->hashTable[bucket];
+      while(temp != -1){
+        CALL_OR_DIE(BF_GetBlockCounted(sht_info->fileDesc, temp, block));
+        data = BF_Block_GetData(block);
+        SHT_block_info* block_info = data + SHT_MetadataOffset(sht_info);
+
+        counters[bucket - first].records += block_info->recNumber;
+        counters[bucket - first].blocks++;
+        temp = block_info->hashBucket;
+
+        CALL_OR_DIE(BF_UnpinBlockCounted(block));
+      }
+
+      sht_info->tableBlocks += counters[bucket - first].blocks;
+      if(counters[bucket - first].blocks > sht_info->maxChain){
+        sht_info->maxChain = counters[bucket - first].blocks;
+      }
+    }
+
+    BF_PoolUpdate(sht_info->fileDesc, counterId, (char*) counters);
+    BF_Block_SetDirty(counterBlock);
+    CALL_OR_DIE(BF_UnpinBlockCounted(counterBlock));
+  }
+
+  BF_Block_Destroy(&block);
+  BF_Block_Destroy(&counterBlock);
+}
+
+/**** Redo records of the write ahead log ****/
+
+typedef enum SHT_RedoType{
+  SHT_REDO_LINK,          // blockId became the first block of bucket, pointing to next
+  SHT_REDO_RECORD,        // name and recordBlock were written at slot of blockId
+  SHT_REDO_REHASH,        // A rehash into bucket buckets with the hash seed next started, blockId keeps the old table
+  SHT_REDO_MOVED,         // The entries of bucket of the old table were moved, its blocks were emptied
+  SHT_REDO_REHASHED       // Every bucket of the old table was moved
+}SHT_RedoType;
+
+typedef struct{
+  SHT_RedoType type;
+  int blockId;
+  int bucket;
+  int next;
+  int slot;               // A link, rehash, moved or rehashed record ends here
+  unsigned int recordBlock;
+  char name[15];
+}SHT_redo;
+
+// Gets block blockId, allocating the blocks up to it that never reached the file
+static void SHT_EnsureBlock(SHT_info* sht_info, int blockId, BF_Block* block){
+  int blocks;
+  void* data;
+
+  CALL_OR_DIE(BF_GetBlockCounter(sht_info->fileDesc, &blocks));
+  while(blocks <= blockId){
+    CALL_OR_DIE(BF_AllocateBlockCounted(sht_info->fileDesc, block));
+    data = BF_Block_GetData(block);
+    SHT_block_info* block_info = data + SHT_MetadataOffset(sht_info);
+    block_info->recNumber = 0;
+    block_info->hashBucket = -1;
+    BF_ChecksumSeal(sht_info->fileDesc, blocks, data);
+    BF_Block_SetDirty(block);
+    CALL_OR_DIE(BF_UnpinBlockCounted(block));
+    blocks++;
+  }
+
+  CALL_OR_DIE(BF_GetBlockCounted(sht_info->fileDesc, blockId, block));
+}
+
+// reused as in HT_ZeroBlock
+static void SHT_ZeroBlock(SHT_info* sht_info, int blockId, BF_Block* block, int reused){
+  SHT_EnsureBlock(sht_info, blockId, block);
+  memset(BF_Block_GetData(block), 0, BF_BLOCK_SIZE);
+  if(reused){
+    BF_ChecksumSealReused(sht_info->fileDesc, BF_Block_GetData(block));
+  }
+  BF_PoolUpdate(sht_info->fileDesc, blockId, BF_Block_GetData(block));
+  BF_Block_SetDirty(block);
+  CALL_OR_DIE(BF_UnpinBlockCounted(block));
+}
+
+/**** Online rehash, the same as in ht_table.c ****/
+
+typedef struct{
+  int buckets;            // Of the old table
+  int hashSeed;
+  int next;               // The buckets before it are moved already
+  int heads[];            // First block of every bucket of the old table
+}SHT_rehash;
+
+static double skewThreshold = 0;
+
+static void SHT_RehashBegin(SHT_info* sht_info, int rehashBlock, int buckets, int seed){
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+
+  SHT_EnsureBlock(sht_info, rehashBlock, block);
+  SHT_rehash* rehash = (SHT_rehash*) BF_Block_GetData(block);
+  memset(rehash, 0, BF_BLOCK_SIZE);
+  rehash->buckets = sht_info->numBuckets;
+  rehash->hashSeed = sht_info->hashSeed;
+  rehash->next = 0;
+  for(int i = 0; i < sht_info->numBuckets; i++){
+    rehash->heads[i] = sht_info->hashTable[i];
+  }
+  BF_PoolUpdate(sht_info->fileDesc, rehashBlock, (char*) rehash);
+  BF_Block_SetDirty(block);
+  CALL_OR_DIE(BF_UnpinBlockCounted(block));
+
+  int oldFirst = sht_info->filterHashes > 0 ? sht_info->filterBlock : sht_info->counterBlock;
+  int oldEnd = sht_info->counterBlock + SHT_CounterBlocks(sht_info->numBuckets);
+  for(int i = oldFirst; i < oldEnd; i++){
+    SHT_ZeroBlock(sht_info, i, block, 1);
+  }
+
+  sht_info->numBuckets = buckets;
+  sht_info->hashSeed = seed;
+  sht_info->rehashBlock = rehashBlock;
+  sht_info->filterBlock = rehashBlock + 1;
+  sht_info->counterBlock = sht_info->filterBlock + (sht_info->filterHashes > 0 ? buckets : 0);
+  int end = sht_info->counterBlock + SHT_CounterBlocks(buckets);
+  for(int i = sht_info->filterBlock; i < end; i++){
+    SHT_ZeroBlock(sht_info, i, block, 0);
+  }
+  if(end - 1 > sht_info->lastBlockId){
+    sht_info->lastBlockId = end - 1;
+  }
+
+  for(int i = 0; i < buckets; i++){
+    sht_info->hashTable[i] = -1;
+  }
+  sht_info->maxChain = 0;
+  sht_info->tableBlocks = 0;
+
+  BF_Block_Destroy(&block);
+}
+
+static void SHT_RehashMoved(SHT_info* sht_info, SHT_rehash* rehash, int bucket){
+  void* data;
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+
+  int temp = rehash->heads[bucket];
+  while(temp != -1){
+    CALL_OR_DIE(BF_GetBlockCounted(sht_info->fileDesc, temp, block));
+    data = BF_Block_GetData(block);
+    SHT_block_info* block_info = data + SHT_MetadataOffset(sht_info);
+
+    block_info->recNumber = 0;    // hashBucket stays, a replay of the log walks the chain again
+    BF_ChecksumSeal(sht_info->fileDesc, temp, data);
+    BF_PoolUpdate(sht_info->fileDesc, temp, data);
+    temp = block_info->hashBucket;
+
+    BF_Block_SetDirty(block);
+    CALL_OR_DIE(BF_UnpinBlockCounted(block));
+  }
+  if(rehash->next <= bucket){
+    rehash->next = bucket + 1;
+  }
+
+  BF_Block_Destroy(&block);
+}
+
+static void SHT_RehashEnd(SHT_info* sht_info){
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+  SHT_ZeroBlock(sht_info, sht_info->rehashBlock, block, 1);
+  BF_Block_Destroy(&block);
+
+  sht_info->rehashBlock = 0;
+}
+
+// First block of the bucket of name in the old table, -1 if it was moved already or there is no rehash
+static int SHT_RehashHead(SHT_info* sht_info, char* name){
+  int head = -1;
+  char* data;
+  BF_Block* block;
+
+  if(sht_info->rehashBlock == 0){
+    return -1;
+  }
+
+  BF_Block_Init(&block);
+  CALL_OR_DIE(BF_GetBlockData(sht_info->fileDesc, sht_info->rehashBlock, block, &data));   // Works for mapped files too
+
+  SHT_rehash* rehash = (SHT_rehash*) data;
+  int bucket = SHT_Function((unsigned char*) name, rehash->buckets, rehash->hashSeed);
+  if(bucket >= rehash->next){
+    head = rehash->heads[bucket];
+  }
+
+  CALL_OR_DIE(BF_ReleaseBlock(sht_info->fileDesc, block));
+  BF_Block_Destroy(&block);
+
+  return head;
+}
+
+// Same as HT_Redo, applying a redo record twice gives the same block
+static void SHT_Redo(void* context, const void* payload, int length){
+  SHT_info* sht_info = context;
+  const SHT_redo* redo = payload;
+  (void) length;    // The type of the redo record tells how much of it was logged
 
-static SHT_block_info* SHT_MetadataBlockInitialize(SHT_info* sht_info, BF_Block* block){
   void* data;
+  BF_Block* block;
 
-  CALL_OR_DIE(BF_GetBlock(sht_info->fileDesc, sht_info->lastBlockId, block));
+  BF_Block_Init(&block);
+
+  if(redo->type == SHT_REDO_REHASH){
+    if(sht_info->rehashBlock != redo->blockId){
+      SHT_RehashBegin(sht_info, redo->blockId, redo->bucket, redo->next);
+    }
+    BF_Block_Destroy(&block);
+    return;
+  }
+  if(redo->type == SHT_REDO_REHASHED){
+    if(sht_info->rehashBlock != 0){
+      SHT_RehashEnd(sht_info);
+    }
+    BF_Block_Destroy(&block);
+    return;
+  }
+
+  SHT_EnsureBlock(sht_info, redo->blockId, block);
   data = BF_Block_GetData(block);
+  SHT_block_info* block_info = data + SHT_MetadataOffset(sht_info);
+
+  if(redo->type == SHT_REDO_MOVED){
+    SHT_RehashMoved(sht_info, data, redo->bucket);    // blockId is the block of the old table
+  }else if(redo->type == SHT_REDO_LINK){
+    block_info->hashBucket = redo->next;
+    sht_info->hashTable[redo->bucket] = redo->blockId;
+    if(redo->blockId > sht_info->lastBlockId){
+      sht_info->lastBlockId = redo->blockId;
+    }
+  }else{
+    int offset = redo->slot * (sizeof(char) * 15 + sizeof(unsigned int));
+    memcpy(data + offset, redo->name, sizeof(redo->name));
+    memcpy(data + offset + SHT_RecordNameOffset(), &redo->recordBlock, sizeof(unsigned int));
+    if(block_info->recNumber <= redo->slot){
+      block_info->recNumber = redo->slot + 1;
+    }
+  }
+  BF_ChecksumSeal(sht_info->fileDesc, redo->blockId, data);    // The rehash block of a moved record has none
+  BF_PoolUpdate(sht_info->fileDesc, redo->blockId, data);
+
+  BF_Block_SetDirty(block);
+  CALL_OR_DIE(BF_UnpinBlockCounted(block));
+  BF_Block_Destroy(&block);
+
+  if(redo->type == SHT_REDO_RECORD && sht_info->filterHashes > 0){
+    char name[16];
+    memcpy(name, redo->name, sizeof(redo->name));
+    name[15] = '\0';
+    SHT_FilterAdd(sht_info, SHT_Function((unsigned char*) name, sht_info->numBuckets, sht_info->hashSeed), name);
+  }
+}
+
+/**** Initialize block_info ****/
+
+static SHT_block_info* SHT_MetadataBlockInitialize(SHT_info* sht_info, BF_Block* block){
+  void* data = BF_Block_GetData(block);
 
   // No need to memcopy to initializing, having pointer to our struct
   SHT_block_info* block_info = data + SHT_MetadataOffset(sht_info);
@@ -70,42 +493,581 @@ static SHT_block_info* SHT_MetadataBlockInitialize(SHT_info* sht_info, BF_Block*
   return block_info;
 }
 
+/**** Inserts ****/
+
+// Appends a block to the file and returns its number, the block is pinned in block (see HT_AllocateBlock)
+static int SHT_AllocateBlock(SHT_info* sht_info, BF_Block* block){
+  BF_LatchFile(sht_info->fileDesc);
+  CALL_OR_DIE(BF_AllocateBlockCounted(sht_info->fileDesc, block));
+  int blockId = ++sht_info->lastBlockId;
+  BF_UnlatchFile(sht_info->fileDesc);
+
+  return blockId;
+}
+
+// Puts the name of record and block_id in the bucket of the current table, with their redo records, filter and counters
+// Called with the bucket latched exclusive (or the directory for a rehash step)
+static int SHT_Place(SHT_info* sht_info, Record record, int block_id){
+  void* data;
+  SHT_block_info* block_info;
+
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+
+  int hash = SHT_Function(record.name, sht_info->numBuckets, sht_info->hashSeed);
+  int previousHead = sht_info->hashTable[hash];
+  int blockId = previousHead;
+
+  /**** The first block of the bucket if the entry fits in it, else a new block in front of the chain ****/
+
+  if(blockId != -1){
+    CALL_OR_DIE(BF_GetBlockCounted(sht_info->fileDesc, blockId, block));
+    block_info = (void*) BF_Block_GetData(block) + SHT_MetadataOffset(sht_info);
+
+    if(block_info->recNumber == sht_info->maxBlockRecs){
+      CALL_OR_DIE(BF_UnpinBlockCounted(block));
+      blockId = -1;
+    }
+  }
+  if(blockId == -1){
+    blockId = SHT_AllocateBlock(sht_info, block);
+    block_info = SHT_MetadataBlockInitialize(sht_info, block);
+    block_info->hashBucket = previousHead;
+  }
+  data = BF_Block_GetData(block);
+
+  /**** The entry and its redo records under the BF lock, written before any other BF call so the changed blocks
+        cannot reach the file first ****/
+
+  BF_Lock();
+  memcpy(data + SHT_RecordOffset(block_info), &record.name , sizeof(record.name));                            // Need to copy a name and an int to memory so
+  memcpy(data + SHT_RecordOffset(block_info) + sizeof(record.name), (void*) &block_id, sizeof(unsigned int)); // 2 memcpy and the offsets for this
+  block_info->recNumber++;
+  sht_info->hashTable[hash] = blockId;
+
+  SHT_redo redo;
+  redo.blockId = blockId;
+  if(blockId != previousHead){  // A new block was allocated for the bucket
+    redo.type = SHT_REDO_LINK;
+    redo.bucket = hash;
+    redo.next = previousHead;
+    WAL_Log(sht_info->fileDesc, &redo, offsetof(SHT_redo, slot));
+  }
+  redo.type = SHT_REDO_RECORD;
+  redo.slot = block_info->recNumber - 1;
+  redo.recordBlock = block_id;
+  memcpy(redo.name, record.name, sizeof(redo.name));
+  WAL_Log(sht_info->fileDesc, &redo, sizeof(SHT_redo));
+  WAL_Write(sht_info->fileDesc);
+
+  BF_ChecksumSeal(sht_info->fileDesc, blockId, data);
+  BF_PoolUpdate(sht_info->fileDesc, blockId, data);
+  BF_Block_SetDirty(block);
+  CALL_OR_DIE(BF_UnpinBlockCounted(block));
+  BF_Unlock();
+  BF_Block_Destroy(&block);
+
+  if(sht_info->filterHashes > 0){
+    SHT_FilterAdd(sht_info, hash, record.name);
+  }
+  SHT_CountersAdd(sht_info, hash, 1, blockId != previousHead);
+
+  return 0;
+}
+
+/**** Rehash steps of the inserts, the same as in ht_table.c ****/
+
+// Moving the entries of a secondary index is safe, they keep the hashtable blocks of the records and those stay
+
+static int SHT_ShouldRehash(SHT_info* sht_info){
+  if(skewThreshold <= 0 || sht_info->rehashBlock != 0){
+    return 0;
+  }
+  if(sht_info->numBuckets >= SHT_MaxBuckets() && sht_info->hashSeed != 0){
+    return 0;
+  }
+
+  BF_LatchFile(sht_info->fileDesc);
+  int skewed = sht_info->maxChain >= SHT_REHASH_MIN_CHAIN && (double) sht_info->maxChain * sht_info->numBuckets > skewThreshold * sht_info->tableBlocks;
+  BF_UnlatchFile(sht_info->fileDesc);
+
+  return skewed;
+}
+
+static void SHT_RehashStart(SHT_info* sht_info){
+  int buckets = sht_info->numBuckets * 2 < SHT_MaxBuckets() ? sht_info->numBuckets * 2 : SHT_MaxBuckets();
+
+  SHT_redo redo;
+  redo.type = SHT_REDO_REHASH;
+  redo.blockId = sht_info->lastBlockId + 1;
+  redo.bucket = buckets;
+  redo.next = sht_info->hashSeed + 1;
+  WAL_Log(sht_info->fileDesc, &redo, offsetof(SHT_redo, slot));
+  WAL_Write(sht_info->fileDesc);
+
+  SHT_RehashBegin(sht_info, redo.blockId, redo.bucket, redo.next);
+}
+
+static void SHT_RehashStep(SHT_info* sht_info){
+  void* data;
+  BF_Block* block;
+  BF_Block* rehashBlock;
+  Record records[sht_info->maxBlockRecs];   // Only the names are used
+  int blockIds[sht_info->maxBlockRecs];
+
+  BF_Block_Init(&block);
+  BF_Block_Init(&rehashBlock);
+  CALL_OR_DIE(BF_GetBlockCounted(sht_info->fileDesc, sht_info->rehashBlock, rehashBlock));
+  SHT_rehash* rehash = (SHT_rehash*) BF_Block_GetData(rehashBlock);
+
+  int bucket = rehash->next;
+  int temp = rehash->heads[bucket];
+  while(temp != -1){
+    CALL_OR_DIE(BF_GetBlockCounted(sht_info->fileDesc, temp, block));
+    data = BF_Block_GetData(block);
+    SHT_block_info* block_info = data + SHT_MetadataOffset(sht_info);
+
+    int count = block_info->recNumber;
+    for(int i = 0; i < count; i++){
+      void* entry = data + (SHT_RecordNameOffset() + sizeof(unsigned int)) * i;
+      memcpy(records[i].name, entry, sizeof(records[i].name));
+      memcpy(&blockIds[i], entry + SHT_RecordNameOffset(), sizeof(unsigned int));
+    }
+    temp = block_info->hashBucket;
+    CALL_OR_DIE(BF_UnpinBlockCounted(block));
+
+    for(int i = 0; i < count; i++){
+      SHT_Place(sht_info, records[i], blockIds[i]);
+    }
+  }
+
+  SHT_redo redo;
+  redo.type = SHT_REDO_MOVED;
+  redo.blockId = sht_info->rehashBlock;
+  redo.bucket = bucket;
+  WAL_Log(sht_info->fileDesc, &redo, offsetof(SHT_redo, slot));
+  int finished = bucket + 1 == rehash->buckets;
+  if(finished){
+    redo.type = SHT_REDO_REHASHED;
+    WAL_Log(sht_info->fileDesc, &redo, offsetof(SHT_redo, slot));
+  }
+  WAL_Write(sht_info->fileDesc);
+
+  SHT_RehashMoved(sht_info, rehash, bucket);
+  BF_PoolUpdate(sht_info->fileDesc, sht_info->rehashBlock, (char*) rehash);
+  BF_Block_SetDirty(rehashBlock);
+  CALL_OR_DIE(BF_UnpinBlockCounted(rehashBlock));
+
+  if(finished){
+    SHT_RehashEnd(sht_info);
+  }
+
+  BF_Block_Destroy(&block);
+  BF_Block_Destroy(&rehashBlock);
+}
+
+/**** Lookups ****/
+
+// Prints the records named name of the hashtable blocks that the chain starting at block first points to
+// array marks the hashtable blocks read already, total counts the blocks read. Return the number of printed records
+static int SHT_Search(HT_info* ht_info, SHT_info* sht_info, int first, char* name, int* array, int blocks, int* total){
+  int noEntry = 0;
+
+  void* data;
+  void* dataHT;
+  BF_Block* block;
+  BF_Block* blockHT;
+
+  BF_Block_Init(&block);
+  BF_Block_Init(&blockHT);
+
+  int temp = first; // To go from block to block need to take a temporary because we cant change hashTable value at the end of the loop
+  while(temp != -1){
+    CALL_OR_DIE(BF_GetBlockData(sht_info->fileDesc, temp, block, (char**) &data));  // Works for mapped files too
+
+    void* record = data;
+    void* blockId = data + SHT_RecordNameOffset();
+    SHT_block_info* block_info = data + SHT_MetadataOffset(sht_info);
+
+    int prefetch[block_info->recNumber + 1];  // The hashtable blocks this index block points to are read in the background
+    int prefetchBlocks = 0;
+    for(int i = 0; i < block_info->recNumber; i++){
+      void* entry = data + (SHT_RecordNameOffset() + sizeof(unsigned int)) * i;
+      int entryBlock = *(int*) (entry + SHT_RecordNameOffset());
+      if(entryBlock < blocks && strcmp((char*) entry, name) == 0 && array[entryBlock] != 1){
+        prefetch[prefetchBlocks++] = entryBlock;
+      }
+    }
+    BF_Prefetch(ht_info->fileDesc, prefetch, prefetchBlocks);
+
+    for(int i = 0; i < block_info->recNumber; i++){
+      // Check if this is the name but also if we visited that block previously, blocks the hashtable got after the lookup started are not in array
+      if(*(int*) blockId < blocks && (strcmp((char*) record, (char*) name) == 0) && (array[*(int*) blockId] != 1)){
+        BF_Lock();    // HT inserts change the block under the BF lock, we hold no latch of the hashtable
+        CALL_OR_DIE(BF_GetBlockData(ht_info->fileDesc, *(int*) blockId, blockHT, (char**) &dataHT));
+
+        Record* rec = dataHT;
+        HT_block_info* ht_block_info = dataHT + ht_info->maxBlockRecs * sizeof(Record);
+
+        for(int j = 0; j < ht_block_info->recNumber; j++){
+          if(strcmp(rec->name, (char*) record) == 0){
+            printRecord(*rec);
+            noEntry++;
+          }
+          rec = dataHT + sizeof(Record) * (j + 1);  // Going to the next record of the block
+        }
+        (*total)++;
+
+        CALL_OR_DIE(BF_ReleaseBlock(ht_info->fileDesc, blockHT));
+        BF_Unlock();
+
+        array[*(int*) blockId] = 1;   // Block visited so change the value 
+      }
+      record = data + (SHT_RecordNameOffset() + sizeof(unsigned int)) * (i + 1);   // Going to the next record & block id of the block
+      blockId = record + SHT_RecordNameOffset();
+    }
+    (*total)++;
+
+    temp = block_info->hashBucket;  // Giving the next we point, read before the frame can go
+    CALL_OR_DIE(BF_ReleaseBlock(sht_info->fileDesc, block));
+  }
+
+  BF_Block_Destroy(&block);
+  BF_Block_Destroy(&blockHT);
+
+  return noEntry;
+}
+
+/**** Data blocks ****/
+
+// Block 0, the old table of a rehash and the filters and counters of the current table, as HT_IsDirectoryBlock
+static int SHT_IsDirectoryBlock(SHT_info* sht_info, int blockId){
+  if(blockId == 0 || blockId == sht_info->rehashBlock){
+    return 1;
+  }
+  if(sht_info->filterHashes > 0 && blockId >= sht_info->filterBlock && blockId < sht_info->filterBlock + sht_info->numBuckets){
+    return 1;
+  }
+
+  return blockId >= sht_info->counterBlock && blockId < sht_info->counterBlock + SHT_CounterBlocks(sht_info->numBuckets);
+}
+
+// The blocks that are not directory blocks keep entries, so they have a checksum (see bf_checksum.h)
+static int SHT_IsDataBlock(void* context, int block_num){
+  return !SHT_IsDirectoryBlock(context, block_num);
+}
+
+/**** Bulk build from the hashtable ****/
+
+typedef struct{
+  char name[15];
+  int blockId;
+}SHT_entry;
+
+typedef struct{
+  int count;
+  int capacity;
+  SHT_entry* entries;
+}SHT_partition;
+
+typedef struct{
+  HT_info* ht_info;
+  SHT_info* sht_info;
+  int workers;
+  int nextBlock;                // First hashtable block of the next morsel, shared between the workers
+  int nextBucket;               // Next bucket to write, shared between the workers
+  SHT_partition* partitions;    // The entries worker w found for bucket b are in partitions[w * numBuckets + b]
+  int error;                    // Set by a worker that failed, the others stop at their next morsel
+}SHT_build;
+
+typedef struct{
+  SHT_build* build;
+  int index;
+  int entries;                  // Entries this worker wrote
+  pthread_t thread;
+}SHT_builder;
+
+// First phase, the data blocks of the hashtable are split in morsels and the name and block of every record
+// go to the partition of its bucket, private to the worker
+static void* SHT_PartitionWorker(void* argument){
+  SHT_builder* builder = argument;
+  SHT_build* build = builder->build;
+  HT_info* ht_info = build->ht_info;
+  SHT_info* sht_info = build->sht_info;
+  SHT_partition* partitions = build->partitions + builder->index * sht_info->numBuckets;
+
+  char pages[SHT_BUILD_MORSEL][BF_BLOCK_SIZE];
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+
+  while(!__atomic_load_n(&build->error, __ATOMIC_RELAXED)){
+    int first = __atomic_fetch_add(&build->nextBlock, SHT_BUILD_MORSEL, __ATOMIC_RELAXED);
+    if(first > ht_info->lastBlockId){
+      break;
+    }
+
+    int morsel[SHT_BUILD_MORSEL];
+    int blocks = 0;
+    for(int blockId = first; blockId < first + SHT_BUILD_MORSEL && blockId <= ht_info->lastBlockId; blockId++){
+      if(!HT_IsDirectoryBlock(ht_info, blockId)){
+        morsel[blocks++] = blockId;
+      }
+    }
+    BF_Prefetch(ht_info->fileDesc, morsel, blocks);
+
+    // libbf keeps the newest copy of a changed block in its frames, so the blocks can not be read from the file
+    // around it. The whole morsel is copied in one hold of the BF lock and hashed outside it
+    BF_ErrorCode code = BF_OK;
+    BF_Lock();
+    for(int i = 0; i < blocks && code == BF_OK; i++){
+      char* data;
+      code = BF_GetBlockData(ht_info->fileDesc, morsel[i], block, &data);
+      if(code == BF_OK){
+        memcpy(pages[i], data, BF_BLOCK_SIZE);
+        code = BF_ReleaseBlock(ht_info->fileDesc, block);
+      }
+    }
+    BF_Unlock();
+
+    if(code != BF_OK){
+      BF_PrintError(code);
+      __atomic_store_n(&build->error, 1, __ATOMIC_RELAXED);
+      break;
+    }
+
+    for(int i = 0; i < blocks; i++){
+      Record* records = (Record*) pages[i];
+      HT_block_info* block_info = (void*) pages[i] + ht_info->maxBlockRecs * sizeof(Record);
+
+      for(int j = 0; j < block_info->recNumber; j++){
+        SHT_partition* partition = &partitions[SHT_Function((unsigned char*) records[j].name, sht_info->numBuckets, sht_info->hashSeed)];
+        if(partition->count == partition->capacity){
+          int capacity = partition->capacity == 0 ? 64 : partition->capacity * 2;
+          SHT_entry* entries = realloc(partition->entries, capacity * sizeof(SHT_entry));
+          if(entries == NULL){
+            __atomic_store_n(&build->error, 1, __ATOMIC_RELAXED);
+            break;
+          }
+          partition->entries = entries;
+          partition->capacity = capacity;
+        }
+        memcpy(partition->entries[partition->count].name, records[j].name, sizeof(partition->entries[0].name));
+        partition->entries[partition->count].blockId = morsel[i];
+        partition->count++;
+      }
+    }
+  }
+
+  BF_Block_Destroy(&block);
+
+  return NULL;
+}
+
+// Second phase, the entries of the bucket from every partition are packed in full blocks that go in front of
+// its chain with consecutive numbers, with their redo records, filter and counters as SHT_Place would write them
+// Return the number of entries written, -1 if there was no memory for the blocks (nothing is written)
+static int SHT_BuildBucket(SHT_build* build, int bucket){
+  SHT_info* sht_info = build->sht_info;
+  int entrySize = SHT_RecordNameOffset() + sizeof(unsigned int);
+
+  int count = 0;
+  for(int w = 0; w < build->workers; w++){
+    count += build->partitions[w * sht_info->numBuckets + bucket].count;
+  }
+  if(count == 0){
+    return 0;
+  }
+
+  int blocks = (count + sht_info->maxBlockRecs - 1) / sht_info->maxBlockRecs;
+  char* pages = calloc(blocks, BF_BLOCK_SIZE);
+  if(pages == NULL){
+    return -1;
+  }
+
+  /**** The blocks are filled in memory, outside any lock ****/
+
+  int entry = 0;
+  for(int w = 0; w < build->workers; w++){
+    SHT_partition* partition = &build->partitions[w * sht_info->numBuckets + bucket];
+    for(int i = 0; i < partition->count; i++, entry++){
+      char* page = pages + (entry / sht_info->maxBlockRecs) * BF_BLOCK_SIZE;
+      void* slot = page + (entry % sht_info->maxBlockRecs) * entrySize;
+      memcpy(slot, partition->entries[i].name, sizeof(partition->entries[i].name));
+      memcpy(slot + SHT_RecordNameOffset(), &partition->entries[i].blockId, sizeof(unsigned int));
+    }
+  }
+  for(int i = 0; i < blocks; i++){
+    SHT_block_info* block_info = (void*) pages + i * BF_BLOCK_SIZE + SHT_MetadataOffset(sht_info);
+    block_info->recNumber = i < blocks - 1 ? sht_info->maxBlockRecs : count - i * sht_info->maxBlockRecs;
+  }
+
+  BF_Block* block;
+
+  BF_Block_Init(&block);
+
+  if(sht_info->filterHashes > 0){   // The bucket and its filter are ours, no other worker writes them
+    CALL_OR_DIE(BF_GetBlockCounted(sht_info->fileDesc, SHT_FilterBlock(sht_info, bucket), block));
+    for(int i = 0; i < count; i++){
+      char name[16];
+      memcpy(name, pages + (i / sht_info->maxBlockRecs) * BF_BLOCK_SIZE + (i % sht_info->maxBlockRecs) * entrySize, 15);
+      name[15] = '\0';
+      BLOOM_Add((unsigned char*) BF_Block_GetData(block), BF_BLOCK_SIZE * 8, sht_info->filterHashes, name, strlen(name));
+    }
+    BF_PoolUpdate(sht_info->fileDesc, SHT_FilterBlock(sht_info, bucket), BF_Block_GetData(block));
+    BF_Block_SetDirty(block);
+    CALL_OR_DIE(BF_UnpinBlockCounted(block));
+  }
+
+  /**** Then written one after the other, the file latch keeps the blocks of other buckets out of the run ****/
+
+  int next = sht_info->hashTable[bucket];
+  BF_LatchFile(sht_info->fileDesc);
+  for(int i = 0; i < blocks; i++){
+    CALL_OR_DIE(BF_AllocateBlockCounted(sht_info->fileDesc, block));
+    int blockId = ++sht_info->lastBlockId;
+    void* data = BF_Block_GetData(block);
+
+    BF_Lock();
+    memcpy(data, pages + i * BF_BLOCK_SIZE, BF_BLOCK_SIZE);
+    SHT_block_info* block_info = data + SHT_MetadataOffset(sht_info);
+    block_info->hashBucket = next;
+
+    SHT_redo redo;
+    redo.type = SHT_REDO_LINK;
+    redo.blockId = blockId;
+    redo.bucket = bucket;
+    redo.next = next;
+    WAL_Log(sht_info->fileDesc, &redo, offsetof(SHT_redo, slot));
+    redo.type = SHT_REDO_RECORD;
+    for(redo.slot = 0; redo.slot < block_info->recNumber; redo.slot++){
+      void* slot = data + redo.slot * entrySize;
+      memcpy(redo.name, slot, sizeof(redo.name));
+      memcpy(&redo.recordBlock, slot + SHT_RecordNameOffset(), sizeof(unsigned int));
+      WAL_Log(sht_info->fileDesc, &redo, sizeof(SHT_redo));
+    }
+    WAL_Write(sht_info->fileDesc);
+
+    BF_ChecksumSeal(sht_info->fileDesc, blockId, data);
+    BF_PoolUpdate(sht_info->fileDesc, blockId, data);
+    BF_Block_SetDirty(block);
+    CALL_OR_DIE(BF_UnpinBlockCounted(block));
+    BF_Unlock();
+
+    next = blockId;
+  }
+  sht_info->hashTable[bucket] = next;
+  BF_UnlatchFile(sht_info->fileDesc);
+
+  SHT_CountersAdd(sht_info, bucket, count, blocks);
+
+  BF_Block_Destroy(&block);
+  free(pages);
+
+  return count;
+}
+
+static void* SHT_BucketWorker(void* argument){
+  SHT_builder* builder = argument;
+  SHT_build* build = builder->build;
+
+  int bucket;
+  while((bucket = __atomic_fetch_add(&build->nextBucket, 1, __ATOMIC_RELAXED)) < build->sht_info->numBuckets){
+    int entries = SHT_BuildBucket(build, bucket);
+    if(entries < 0){
+      __atomic_store_n(&build->error, 1, __ATOMIC_RELAXED);
+    }else{
+      builder->entries += entries;
+    }
+  }
+
+  return NULL;
+}
+
+// Runs worker for every builder, the ones whose thread can not be created run on the calling thread
+// (the workers take their morsels and buckets from shared counters, so any of them can do the work of the others)
+static void SHT_RunWorkers(SHT_builder* builders, int threads, void* (*worker)(void*)){
+  int started[threads];
+
+  for(int i = 0; i < threads; i++){
+    started[i] = pthread_create(&builders[i].thread, NULL, worker, &builders[i]) == 0;
+  }
+  for(int i = 0; i < threads; i++){
+    if(!started[i]){
+      worker(&builders[i]);
+    }
+  }
+  for(int i = 0; i < threads; i++){
+    if(started[i]){
+      pthread_join(builders[i].thread, NULL);
+    }
+  }
+}
+
 /**** Secondary HashTable functions ****/
 
 int SHT_CreateSecondaryIndex(char *sfileName,  int buckets, char* fileName){
+  TRACE_FUNCTION();
+  return SHT_CreateSecondaryIndexWithFilter(sfileName, buckets, fileName, 0);
+}
+
+int SHT_CreateSecondaryIndexWithFilter(char *sfileName, int buckets, char* fileName, double falsePositiveRate){
+  TRACE_FUNCTION();
   int file;
   int sfile;
   void* data;
   BF_Block* block;
 
+  if(HT_MarkIndexed(fileName) != HT_OK){    // Its records must stay in their blocks from now on
+    return HT_ERROR;
+  }
+
   BF_Block_Init(&block);
   CALL_OR_DIE(BF_CreateFile(sfileName));
+  WAL_Discard(sfileName);   // A log left by an older file with this name is not ours
   CALL_OR_DIE(BF_OpenFile(fileName, &file));    // Open both files with "filename"
   CALL_OR_DIE(BF_OpenFile(sfileName, &sfile));  // so they can get correct filedesc
 
   CALL_OR_DIE(BF_AllocateBlock(sfile, block));
   data = BF_Block_GetData(block);
 
-  memcpy(data, string, strlen(string) + 1);
-
-  // No need to memcopy to initializing, having pointer to our structs 
-  SHT_info* sht_info = data + SHT_InfoOffset();
+  SHT_info* sht_info = malloc(sizeof(SHT_info) + buckets * sizeof(int));
   sht_info->blockId = 0;
   sht_info->lastBlockId = 0;
   sht_info->fileDesc = sfile;
   sht_info->numBuckets = buckets;
   sht_info->maxBlockRecs = (BF_BLOCK_SIZE - sizeof(SHT_block_info))/(sizeof(char) * 15 + sizeof(unsigned int));
-  sht_info->hashTable[buckets];
+  sht_info->filterHashes = BLOOM_HashFunctions(falsePositiveRate);
+  sht_info->filterBlock = 1;
+  sht_info->hashSeed = 0;
+  sht_info->maxChain = 0;
+  sht_info->tableBlocks = 0;
+  sht_info->rehashBlock = 0;
+  sht_info->flags = BF_ChecksumEnabled() ? SHT_FLAG_CHECKSUMS : 0;
+  if(sht_info->filterHashes > 0){
+    sht_info->lastBlockId = buckets;  // Blocks 1 - buckets are the filters, data blocks start after them
+  }
+  sht_info->counterBlock = sht_info->lastBlockId + 1;   // Then the counters
+  sht_info->lastBlockId += SHT_CounterBlocks(buckets);
   for(int i = 0; i < buckets; i++){
     sht_info->hashTable[i] = -1;
   }
+  SHT_EncodeHeader(sht_info, data);   // The string that identifies a secondary hashtable file comes first
 
-  SHT_block_info* block_info = data + SHT_BlockInfoOffset(sht_info);
-  block_info->recNumber = 0;
-  block_info->hashBucket = -1;    
+  int directoryBlocks = sht_info->lastBlockId;
+  free(sht_info);
 
   BF_Block_SetDirty(block);
   CALL_OR_DIE(BF_UnpinBlock(block));
+
+  for(int i = 0; i < directoryBlocks; i++){  // One empty filter block per bucket, then the counters all 0
+    CALL_OR_DIE(BF_AllocateBlock(sfile, block));
+    memset(BF_Block_GetData(block), 0, BF_BLOCK_SIZE);
+    BF_Block_SetDirty(block);
+    CALL_OR_DIE(BF_UnpinBlock(block));
+  }
+
   BF_Block_Destroy(&block);
   CALL_OR_DIE(BF_CloseFile(file));
   CALL_OR_DIE(BF_CloseFile(sfile));
@@ -114,6 +1076,7 @@ int SHT_CreateSecondaryIndex(char *sfileName,  int buckets, char* fileName){
 }
 
 SHT_info* SHT_OpenSecondaryIndex(char *indexName){
+  TRACE_FUNCTION();
   int file;
   void* data;
   BF_Block* block;
@@ -123,176 +1086,261 @@ SHT_info* SHT_OpenSecondaryIndex(char *indexName){
   BF_PrintError(BF_GetBlock(file, 0, block));
   data = BF_Block_GetData(block);
 
-  if(strcmp(data, string) != 0){                          // This must be a secondary hashtable file
+  // sht_info is ours until SHT_CloseSecondaryIndex writes it back
+  SHT_info* sht_info = SHT_DecodeHeader(data);                // This must be a secondary hashtable file
+  CALL_OR_DIE(BF_UnpinBlock(block));
+  BF_Block_Destroy(&block);
+
+  if(sht_info == NULL){
     printf("This is not a Secondary Hashtable file.\n");
-    CALL_OR_DIE(BF_UnpinBlock(block));
-    BF_Block_Destroy(&block);
     CALL_OR_DIE(BF_CloseFile(file));
     return NULL;
   }
+  sht_info->fileDesc = file;
 
-  SHT_info* sht_info = data + SHT_InfoOffset();
+  BF_PoolAttach(indexName, file);
+  BF_ChecksumAttach(file, SHT_IsDataBlock, sht_info, 0);   // Strict after the replay, see below
 
-  BF_PrintError(BF_UnpinBlock(block));
-  BF_Block_Destroy(&block);
+  // Replaying what a crash left in the log, as in HT_OpenFile
+  WAL_Attach(indexName, file);
+  int redone = WAL_Replay(file, SHT_Redo, sht_info);
+  if(redone > 0){
+    printf("Recovered %d log records of %s.\n", redone, indexName);
+    SHT_CountersRebuild(sht_info);
+  }
+  // The log may be replayed over blocks that never reached the file (0 at the end), they have their checksums now
+  BF_ChecksumAttach(file, SHT_IsDataBlock, sht_info, sht_info->flags & SHT_FLAG_CHECKSUMS);
+
+  BF_PrefetchAttach(indexName, file);
+  BF_LatchAttach(file, SHT_MaxBuckets());
 
   return sht_info;
 }
 
-int SHT_CloseSecondaryIndex(SHT_info* sht_info){
-  CALL_OR_DIE(BF_CloseFile(sht_info->fileDesc));
-  
-  return HT_OK;
-}
+SHT_info* SHT_OpenSecondaryIndexMapped(char *indexName){
+  TRACE_FUNCTION();
+  int file;
+  char* data;
 
-int SHT_SecondaryInsertEntry(SHT_info* sht_info, Record record, int block_id){
-  void* data;
-  void* firstData;
+  if(BF_OpenFileMapped(indexName, &file) != BF_OK){
+    printf("Could not map the file %s.\n", indexName);
+    return NULL;
+  }
+  CALL_OR_DIE(BF_GetBlockData(file, 0, NULL, &data));
 
-  BF_Block* block;
-  BF_Block* firstBlock;
-  
-  BF_Block_Init(&block);
-  BF_Block_Init(&firstBlock);
-  
-  CALL_OR_DIE(BF_GetBlock(sht_info->fileDesc, 0, firstBlock));
-  firstData = BF_Block_GetData(firstBlock);
+  SHT_info* sht_info = SHT_DecodeHeader(data);                // This must be a secondary hashtable file
+  if(sht_info == NULL){
+    printf("This is not a Secondary Hashtable file.\n");
+    CALL_OR_DIE(BF_CloseFileMapped(file));
+    return NULL;
+  }
+  sht_info->fileDesc = file;  // Never written back, the file stays as it is
 
-  int hash = SHT_Function(record.name, sht_info->numBuckets);
+  BF_AdviseMapped(file, BF_ADVICE_RANDOM);
+  BF_ChecksumAttach(file, SHT_IsDataBlock, sht_info, sht_info->flags & SHT_FLAG_CHECKSUMS);
 
-  /**** Allocate block if the hashtable[hash] is empty or if it is full of records. Get the block if we can copy the record ****/
+  return sht_info;
+}
 
-  if(sht_info->hashTable[hash] == -1){
-    CALL_OR_DIE(BF_AllocateBlock(sht_info->fileDesc, block));
-    sht_info->lastBlockId++;
+static int SHT_EnvClose(void* sht_info){
+  return SHT_CloseSecondaryIndex(sht_info);
+}
 
-    CALL_OR_DIE(BF_GetBlock(sht_info->fileDesc, sht_info->lastBlockId, block));
-    data = BF_Block_GetData(block);
+SHT_info* SHT_OpenSecondaryIndexEnv(BF_Env* env, char *indexName){
+  TRACE_FUNCTION();
+  if(BF_EnvUse(env, indexName) != BF_OK){
+    printf("Could not open the file %s in the env %s.\n", indexName, BF_EnvName(env));
+    return NULL;
+  }
 
-    SHT_block_info* block_info = SHT_MetadataBlockInitialize(sht_info, block);  // Initialize via function
+  SHT_info* sht_info = SHT_OpenSecondaryIndex(indexName);
+  if(sht_info != NULL && BF_EnvAdd(env, sht_info, SHT_EnvClose) != BF_OK){
+    printf("The env %s has too many open files.\n", BF_EnvName(env));
+    SHT_CloseSecondaryIndex(sht_info);
+    return NULL;
+  }
 
-    sht_info->hashTable[hash] = sht_info->lastBlockId;
+  return sht_info;
+}
 
-    memcpy(data + SHT_RecordOffset(block_info), &record.name , sizeof(record.name));                            // Need to copy a name and an int to memory so
-    memcpy(data + SHT_RecordOffset(block_info) + sizeof(record.name), (void*) &block_id, sizeof(unsigned int)); // 2 memcpy and the offsets for this
-    block_info->recNumber++;
-  }else{
-    CALL_OR_DIE(BF_GetBlock(sht_info->fileDesc, sht_info->hashTable[hash], block));
-    data = BF_Block_GetData(block);
+int SHT_CloseSecondaryIndex(SHT_info* sht_info){
+  TRACE_FUNCTION();
+  BF_EnvRemove(sht_info);   // Nothing if it was opened in no env
+  BF_ChecksumDetach(sht_info->fileDesc);
+  if(BF_IsMappedFile(sht_info->fileDesc)){
+    CALL_OR_DIE(BF_CloseFileMapped(sht_info->fileDesc));
+    free(sht_info);
+    return HT_OK;
+  }
 
-    SHT_block_info* block_info = data + SHT_MetadataOffset(sht_info);
-    
-    if(block_info->recNumber == sht_info->maxBlockRecs){
-      BF_Block_SetDirty(block);
-      CALL_OR_DIE(BF_UnpinBlock(block));
+  int file = sht_info->fileDesc;
 
-      CALL_OR_DIE(BF_AllocateBlock(sht_info->fileDesc, block));
-      sht_info->lastBlockId++;
+  BF_Block* block;
 
-      CALL_OR_DIE(BF_GetBlock(sht_info->fileDesc, sht_info->lastBlockId, block));
-      data = BF_Block_GetData(block);
+  BF_Block_Init(&block);
+  CALL_OR_DIE(BF_GetBlock(file, 0, block));   // sht_info is written back
+  SHT_EncodeHeader(sht_info, BF_Block_GetData(block));
+  BF_Block_SetDirty(block);
+  CALL_OR_DIE(BF_UnpinBlock(block));
+  BF_Block_Destroy(&block);
 
-      block_info = SHT_MetadataBlockInitialize(sht_info, block);
+  BF_LatchDetach(file);
+  BF_PrefetchDetach(file);
+  BF_PoolDetach(file);
+  CALL_OR_DIE(BF_CloseFile(file));
+  int result = WAL_Detach(file) == 0 ? HT_OK : HT_ERROR;   // Only after every block is in the file
+  free(sht_info);
+  
+  return result;
+}
 
-      data = BF_Block_GetData(block);
-      block_info->hashBucket = sht_info->hashTable[hash];   // Update hasbucket before hashtable[hash] change it's value
-      sht_info->hashTable[hash] = sht_info->lastBlockId;    // And then update the hashtable[hash] to the last block we are
+int SHT_SecondaryInsertEntry(SHT_info* sht_info, Record record, int block_id){
+  TRACE_FUNCTION();
+  if(BF_IsMappedFile(sht_info->fileDesc)){
+    printf("The file is opened read only.\n");
+    return SHT_ERROR;
+  }
 
-      memcpy(data + SHT_RecordOffset(block_info), &record.name , sizeof(record.name));                            // Need to copy a name and an int to memory so 
-      memcpy(data + SHT_RecordOffset(block_info) + sizeof(record.name), (void*) &block_id, sizeof(unsigned int)); // 2 memcpy and the offsets for this
-      block_info->recNumber++;
-    }else{
-      memcpy(data + SHT_RecordOffset(block_info), &record.name , sizeof(record.name));                            // Need to copy a name and an int to memory so
-      memcpy(data + SHT_RecordOffset(block_info) + sizeof(record.name), (void*) &block_id, sizeof(unsigned int)); // 2 memcpy and the offsets for this
-      block_info->recNumber++;
+  int file = sht_info->fileDesc;
+
+  BF_LatchDirectory(file, BF_LATCH_SHARED);
+  int hash = SHT_Function(record.name, sht_info->numBuckets, sht_info->hashSeed);
+  BF_LatchBucket(file, hash, BF_LATCH_EXCLUSIVE);
+  SHT_Place(sht_info, record, block_id);
+  BF_UnlatchBucket(file, hash);
+  int rehash = sht_info->rehashBlock != 0 || SHT_ShouldRehash(sht_info);
+  BF_UnlatchDirectory(file);
+
+  if(rehash){   // As in HT_InsertEntry
+    BF_LatchDirectory(file, BF_LATCH_EXCLUSIVE);
+    if(sht_info->rehashBlock != 0){
+      SHT_RehashStep(sht_info);
+    }else if(SHT_ShouldRehash(sht_info)){
+      SHT_RehashStart(sht_info);
     }
+    BF_UnlatchDirectory(file);
   }
 
-  BF_Block_SetDirty(block);
-  BF_Block_SetDirty(firstBlock);
-  CALL_OR_DIE(BF_UnpinBlock(block));
-  CALL_OR_DIE(BF_UnpinBlock(firstBlock));
-  BF_Block_Destroy(&block);
-  BF_Block_Destroy(&firstBlock);
-
   return 0;
 }
 
-int SHT_SecondaryGetAllEntries(HT_info* ht_info, SHT_info* sht_info, char* name){
+// SHT_SecondaryGetAllEntries with the bucket of name latched
+static int SHT_Lookup(HT_info* ht_info, SHT_info* sht_info, int hash, char* name){
   int total = 0;
   int noEntry = 0;
 
-  void* data;
-  void* dataHT;
-  BF_Block* block;
-  BF_Block* blockHT;
-
-  BF_Block_Init(&block);
-  BF_Block_Init(&blockHT);
-
-  int hash = SHT_Function(name, sht_info->numBuckets);
+  int oldHead = SHT_RehashHead(sht_info, name);    // While a rehash moves the buckets, name may still be in the old table
 
-  if(sht_info->hashTable[hash] == -1){            // Check before get_block if a block exists
+  if(sht_info->hashTable[hash] == -1 && oldHead == -1){   // Check before get_block if a block exists
     printf("There is no entry with this name!\n");
     return 0;
   }
 
-  int* array = (int*) malloc(sizeof(int) * (ht_info->lastBlockId + 1));
-  for(int i = 0; i <= ht_info->lastBlockId; i++){
+  BF_LatchFile(ht_info->fileDesc);    // The hashtable may be growing in other threads
+  int blocks = ht_info->lastBlockId + 1;
+  BF_UnlatchFile(ht_info->fileDesc);
+
+  int* array = (int*) malloc(sizeof(int) * blocks);
+  for(int i = 0; i < blocks; i++){
     array[i] = 0;
   }
 
-  int temp = sht_info->hashTable[hash]; // To go from block to block need to take a temporary because we cant change hashTable value at the end of the loop
-  while(1){
-    CALL_OR_DIE(BF_GetBlock(sht_info->fileDesc, temp, block));
-    data = BF_Block_GetData(block);
+  // The filter knows it without reading the bucket
+  if(sht_info->hashTable[hash] != -1 && (sht_info->filterHashes == 0 || SHT_FilterMayContain(sht_info, hash, name))){
+    noEntry += SHT_Search(ht_info, sht_info, sht_info->hashTable[hash], name, array, blocks, &total);
+  }
+  if(oldHead != -1){
+    noEntry += SHT_Search(ht_info, sht_info, oldHead, name, array, blocks, &total);
+  }
 
-    void* record = data;
-    void* blockId = data + SHT_RecordNameOffset();
-    SHT_block_info* block_info = data + SHT_MetadataOffset(sht_info);
+  if(noEntry == 0){
+    printf("There is no entry with this name.\n");
+  }
+  
+  free(array);
 
-    for(int i = 0; i < block_info->recNumber; i++){
-      if((strcmp((char*) record, (char*) name) == 0) && (array[*(int*) blockId] != 1)){ // Check if this is the name but also if we visited that block previously
-        CALL_OR_DIE(BF_GetBlock(ht_info->fileDesc, *(int*) blockId, blockHT));
-        dataHT = BF_Block_GetData(blockHT);
+  return total;
+}
 
-        Record* rec = dataHT;
-        HT_block_info* ht_block_info = dataHT + ht_info->maxBlockRecs * sizeof(Record);
+int SHT_SecondaryGetAllEntries(HT_info* ht_info, SHT_info* sht_info, char* name){
+  TRACE_FUNCTION();
+  int file = sht_info->fileDesc;
 
-        for(int j = 0; j < ht_block_info->recNumber; j++){
-          if(strcmp(rec->name, (char*) record) == 0){
-            printRecord(*rec);
-            noEntry++;
-          }
-          rec = dataHT + sizeof(Record) * (j + 1);  // Going to the next record of the block
-        }
-        total++;
+  BF_LatchDirectory(file, BF_LATCH_SHARED);
+  int hash = SHT_Function((unsigned char*) name, sht_info->numBuckets, sht_info->hashSeed);
+  BF_LatchBucket(file, hash, BF_LATCH_SHARED);
+  int total = SHT_Lookup(ht_info, sht_info, hash, name);
+  BF_UnlatchBucket(file, hash);
+  BF_UnlatchDirectory(file);
 
-        CALL_OR_DIE(BF_UnpinBlock(blockHT));
+  return total;
+}
 
-        array[*(int*) blockId] = 1;   // Block visited so change the value 
-      }
-      record = data + (SHT_RecordNameOffset() + sizeof(unsigned int)) * (i + 1);   // Going to the next record & block id of the block
-      blockId = record + SHT_RecordNameOffset();
-    }
-    total++;
+void SHT_SetSkewThreshold(double threshold){
+  skewThreshold = threshold;
+}
 
-    CALL_OR_DIE(BF_UnpinBlock(block));
+double SHT_Skew(SHT_info* sht_info){
+  BF_LatchFile(sht_info->fileDesc);
+  double skew = sht_info->tableBlocks == 0 ? 0 : (double) sht_info->maxChain * sht_info->numBuckets / sht_info->tableBlocks;
+  BF_UnlatchFile(sht_info->fileDesc);
 
-    if(block_info->hashBucket == -1){
-      break;
+  return skew;
+}
+
+int SHT_BuildFromPrimary(HT_info* ht_info, SHT_info* sht_info, int threads){
+  TRACE_FUNCTION();
+  if(BF_IsMappedFile(sht_info->fileDesc)){
+    printf("The file is opened read only.\n");
+    return SHT_ERROR;
+  }
+
+  if(threads < 1){
+    threads = 1;
+  }
+
+  BF_LatchDirectory(ht_info->fileDesc, BF_LATCH_EXCLUSIVE);    // No insert changes the hashtable blocks while they are read
+  BF_LatchDirectory(sht_info->fileDesc, BF_LATCH_EXCLUSIVE);   // Nor the buckets of the index while they are written
+
+  SHT_build build;
+  build.ht_info = ht_info;
+  build.sht_info = sht_info;
+  build.workers = threads;
+  build.nextBlock = 1;
+  build.nextBucket = 0;
+  build.partitions = calloc(threads * sht_info->numBuckets, sizeof(SHT_partition));
+  build.error = 0;
+
+  SHT_builder* builders = calloc(threads, sizeof(SHT_builder));
+  if(build.partitions == NULL || builders == NULL){
+    BF_UnlatchDirectory(sht_info->fileDesc);
+    BF_UnlatchDirectory(ht_info->fileDesc);
+    free(build.partitions);
+    free(builders);
+    return SHT_ERROR;
+  }
+  for(int i = 0; i < threads; i++){
+    builders[i].build = &build;
+    builders[i].index = i;
+  }
+
+  SHT_RunWorkers(builders, threads, SHT_PartitionWorker);
+  int entries = 0;
+  if(!build.error){
+    SHT_RunWorkers(builders, threads, SHT_BucketWorker);
+    for(int i = 0; i < threads; i++){
+      entries += builders[i].entries;
     }
-    
-    temp = block_info->hashBucket;  // Giving the next we point
   }
 
-  if(noEntry == 0){
-    printf("There is no entry with this name.\n");
+  BF_UnlatchDirectory(sht_info->fileDesc);
+  BF_UnlatchDirectory(ht_info->fileDesc);
+
+  for(int i = 0; i < threads * sht_info->numBuckets; i++){
+    free(build.partitions[i].entries);
   }
-  
-  free(array);
-  BF_Block_Destroy(&block);
-  BF_Block_Destroy(&blockHT);
+  free(build.partitions);
+  free(builders);
 
-  return total;
-}
\ No newline at end of file
+  return build.error ? SHT_ERROR : entries;
+}
@@ -0,0 +1,332 @@
+#define _GNU_SOURCE
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+#include "bf.h"
+#include "trace.h"
+
+const char* TRACE_TypeNames[TRACE_TYPES] = {"enter", "exit", "pin", "unpin", "evict", "read", "write"};
+
+#ifdef BF_TRACE
+
+#define TRACE_BLOCKS 1024     // BF_Block -> block of its last pin, for the unpins (BF_Block is opaque)
+#define TRACE_FDS 1024        // Kernel fd -> file_desc of the BF layer, for the reads and writes of libbf
+
+typedef struct{
+  uint64_t time;
+  const char* name;     // Function of an enter or exit, NULL for the block events
+  int type;
+  int thread;
+  int file;
+  int block;
+}TRACE_Event;
+
+typedef struct{
+  BF_Block* block;
+  int file;
+  int number;
+}TRACE_Pinned;
+
+static TRACE_Event* ring = NULL;
+static long ringSize = 0;
+static unsigned long recorded = 0;      // Events ever recorded, the next one goes to recorded % ringSize
+static int threads = 0;
+static __thread int thread = 0;         // 1, 2, ... in the order the threads record their first event
+
+static TRACE_Pinned pinned[TRACE_BLOCKS];
+static int fdFiles[TRACE_FDS];          // file_desc + 1, 0 if the fd is not a BF file
+static __thread int inBF = 0;           // Set while a BF call runs, so only its reads and writes are kept
+static __thread int pinning = 0;        // Set in BF_GetBlock and BF_AllocateBlock, their writes are evicts
+static __thread int allocated = -1;     // Block BF_AllocateBlock adds, libbf writes it to grow the file (not an evict)
+static __thread int openedFd = -1;      // Last fd libbf opened, during BF_OpenFile
+
+/**** Helpers ****/
+
+static uint64_t TRACE_Now(void){
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t) time.tv_sec * 1000000000ULL + time.tv_nsec;
+}
+
+static TRACE_Pinned* TRACE_PinnedOf(BF_Block* block){
+  return &pinned[((uintptr_t) block >> 4) % TRACE_BLOCKS];
+}
+
+static void TRACE_Pin(BF_Block* block, int file_desc, int block_num){
+  TRACE_Pinned* entry = TRACE_PinnedOf(block);   // A collision just loses the block number of an unpin
+
+  entry->block = block;
+  entry->file = file_desc;
+  entry->number = block_num;
+  TRACE_Record(TRACE_PIN, NULL, file_desc, block_num);
+}
+
+// The real function of the next object (libbf or libc) for the interposed ones below
+static void* TRACE_Real(const char* symbol){
+  void* function = dlsym(RTLD_NEXT, symbol);
+
+  if(function == NULL){
+    fprintf(stderr, "trace: no %s\n", symbol);
+    abort();
+  }
+
+  return function;
+}
+
+// The block of fd that the next read or write of libbf goes to, and the BF file of the fd
+static int TRACE_BlockOf(int fd, int* file_desc){
+  if(!inBF || fd < 0 || fd >= TRACE_FDS || fdFiles[fd] == 0){
+    return -1;
+  }
+
+  *file_desc = fdFiles[fd] - 1;
+  off_t offset = lseek(fd, 0, SEEK_CUR);
+
+  return offset < 0 ? -1 : (int) (offset / BF_BLOCK_SIZE);
+}
+
+/**** Trace functions ****/
+
+int TRACE_Start(long events){
+  TRACE_Stop();
+
+  ringSize = events > 0 ? events : TRACE_DEFAULT_EVENTS;
+  ring = malloc(ringSize * sizeof(TRACE_Event));
+  if(ring == NULL){
+    ringSize = 0;
+    return -1;
+  }
+  recorded = 0;
+
+  return 0;
+}
+
+void TRACE_Stop(void){
+  TRACE_Event* old = ring;
+
+  ring = NULL;
+  ringSize = 0;
+  free(old);
+}
+
+int TRACE_Dump(const char* filename){
+  if(ring == NULL){
+    return -1;
+  }
+
+  FILE* log = fopen(filename, "w");
+  if(log == NULL){
+    return -1;
+  }
+
+  unsigned long first = recorded > (unsigned long) ringSize ? recorded - ringSize : 0;
+  for(unsigned long i = first; i < recorded; i++){
+    TRACE_Event* event = &ring[i % ringSize];
+    fprintf(log, "%lu %d %s %d %d %s\n", (unsigned long) event->time, event->thread, TRACE_TypeNames[event->type],
+            event->file, event->block, event->name != NULL ? event->name : "-");
+  }
+
+  return fclose(log) == 0 ? 0 : -1;
+}
+
+void TRACE_Record(TRACE_Type type, const char* name, int file_desc, int block_num){
+  if(ring == NULL){
+    return;
+  }
+  if(thread == 0){
+    thread = __atomic_add_fetch(&threads, 1, __ATOMIC_RELAXED);
+  }
+
+  unsigned long slot = __atomic_fetch_add(&recorded, 1, __ATOMIC_RELAXED);
+  TRACE_Event* event = &ring[slot % ringSize];
+  event->time = TRACE_Now();
+  event->name = name;
+  event->type = type;
+  event->thread = thread;
+  event->file = file_desc;
+  event->block = block_num;
+}
+
+TRACE_Scope TRACE_Enter(const char* name){
+  TRACE_Record(TRACE_ENTER, name, -1, -1);
+  return name;
+}
+
+void TRACE_Leave(TRACE_Scope* scope){
+  TRACE_Record(TRACE_EXIT, *scope, -1, -1);
+}
+
+/**** Interposed BF layer functions ****/
+
+// A program built with trace.c defines these, so they are called instead of the ones of libbf (by libbf too)
+
+BF_ErrorCode BF_OpenFile(const char* filename, int* file_desc){
+  static BF_ErrorCode (*real)(const char*, int*) = NULL;
+  if(real == NULL){
+    real = TRACE_Real("BF_OpenFile");
+  }
+
+  openedFd = -1;
+  inBF = 1;
+  BF_ErrorCode code = real(filename, file_desc);
+  inBF = 0;
+  if(code == BF_OK && openedFd >= 0 && openedFd < TRACE_FDS){
+    fdFiles[openedFd] = *file_desc + 1;
+  }
+
+  return code;
+}
+
+BF_ErrorCode BF_CloseFile(const int file_desc){
+  static BF_ErrorCode (*real)(const int) = NULL;
+  if(real == NULL){
+    real = TRACE_Real("BF_CloseFile");
+  }
+
+  inBF = 1;
+  BF_ErrorCode code = real(file_desc);
+  inBF = 0;
+  for(int fd = 0; fd < TRACE_FDS; fd++){
+    if(fdFiles[fd] == file_desc + 1){
+      fdFiles[fd] = 0;
+    }
+  }
+
+  return code;
+}
+
+BF_ErrorCode BF_Close(){
+  static BF_ErrorCode (*real)(void) = NULL;
+  if(real == NULL){
+    real = TRACE_Real("BF_Close");
+  }
+
+  inBF = 1;     // The dirty blocks of the files still open are written here
+  BF_ErrorCode code = real();
+  inBF = 0;
+  memset(fdFiles, 0, sizeof(fdFiles));
+
+  return code;
+}
+
+BF_ErrorCode BF_AllocateBlock(const int file_desc, BF_Block* block){
+  static BF_ErrorCode (*real)(const int, BF_Block*) = NULL;
+  if(real == NULL){
+    real = TRACE_Real("BF_AllocateBlock");
+  }
+
+  if(inBF){    // Called from inside libbf, only the outer call is kept
+    return real(file_desc, block);
+  }
+  int blocks = -1;
+  BF_GetBlockCounter(file_desc, &blocks);
+  inBF = pinning = 1;
+  allocated = blocks;
+  BF_ErrorCode code = real(file_desc, block);
+  inBF = pinning = 0;
+  allocated = -1;
+  if(code == BF_OK){
+    TRACE_Pin(block, file_desc, blocks);
+  }
+
+  return code;
+}
+
+BF_ErrorCode BF_GetBlock(const int file_desc, const int block_num, BF_Block* block){
+  static BF_ErrorCode (*real)(const int, const int, BF_Block*) = NULL;
+  if(real == NULL){
+    real = TRACE_Real("BF_GetBlock");
+  }
+
+  if(inBF){    // Called from inside libbf, only the outer call is kept
+    return real(file_desc, block_num, block);
+  }
+  inBF = pinning = 1;
+  BF_ErrorCode code = real(file_desc, block_num, block);
+  inBF = pinning = 0;
+  if(code == BF_OK){
+    TRACE_Pin(block, file_desc, block_num);
+  }
+
+  return code;
+}
+
+BF_ErrorCode BF_UnpinBlock(BF_Block* block){
+  static BF_ErrorCode (*real)(BF_Block*) = NULL;
+  if(real == NULL){
+    real = TRACE_Real("BF_UnpinBlock");
+  }
+
+  if(inBF){    // Called from inside libbf, only the outer call is kept
+    return real(block);
+  }
+  TRACE_Pinned* entry = TRACE_PinnedOf(block);
+  int found = entry->block == block;
+  TRACE_Record(TRACE_UNPIN, NULL, found ? entry->file : -1, found ? entry->number : -1);
+
+  inBF = 1;
+  BF_ErrorCode code = real(block);
+  inBF = 0;
+
+  return code;
+}
+
+/**** Interposed libc functions ****/
+
+int open(const char* path, int flags, ...){
+  static int (*real)(const char*, int, ...) = NULL;
+  if(real == NULL){
+    real = TRACE_Real("open");
+  }
+
+  va_list arguments;
+  va_start(arguments, flags);
+  int mode = va_arg(arguments, int);    // Harmless when flags has no O_CREAT
+  va_end(arguments);
+
+  int fd = real(path, flags, mode);
+  if(inBF){
+    openedFd = fd;
+  }
+
+  return fd;
+}
+
+ssize_t read(int fd, void* buffer, size_t count){
+  static ssize_t (*real)(int, void*, size_t) = NULL;
+  if(real == NULL){
+    real = TRACE_Real("read");
+  }
+
+  int file_desc;
+  int block_num = TRACE_BlockOf(fd, &file_desc);
+  ssize_t bytes = real(fd, buffer, count);
+  if(block_num >= 0 && bytes == BF_BLOCK_SIZE){
+    TRACE_Record(TRACE_READ, NULL, file_desc, block_num);
+  }
+
+  return bytes;
+}
+
+ssize_t write(int fd, const void* buffer, size_t count){
+  static ssize_t (*real)(int, const void*, size_t) = NULL;
+  if(real == NULL){
+    real = TRACE_Real("write");
+  }
+
+  int file_desc;
+  int block_num = TRACE_BlockOf(fd, &file_desc);
+  ssize_t bytes = real(fd, buffer, count);
+  if(block_num >= 0 && bytes == BF_BLOCK_SIZE){
+    TRACE_Record(pinning && block_num != allocated ? TRACE_EVICT : TRACE_WRITE, NULL, file_desc, block_num);
+  }
+
+  return bytes;
+}
+
+#endif
@@ -0,0 +1,317 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "bf.h"
+#include "wal.h"
+
+// On disk every record is its header followed by length bytes of payload
+typedef struct{
+  int length;
+  unsigned int checksum;    // Of the payload, a record torn by a crash does not match
+}WAL_RecordHeader;
+
+typedef struct{
+  int attached;
+  int fd;
+  WAL_Mode mode;
+  char* path;
+  char buffer[WAL_BUFFER_SIZE];
+  int used;                 // Bytes of the buffer
+  int buffered;             // Records in the buffer
+  int unsynced;             // Records written to the OS but not yet to the disk
+}WAL_File;
+
+static WAL_Mode walMode = WAL_GROUP;
+static WAL_File walFiles[BF_MAX_OPEN_FILES];
+
+/**** Helpers ****/
+
+static unsigned int WAL_Checksum(const void* payload, int length){
+  const unsigned char* bytes = payload;
+  unsigned int hash = 2166136261u;
+
+  for(int i = 0; i < length; i++){
+    hash ^= bytes[i];
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+static WAL_File* WAL_Get(int file_desc){
+  if(file_desc < 0 || file_desc >= BF_MAX_OPEN_FILES || !walFiles[file_desc].attached){
+    return NULL;
+  }
+
+  return &walFiles[file_desc];
+}
+
+static int WAL_Sync(WAL_File* wal){
+  if(fdatasync(wal->fd) != 0){
+    perror("WAL");
+    return -1;
+  }
+  wal->unsynced = 0;
+
+  return 0;
+}
+
+static int WAL_WriteBuffer(WAL_File* wal){
+  int written = 0;
+
+  while(written < wal->used){
+    ssize_t bytes = write(wal->fd, wal->buffer + written, wal->used - written);
+    if(bytes < 0){
+      perror("WAL");
+      return -1;
+    }
+    written += bytes;
+  }
+
+  wal->unsynced += wal->buffered;
+  wal->used = 0;
+  wal->buffered = 0;
+
+  return 0;
+}
+
+/**** WAL functions ****/
+
+void WAL_SetMode(WAL_Mode mode){
+  walMode = mode;
+}
+
+WAL_Mode WAL_GetMode(void){
+  return walMode;
+}
+
+void WAL_Discard(const char* filename){
+  char* path = malloc(strlen(filename) + strlen(".wal") + 1);
+  if(path == NULL){
+    return;
+  }
+  sprintf(path, "%s.wal", filename);
+
+  unlink(path);
+  free(path);
+}
+
+int WAL_Attach(const char* filename, const int file_desc){
+  if(file_desc < 0 || file_desc >= BF_MAX_OPEN_FILES){
+    return -1;
+  }
+
+  char* path = malloc(strlen(filename) + strlen(".wal") + 1);
+  if(path == NULL){
+    return -1;
+  }
+  sprintf(path, "%s.wal", filename);
+
+  if(walMode == WAL_NONE && access(path, F_OK) != 0){   // Nothing to log and nothing to recover
+    free(path);
+    return 0;
+  }
+
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if(fd < 0){
+    perror("WAL");
+    free(path);
+    return -1;
+  }
+
+  WAL_File* wal = &walFiles[file_desc];
+  wal->attached = 1;
+  wal->fd = fd;
+  wal->mode = walMode;
+  wal->path = path;
+  wal->used = 0;
+  wal->buffered = 0;
+  wal->unsynced = 0;
+
+  return 0;
+}
+
+int WAL_Replay(const int file_desc, WAL_Redo redo, void* context){
+  WAL_File* wal = WAL_Get(file_desc);
+  struct stat info;
+
+  if(wal == NULL){
+    return 0;
+  }
+
+  if(fstat(wal->fd, &info) != 0){
+    perror("WAL");
+    return -1;
+  }
+
+  char* log = malloc(info.st_size > 0 ? info.st_size : 1);
+  if(log == NULL){
+    printf("WAL: no memory for the %ld bytes of %s.\n", (long) info.st_size, wal->path);
+    return -1;
+  }
+  ssize_t size = pread(wal->fd, log, info.st_size, 0);
+  if(size < 0){
+    perror("WAL");
+    free(log);
+    return -1;
+  }
+
+  int records = 0;
+  ssize_t offset = 0;
+  while(offset + (ssize_t) sizeof(WAL_RecordHeader) <= size){
+    WAL_RecordHeader header;
+    memcpy(&header, log + offset, sizeof(WAL_RecordHeader));
+
+    ssize_t end = offset + sizeof(WAL_RecordHeader) + header.length;
+    if(header.length <= 0 || end > size || WAL_Checksum(log + offset + sizeof(WAL_RecordHeader), header.length) != header.checksum){
+      break;    // Torn by a crash, everything after it was never completely written
+    }
+
+    redo(context, log + offset + sizeof(WAL_RecordHeader), header.length);
+    records++;
+    offset = end;
+  }
+  free(log);
+
+  // The replayed records stay in the log until the file closes cleanly, the new ones go after them
+  if(ftruncate(wal->fd, offset) != 0 || lseek(wal->fd, offset, SEEK_SET) < 0){
+    perror("WAL");
+    return -1;
+  }
+
+  return records;
+}
+
+void WAL_Log(const int file_desc, const void* payload, const int length){
+  WAL_File* wal = WAL_Get(file_desc);
+  WAL_RecordHeader header;
+
+  if(wal == NULL || wal->mode == WAL_NONE){
+    return;
+  }
+
+  if(wal->used + (int) sizeof(WAL_RecordHeader) + length > WAL_BUFFER_SIZE){
+    WAL_WriteBuffer(wal);   // Writing earlier than asked is always safe
+  }
+
+  header.length = length;
+  header.checksum = WAL_Checksum(payload, length);
+
+  memcpy(wal->buffer + wal->used, &header, sizeof(WAL_RecordHeader));
+  memcpy(wal->buffer + wal->used + sizeof(WAL_RecordHeader), payload, length);
+  wal->used += sizeof(WAL_RecordHeader) + length;
+  wal->buffered++;
+}
+
+int WAL_Write(const int file_desc){
+  WAL_File* wal = WAL_Get(file_desc);
+
+  if(wal == NULL || wal->mode == WAL_NONE || wal->buffered == 0){
+    return 0;
+  }
+
+  if(WAL_WriteBuffer(wal) != 0){
+    return -1;
+  }
+
+  if(wal->mode == WAL_SYNC || wal->unsynced >= WAL_GROUP_SIZE){
+    return WAL_Sync(wal);
+  }
+
+  return 0;
+}
+
+int WAL_Commit(const int file_desc){
+  WAL_File* wal = WAL_Get(file_desc);
+
+  if(wal == NULL){
+    return 0;
+  }
+
+  if(wal->used > 0 && WAL_WriteBuffer(wal) != 0){
+    return -1;
+  }
+
+  if(wal->unsynced > 0){
+    return WAL_Sync(wal);
+  }
+
+  return 0;
+}
+
+int WAL_Truncate(const int file_desc){
+  WAL_File* wal = WAL_Get(file_desc);
+
+  if(wal == NULL){
+    return 0;
+  }
+
+  wal->used = 0;    // Not written yet, but their changes are in the file already
+  wal->buffered = 0;
+  wal->unsynced = 0;
+
+  if(ftruncate(wal->fd, 0) != 0 || lseek(wal->fd, 0, SEEK_SET) < 0){
+    perror("WAL");
+    return -1;
+  }
+
+  return 0;
+}
+
+// BF_CloseFile writes the blocks back without syncing them, the data file must be on the disk before its log goes
+static int WAL_SyncData(WAL_File* wal){
+  int length = strlen(wal->path) - strlen(".wal");
+  char* filename = malloc(length + 1);
+  if(filename == NULL){
+    return -1;
+  }
+  memcpy(filename, wal->path, length);
+  filename[length] = '\0';
+
+  int fd = open(filename, O_RDONLY);
+  int result = fd >= 0 && fdatasync(fd) == 0 ? 0 : -1;
+  if(result != 0){
+    perror(filename);
+  }
+  if(fd >= 0){
+    close(fd);
+  }
+  free(filename);
+
+  return result;
+}
+
+int WAL_Detach(const int file_desc){
+  WAL_File* wal = WAL_Get(file_desc);
+
+  if(wal == NULL){
+    return 0;
+  }
+
+  int result = WAL_SyncData(wal);
+  close(wal->fd);
+  if(result == 0){
+    unlink(wal->path);    // Every change is in the data file now
+  }
+  free(wal->path);
+  wal->attached = 0;
+
+  return result;
+}
+
+void WAL_Close(const int file_desc){
+  WAL_File* wal = WAL_Get(file_desc);
+
+  if(wal == NULL){
+    return;
+  }
+
+  WAL_Commit(file_desc);    // The buffered records too, they are the only copy of their changes
+  close(wal->fd);
+  free(wal->path);
+  wal->attached = 0;
+}
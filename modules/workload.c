@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "record.h"
+#include "workload.h"
+
+#define NAME_SIZE sizeof(((Record*) 0)->name)
+#define SURNAME_SIZE sizeof(((Record*) 0)->surname)
+#define CITY_SIZE sizeof(((Record*) 0)->city)
+
+struct WORKLOAD{
+  WORKLOAD_Config config;
+  uint64_t seed;
+  char (*names)[NAME_SIZE];         // Zero padded, so a record gets them with a fixed size copy
+  char (*surnames)[SURNAME_SIZE];
+  char (*cities)[CITY_SIZE];
+  double zetan;                     // Zipf constants, see WORKLOAD_Zipf
+  double zipfEta;
+  double zipfAlpha;
+  double zipfHalf;                  // 1 + 0.5^skew
+};
+
+/**** Random numbers ****/
+
+static uint64_t WORKLOAD_SplitMix(uint64_t* x){
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static inline uint64_t WORKLOAD_Rotate(uint64_t x, int k){
+  return (x << k) | (x >> (64 - k));
+}
+
+// xoshiro256**
+static inline uint64_t WORKLOAD_Random(WORKLOAD_Stream* stream){
+  uint64_t* s = stream->state;
+  uint64_t result = WORKLOAD_Rotate(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = WORKLOAD_Rotate(s[3], 45);
+
+  return result;
+}
+
+// Uniform in [0, n), by multiplying instead of % (Lemire)
+static inline int WORKLOAD_Below(WORKLOAD_Stream* stream, int n){
+  return (int) (((WORKLOAD_Random(stream) >> 32) * (uint64_t) n) >> 32);
+}
+
+// Uniform in [0, 1)
+static inline double WORKLOAD_Unit(WORKLOAD_Stream* stream){
+  return (WORKLOAD_Random(stream) >> 11) * 0x1.0p-53;
+}
+
+/**** Ids ****/
+
+// Gray et al., "Quickly generating billion-record synthetic databases": one draw, the constants are computed once
+static int WORKLOAD_Zipf(WORKLOAD_Stream* stream){
+  const WORKLOAD* workload = stream->workload;
+  double u = WORKLOAD_Unit(stream);
+  double uz = u * workload->zetan;
+
+  if(uz < 1.0){
+    return 0;
+  }
+  if(uz < workload->zipfHalf){
+    return 1;
+  }
+
+  int id = (int) (workload->config.keys * pow(workload->zipfEta * u - workload->zipfEta + 1.0, workload->zipfAlpha));
+
+  return id < workload->config.keys ? id : workload->config.keys - 1;
+}
+
+static int WORKLOAD_Id(WORKLOAD_Stream* stream){
+  const WORKLOAD_Config* config = &stream->workload->config;
+  long id;
+
+  switch(config->distribution){
+    case WORKLOAD_SEQUENTIAL:
+      id = stream->next;
+      stream->next += stream->step;
+      return (int) id;
+    case WORKLOAD_UNIFORM:
+      return WORKLOAD_Below(stream, config->keys);
+    case WORKLOAD_ZIPF:
+      return WORKLOAD_Zipf(stream);
+    default:
+      if(WORKLOAD_Unit(stream) < config->hotFraction){
+        return WORKLOAD_Below(stream, config->hotKeys);
+      }
+      return WORKLOAD_Below(stream, config->keys);
+  }
+}
+
+/**** Strings ****/
+
+// Value i of an attribute: the first ones are the values of record.c, then they repeat with a number after them
+static void* WORKLOAD_Strings(const char* base[], int baseCount, int cardinality, int size){
+  char* table = calloc(cardinality, size);
+
+  if(table == NULL){
+    return NULL;
+  }
+
+  for(int i = 0; i < cardinality; i++){
+    if(i < baseCount){
+      snprintf(table + (size_t) i * size, size, "%s", base[i]);
+    }else{
+      snprintf(table + (size_t) i * size, size, "%s%d", base[i % baseCount], i / baseCount);
+    }
+  }
+
+  return table;
+}
+
+/**** Workload functions ****/
+
+WORKLOAD* WORKLOAD_Create(const WORKLOAD_Config* config, uint64_t seed){
+  if(config->names < 1 || config->names > WORKLOAD_MAX_CARDINALITY || config->surnames < 1 || config->surnames > WORKLOAD_MAX_CARDINALITY ||
+     config->cities < 1 || config->cities > WORKLOAD_MAX_CARDINALITY){
+    return NULL;
+  }
+  if(config->distribution != WORKLOAD_SEQUENTIAL && config->keys < 1){
+    return NULL;
+  }
+  if(config->distribution == WORKLOAD_ZIPF && (config->skew <= 0.0 || config->skew >= 1.0)){
+    return NULL;
+  }
+  if(config->distribution == WORKLOAD_DUPLICATES && (config->hotKeys < 1 || config->hotFraction < 0.0 || config->hotFraction > 1.0)){
+    return NULL;
+  }
+
+  WORKLOAD* workload = malloc(sizeof(WORKLOAD));
+  if(workload == NULL){
+    return NULL;
+  }
+
+  workload->config = *config;
+  workload->seed = seed;
+  workload->names = WORKLOAD_Strings(names, nameCount, config->names, NAME_SIZE);
+  workload->surnames = WORKLOAD_Strings(surnames, surnameCount, config->surnames, SURNAME_SIZE);
+  workload->cities = WORKLOAD_Strings(cities, cityCount, config->cities, CITY_SIZE);
+  if(workload->names == NULL || workload->surnames == NULL || workload->cities == NULL){
+    WORKLOAD_Destroy(workload);
+    return NULL;
+  }
+
+  if(config->distribution == WORKLOAD_ZIPF){
+    double zeta2 = 1.0 + pow(0.5, config->skew);
+
+    workload->zetan = 0;
+    for(int i = 1; i <= config->keys; i++){   // Once per workload, O(keys)
+      workload->zetan += 1.0 / pow(i, config->skew);
+    }
+    workload->zipfAlpha = 1.0 / (1.0 - config->skew);
+    workload->zipfEta = (1.0 - pow(2.0 / config->keys, 1.0 - config->skew)) / (1.0 - zeta2 / workload->zetan);
+    workload->zipfHalf = zeta2;
+  }
+
+  return workload;
+}
+
+void WORKLOAD_Destroy(WORKLOAD* workload){
+  free(workload->names);
+  free(workload->surnames);
+  free(workload->cities);
+  free(workload);
+}
+
+void WORKLOAD_StreamInit(WORKLOAD_Stream* stream, const WORKLOAD* workload, int number, int streams){
+  uint64_t x = workload->seed ^ ((uint64_t) number * 0xd1b54a32d192ed03ULL);
+
+  stream->workload = workload;
+  for(int i = 0; i < 4; i++){
+    stream->state[i] = WORKLOAD_SplitMix(&x);
+  }
+  stream->next = (long) workload->config.firstId + number;
+  stream->step = streams;
+}
+
+Record WORKLOAD_Next(WORKLOAD_Stream* stream){
+  Record record;
+
+  WORKLOAD_Fill(stream, &record, 1);
+
+  return record;
+}
+
+void WORKLOAD_Fill(WORKLOAD_Stream* stream, Record records[], int count){
+  const WORKLOAD* workload = stream->workload;
+
+  for(int i = 0; i < count; i++){
+    Record* record = &records[i];
+
+    memcpy(record->record, "record", sizeof("record"));
+    record->id = WORKLOAD_Id(stream);
+    memcpy(record->name, workload->names[WORKLOAD_Below(stream, workload->config.names)], NAME_SIZE);
+    memcpy(record->surname, workload->surnames[WORKLOAD_Below(stream, workload->config.surnames)], SURNAME_SIZE);
+    memcpy(record->city, workload->cities[WORKLOAD_Below(stream, workload->config.cities)], CITY_SIZE);
+  }
+}
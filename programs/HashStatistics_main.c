@@ -35,6 +35,15 @@ int main(){
         SHT_SecondaryInsertEntry(index_info, record, block_id);
     }
 
+    printf("\nTime to close the files, the statistics read the headers they write back.\n");
+
+    if(SHT_CloseSecondaryIndex(index_info) == 0){
+    printf("\nFile %s closed successfully\n", INDEX_NAME);
+    }
+    if(HT_CloseFile(info) == 0){
+        printf("File %s closed successfully\n", FILE_NAME);
+    }
+
     printf("\n.......Run statistics for Hashtable.......\n");
 
     if(HashStatistics(FILE_NAME) == 0){
@@ -47,14 +56,12 @@ int main(){
         printf("Statistics for Secondary Hashtable done.\n");
     }
 
-    printf("\nTime to close the files.\n");
+    printf("\n.......Sampled statistics for Hashtable, half of the buckets, as JSON.......\n");
 
-    if(SHT_CloseSecondaryIndex(index_info) == 0){
-    printf("\nFile %s closed successfully\n", INDEX_NAME);
-    }
-    if(HT_CloseFile(info) == 0){
-        printf("File %s closed successfully\n", FILE_NAME);
+    if(HashStatisticsSampled(FILE_NAME, 0.5, 12569874, 1) == 0){
+        printf("Sampled statistics for Hashtable done.\n");
     }
+
     BF_Close();
 
     remove(FILE_NAME);
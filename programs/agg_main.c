@@ -0,0 +1,87 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bf.h"
+#include "hp_file.h"
+#include "ht_table.h"
+#include "wal.h"
+#include "hash_aggregate.h"
+
+#define BUCKETS 50              // Number of buckets in hashtable
+#define RECORDS_NUM 20000       // Number of records in database
+#define SMALL_BUDGET 16384      // Bytes, room for about 160 groups so grouping by id spills
+#define HT_FILE_NAME "data.db"
+#define HP_FILE_NAME "heap.db"
+
+typedef struct{
+  long groups;
+  long records;     // Sum of the counts, must be RECORDS_NUM
+  long minSum;      // Sum of the minimum ids, the same for every way of aggregating
+}Totals;
+
+static void printCity(void* context, const AGG_Group* group){
+  (void) context;
+  printf("  %-14s %6ld records, ids %5d .. %5d\n", group->key.city, group->count, group->minId, group->maxId);
+}
+
+static void total(void* context, const AGG_Group* group){
+  Totals* totals = context;
+
+  totals->groups++;
+  totals->records += group->count;
+  totals->minSum += group->minId;
+}
+
+static double now(void){
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static void totals(const char* title, HP_info* hpInfo, Record_Attribute attribute, size_t budget){
+  Totals totals = {0, 0, 0};
+
+  double start = now();
+  long groups = AGG_HeapFile(hpInfo, attribute, budget, total, &totals);
+  double seconds = now() - start;
+
+  printf("%-18s: %ld groups (%ld emitted, %ld records, min id sum %ld) in %.2f ms\n",
+         title, groups, totals.groups, totals.records, totals.minSum, seconds * 1e3);
+}
+
+int main(){
+  srand(12569874);
+
+  BF_Init(LRU);
+  WAL_SetMode(WAL_NONE);
+  HT_CreateFile(HT_FILE_NAME, BUCKETS);
+  HP_CreateFile(HP_FILE_NAME);
+
+  HT_info* htInfo = HT_OpenFile(HT_FILE_NAME);
+  HP_info* hpInfo = HP_OpenFile(HP_FILE_NAME);
+
+  for(int i = 0; i < RECORDS_NUM; i++){
+    Record record = randomRecord();
+    HP_InsertEntry(hpInfo, record);
+    HT_InsertEntry(htInfo, record);
+  }
+
+  printf("Inserted %d records.\n\nCount, min and max id by city (hashtable):\n", RECORDS_NUM);
+  AGG_HashtableFile(htInfo, CITY, 64 * 1024, printCity, NULL);
+
+  printf("\n");
+  totals("Surname", hpInfo, SURNAME, 64 * 1024);
+  totals("Id, in memory", hpInfo, ID, 64 * 1024 * 1024);
+  totals("Id, spilled", hpInfo, ID, SMALL_BUDGET);
+
+  HT_CloseFile(htInfo);
+  HP_CloseFile(hpInfo);
+  BF_Close();
+
+  remove(HT_FILE_NAME);
+  remove(HP_FILE_NAME);
+
+  return 0;
+}
@@ -0,0 +1,105 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bf.h"
+#include "hp_file.h"
+#include "wal.h"
+#include "batch.h"
+
+#define RECORDS_NUM 20000   // Number of records in database
+#define SCANS 200           // Scans timed for every way of running the query
+#define HP_FILE_NAME "heap.db"
+
+// The query: SELECT id, surname FROM heap WHERE id BETWEEN 5000 AND 15000 AND city = 'Athens'
+#define LOW_ID 5000
+#define HIGH_ID 15000
+#define CITY_NAME "Athens"
+
+typedef struct{
+  long rows;
+  long checksum;    // Sum of id + length of surname of every row, the same for both ways
+}Totals;
+
+static double now(void){
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/**** A record at a time, every record is passed by value like HT_InsertEntry and printRecord do ****/
+
+static __attribute__((noinline)) void tuple(Totals* totals, Record record){
+  if(record.id >= LOW_ID && record.id <= HIGH_ID && strcmp(record.city, CITY_NAME) == 0){
+    totals->rows++;
+    totals->checksum += record.id + strlen(record.surname);
+  }
+}
+
+static void tuplePage(void* context, const Record* records, int count){
+  for(int i = 0; i < count; i++){
+    tuple(context, records[i]);
+  }
+}
+
+/**** A batch at a time ****/
+
+static void sink(void* context, BATCH_Vector* batch){
+  Totals* totals = context;
+
+  for(int i = 0; i < batch->selected; i++){
+    int row = batch->selection[i];
+    totals->checksum += *(const int*) batch->columns[0][row] + strnlen(batch->columns[1][row], sizeof(batch->rows[0].surname));
+  }
+  totals->rows += batch->selected;
+}
+
+int main(){
+  srand(12569874);
+
+  BF_Init(LRU);
+  WAL_SetMode(WAL_NONE);
+  HP_CreateFile(HP_FILE_NAME);
+  HP_info* hpInfo = HP_OpenFile(HP_FILE_NAME);
+
+  for(int i = 0; i < RECORDS_NUM; i++){
+    HP_InsertEntry(hpInfo, randomRecord());
+  }
+
+  HP_CloseFile(hpInfo);   // Scanned mapped, so the time is the query and not the reads of the BF layer
+  hpInfo = HP_OpenFileMapped(HP_FILE_NAME);
+
+  printf("Inserted %d records, %d scans of id BETWEEN %d AND %d AND city = '%s'.\n\n", RECORDS_NUM, SCANS, LOW_ID, HIGH_ID, CITY_NAME);
+
+  Predicate between = {PRED_BETWEEN, LOW_ID, HIGH_ID};
+  Record_Attribute columns[] = {ID, SURNAME};
+  BATCH_Pipeline* pipeline = BATCH_Create();
+  BATCH_AddFilter(pipeline, between);
+  BATCH_AddMatch(pipeline, CITY, CITY_NAME);
+  BATCH_AddProject(pipeline, columns, 2);
+
+  Totals tuples = {0, 0};
+  Totals batches = {0, 0};
+  double tupleSeconds = 0, batchSeconds = 0;
+  for(int i = 0; i < SCANS; i++){   // Taking turns, so both see the same state of the machine
+    double start = now();
+    HP_ScanPages(hpInfo, tuplePage, &tuples);
+    tupleSeconds += now() - start;
+
+    start = now();
+    BATCH_RunHeap(pipeline, hpInfo, sink, &batches);
+    batchSeconds += now() - start;
+  }
+  BATCH_Destroy(pipeline);
+
+  printf("Record at a time : %ld rows, checksum %ld, %8.2f us per scan\n", tuples.rows / SCANS, tuples.checksum, tupleSeconds * 1e6 / SCANS);
+  printf("Batch at a time  : %ld rows, checksum %ld, %8.2f us per scan\n", batches.rows / SCANS, batches.checksum, batchSeconds * 1e6 / SCANS);
+
+  HP_CloseFile(hpInfo);
+  BF_Close();
+
+  remove(HP_FILE_NAME);
+
+  return 0;
+}
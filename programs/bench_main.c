@@ -0,0 +1,465 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "bf.h"
+#include "hp_file.h"
+#include "ht_table.h"
+#include "sht_table.h"
+#include "bf_pool.h"
+#include "wal.h"
+#include "bf_checksum.h"
+#include "workload.h"
+#include "histogram.h"
+#include "trace.h"
+
+#define HP_FILE_NAME "bench_heap.db"
+#define HT_FILE_NAME "bench_data.db"
+#define SHT_FILE_NAME "bench_index.db"
+#define POOL_NAME "bench"
+#define MAX_RESULTS 8
+// The directory is in block 0, after the file identifier and before the block_info of block 0
+#define MAX_BUCKETS ((int) ((BF_BLOCK_SIZE - sizeof("Hashtable file") - sizeof(HT_info) - sizeof(HT_block_info)) / sizeof(int)))
+
+typedef struct{
+  long records;
+  int buckets;
+  long lookups;
+  long scans;                 // Heap lookups, each one reads the whole file
+  ReplacementAlgorithm policy;
+  int poolBlocks;             // 0 for the BF layer only
+  WORKLOAD_Distribution distribution;
+  double skew;
+  int names;                  // Distinct names, the key of the secondary index
+  WAL_Mode wal;
+  int hp, ht, sht;
+  const char* json;
+  uint64_t seed;
+  const char* trace;          // Log of TRACE_Dump, only in the bench_trace build
+  int checksums;              // Page checksums (bf_checksum.h), off to measure what they cost
+}Config;
+
+typedef struct{
+  const char* method;
+  const char* phase;
+  long ops;
+  double seconds;
+  HIST_Histogram latency;     // ns
+  long requests;              // Blocks asked for, from the BF layer or the pool
+  long reads;                 // read() calls of the bench thread that reached the kernel, the blocks the BF layer did not have
+}Result;
+
+static Result results[MAX_RESULTS];
+static int resultCount = 0;
+
+/**** Counters ****/
+
+// The bench is linked with --wrap=BF_GetBlock, so every block asked for by the access methods is counted here
+BF_ErrorCode __real_BF_GetBlock(const int file_desc, const int block_num, BF_Block* block);
+
+static long blockRequests = 0;
+
+BF_ErrorCode __wrap_BF_GetBlock(const int file_desc, const int block_num, BF_Block* block){
+  blockRequests++;
+  return __real_BF_GetBlock(file_desc, block_num, block);
+}
+
+// The BF layer reads every block it does not have with one read() of the thread that asked for it. The kernel counts
+// them per thread, so the preads of the prefetch thread (and the reads of the WAL and flusher threads) are not in them
+static long readOverhead = 0;   // read() calls of readCalls itself between two calls
+
+static long readCalls(void){
+  char line[128];
+  long calls = 0;
+
+  FILE* io = fopen("/proc/thread-self/io", "r");
+  if(io == NULL){
+    return 0;
+  }
+  while(fgets(line, sizeof(line), io) != NULL){
+    if(sscanf(line, "syscr: %ld", &calls) == 1){
+      break;
+    }
+  }
+  fclose(io);
+
+  return calls;
+}
+
+static long poolHits(void){
+  long hits = 0, misses = 0;
+
+  BF_PoolCounters(POOL_NAME, &hits, &misses);
+
+  return hits;
+}
+
+/**** Phases ****/
+
+static double now(void){
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static uint64_t nanoseconds(void){
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t) time.tv_sec * 1000000000ULL + time.tv_nsec;
+}
+
+// The lookups print a line when they find nothing, stdout goes to /dev/null while a phase runs
+static int quiet(void){
+  fflush(stdout);
+  int saved = dup(STDOUT_FILENO);
+  int null = open("/dev/null", O_WRONLY);
+  dup2(null, STDOUT_FILENO);
+  close(null);
+  return saved;
+}
+
+static void loud(int saved){
+  fflush(stdout);
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+}
+
+static Result* begin(const char* method, const char* phase){
+  Result* result = &results[resultCount++];
+
+  result->method = method;
+  result->phase = phase;
+  result->ops = 0;
+  HIST_Init(&result->latency);
+  result->requests = blockRequests + poolHits();
+  result->reads = readCalls();
+  result->seconds = now();
+
+  return result;
+}
+
+static void end(Result* result){
+  result->seconds = now() - result->seconds;
+  result->requests = blockRequests + poolHits() - result->requests;
+  result->reads = readCalls() - result->reads - readOverhead;
+}
+
+static WORKLOAD* workloadOf(const Config* config, int lookups){
+  WORKLOAD_Config workload = {config->distribution, config->records, 0, config->skew, 100, 0.9, config->names, 100, 100};
+
+  if(lookups && config->distribution == WORKLOAD_SEQUENTIAL){   // Looking up ids that were inserted
+    workload.distribution = WORKLOAD_UNIFORM;
+  }
+
+  return WORKLOAD_Create(&workload, config->seed + lookups);
+}
+
+static void usePool(const Config* config, char* fileName){
+  if(config->poolBlocks > 0){
+    BF_PoolUse(fileName, POOL_NAME);
+  }
+}
+
+static void benchHeap(const Config* config){
+  WORKLOAD* inserts = workloadOf(config, 0);
+  WORKLOAD* lookups = workloadOf(config, 1);
+  WORKLOAD_Stream stream;
+
+  HP_CreateFile(HP_FILE_NAME);
+  usePool(config, HP_FILE_NAME);
+  HP_info* info = HP_OpenFile(HP_FILE_NAME);
+
+  Result* result = begin("hp", "insert");
+  WORKLOAD_StreamInit(&stream, inserts, 0, 1);
+  for(long i = 0; i < config->records; i++){
+    Record record = WORKLOAD_Next(&stream);
+    uint64_t start = nanoseconds();
+    HP_InsertEntry(info, record);
+    HIST_Record(&result->latency, nanoseconds() - start);
+    result->ops++;
+  }
+  end(result);
+
+  result = begin("hp", "scan lookup");
+  WORKLOAD_StreamInit(&stream, lookups, 0, 1);
+  for(long i = 0; i < config->scans; i++){
+    Record key = WORKLOAD_Next(&stream);
+    uint64_t start = nanoseconds();
+    HP_GetAllEntries(info, key.id);
+    HIST_Record(&result->latency, nanoseconds() - start);
+    result->ops++;
+  }
+  end(result);
+
+  HP_CloseFile(info);
+  remove(HP_FILE_NAME);
+  WORKLOAD_Destroy(inserts);
+  WORKLOAD_Destroy(lookups);
+}
+
+static void benchHashtable(const Config* config, int secondary){
+  WORKLOAD* inserts = workloadOf(config, 0);
+  WORKLOAD* lookups = workloadOf(config, 1);
+  WORKLOAD_Stream stream;
+  const char* method = secondary ? "sht" : "ht";
+  SHT_info* shtInfo = NULL;
+
+  HT_CreateFile(HT_FILE_NAME, config->buckets);
+  if(secondary){    // Before the primary is opened, creating the index opens and closes it
+    SHT_CreateSecondaryIndex(SHT_FILE_NAME, config->buckets, HT_FILE_NAME);
+    usePool(config, SHT_FILE_NAME);
+    shtInfo = SHT_OpenSecondaryIndex(SHT_FILE_NAME);
+  }
+  usePool(config, HT_FILE_NAME);
+  HT_info* htInfo = HT_OpenFile(HT_FILE_NAME);
+
+  Result* result = begin(method, "insert");
+  WORKLOAD_StreamInit(&stream, inserts, 0, 1);
+  for(long i = 0; i < config->records; i++){
+    Record record = WORKLOAD_Next(&stream);
+    uint64_t start = nanoseconds();
+    int block = HT_InsertEntry(htInfo, record);
+    if(secondary){    // The primary insert is timed too, the secondary one needs its block
+      SHT_SecondaryInsertEntry(shtInfo, record, block);
+    }
+    HIST_Record(&result->latency, nanoseconds() - start);
+    result->ops++;
+  }
+  end(result);
+
+  result = begin(method, "lookup");
+  WORKLOAD_StreamInit(&stream, lookups, 0, 1);
+  for(long i = 0; i < config->lookups; i++){
+    Record key = WORKLOAD_Next(&stream);
+    uint64_t start = nanoseconds();
+    if(secondary){
+      SHT_SecondaryGetAllEntries(htInfo, shtInfo, key.name);
+    }else{
+      HT_GetAllEntries(htInfo, key.id);
+    }
+    HIST_Record(&result->latency, nanoseconds() - start);
+    result->ops++;
+  }
+  end(result);
+
+  if(secondary){
+    SHT_CloseSecondaryIndex(shtInfo);
+    remove(SHT_FILE_NAME);
+  }
+  HT_CloseFile(htInfo);
+  remove(HT_FILE_NAME);
+  WORKLOAD_Destroy(inserts);
+  WORKLOAD_Destroy(lookups);
+}
+
+/**** Output ****/
+
+static const char* distributionName(WORKLOAD_Distribution distribution){
+  switch(distribution){
+    case WORKLOAD_SEQUENTIAL:
+      return "sequential";
+    case WORKLOAD_UNIFORM:
+      return "uniform";
+    case WORKLOAD_ZIPF:
+      return "zipf";
+    default:
+      return "duplicates";
+  }
+}
+
+static double hitRate(const Result* result){
+  if(result->requests == 0){
+    return 1.0;
+  }
+
+  double rate = 1.0 - (double) result->reads / result->requests;
+
+  return rate < 0 ? 0 : rate;
+}
+
+static void printTable(void){
+  printf("%-4s %-12s %10s %12s %9s %9s %9s %9s %10s %10s %7s\n",
+         "file", "phase", "ops", "ops/sec", "p50 us", "p99 us", "p999 us", "max us", "requests", "reads", "hits");
+  for(int i = 0; i < resultCount; i++){
+    Result* result = &results[i];
+    printf("%-4s %-12s %10ld %12.0f %9.2f %9.2f %9.2f %9.2f %10ld %10ld %6.1f%%\n",
+           result->method, result->phase, result->ops, result->ops / result->seconds,
+           HIST_Percentile(&result->latency, 50) / 1e3, HIST_Percentile(&result->latency, 99) / 1e3,
+           HIST_Percentile(&result->latency, 99.9) / 1e3, result->latency.max / 1e3,
+           result->requests, result->reads, 100 * hitRate(result));
+  }
+}
+
+static void writeJson(const Config* config){
+  FILE* out = strcmp(config->json, "-") == 0 ? stdout : fopen(config->json, "w");
+  if(out == NULL){
+    perror(config->json);
+    return;
+  }
+
+  fprintf(out, "{\n  \"config\": {\"records\": %ld, \"buckets\": %d, \"lookups\": %ld, \"scans\": %ld, \"policy\": \"%s\", "
+               "\"pool_blocks\": %d, \"distribution\": \"%s\", \"skew\": %g, \"names\": %d, \"seed\": %llu, "
+               "\"checksums\": \"%s\"},\n  \"results\": [\n",
+          config->records, config->buckets, config->lookups, config->scans, config->policy == LRU ? "lru" : "mru",
+          config->poolBlocks, distributionName(config->distribution), config->skew, config->names, (unsigned long long) config->seed,
+          config->checksums ? BF_Crc32cPath() : "off");
+
+  for(int i = 0; i < resultCount; i++){
+    Result* result = &results[i];
+    fprintf(out, "    {\"method\": \"%s\", \"phase\": \"%s\", \"ops\": %ld, \"seconds\": %.6f, \"ops_per_sec\": %.1f, "
+                 "\"latency_ns\": {\"mean\": %.1f, \"p50\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu}, "
+                 "\"block_requests\": %ld, \"page_reads\": %ld, \"hit_rate\": %.4f}%s\n",
+            result->method, result->phase, result->ops, result->seconds, result->ops / result->seconds,
+            HIST_Mean(&result->latency), (unsigned long long) HIST_Percentile(&result->latency, 50),
+            (unsigned long long) HIST_Percentile(&result->latency, 99), (unsigned long long) HIST_Percentile(&result->latency, 99.9),
+            (unsigned long long) result->latency.max, result->requests, result->reads, hitRate(result),
+            i + 1 < resultCount ? "," : "");
+  }
+  fprintf(out, "  ]\n}\n");
+
+  if(out != stdout){
+    fclose(out);
+  }
+}
+
+static void usage(const char* program){
+  fprintf(stderr, "Usage: %s [--records N] [--buckets N (at most %d)] [--lookups N] [--scans N] [--policy lru|mru] [--pool BLOCKS]\n"
+                  "          [--distribution sequential|uniform|zipf|duplicates] [--skew S] [--names N] [--wal none|group|sync]\n"
+                  "          [--methods hp,ht,sht] [--seed N] [--json FILE|-] [--trace FILE] [--checksums on|off]\n", program, MAX_BUCKETS);
+}
+
+static int parse(int argc, char** argv, Config* config){
+  static struct option options[] = {
+    {"records", required_argument, NULL, 'r'},
+    {"buckets", required_argument, NULL, 'b'},
+    {"lookups", required_argument, NULL, 'l'},
+    {"scans", required_argument, NULL, 'c'},
+    {"policy", required_argument, NULL, 'p'},
+    {"pool", required_argument, NULL, 'o'},
+    {"distribution", required_argument, NULL, 'd'},
+    {"skew", required_argument, NULL, 'k'},
+    {"names", required_argument, NULL, 'n'},
+    {"wal", required_argument, NULL, 'w'},
+    {"methods", required_argument, NULL, 'm'},
+    {"seed", required_argument, NULL, 's'},
+    {"json", required_argument, NULL, 'j'},
+    {"trace", required_argument, NULL, 't'},
+    {"checksums", required_argument, NULL, 'x'},
+    {NULL, 0, NULL, 0}
+  };
+  int option;
+
+  while((option = getopt_long(argc, argv, "", options, NULL)) != -1){
+    switch(option){
+      case 'r': config->records = atol(optarg); break;
+      case 'b': config->buckets = atoi(optarg); break;
+      case 'l': config->lookups = atol(optarg); break;
+      case 'c': config->scans = atol(optarg); break;
+      case 'p': config->policy = strcmp(optarg, "mru") == 0 ? MRU : LRU; break;
+      case 'o': config->poolBlocks = atoi(optarg); break;
+      case 'd':
+        if(strcmp(optarg, "sequential") == 0){
+          config->distribution = WORKLOAD_SEQUENTIAL;
+        }else if(strcmp(optarg, "zipf") == 0){
+          config->distribution = WORKLOAD_ZIPF;
+        }else if(strcmp(optarg, "duplicates") == 0){
+          config->distribution = WORKLOAD_DUPLICATES;
+        }else{
+          config->distribution = WORKLOAD_UNIFORM;
+        }
+        break;
+      case 'k': config->skew = atof(optarg); break;
+      case 'n': config->names = atoi(optarg); break;
+      case 'w': config->wal = strcmp(optarg, "sync") == 0 ? WAL_SYNC : strcmp(optarg, "group") == 0 ? WAL_GROUP : WAL_NONE; break;
+      case 'm':
+        config->hp = config->ht = config->sht = 0;
+        for(char* method = strtok(optarg, ","); method != NULL; method = strtok(NULL, ",")){
+          if(strcmp(method, "hp") == 0){
+            config->hp = 1;
+          }else if(strcmp(method, "ht") == 0){
+            config->ht = 1;
+          }else if(strcmp(method, "sht") == 0){
+            config->sht = 1;
+          }else{
+            return -1;
+          }
+        }
+        break;
+      case 's': config->seed = strtoull(optarg, NULL, 10); break;
+      case 'j': config->json = optarg; break;
+      case 't': config->trace = optarg; break;
+      case 'x': config->checksums = strcmp(optarg, "off") != 0; break;
+      default:
+        return -1;
+    }
+  }
+
+  if(config->records < 1 || config->buckets < 1 || config->buckets > MAX_BUCKETS || config->lookups < 0 || config->scans < 0 || config->names < 1 || config->names > WORKLOAD_MAX_CARDINALITY || config->poolBlocks < 0){
+    return -1;
+  }
+
+  return 0;
+}
+
+int main(int argc, char** argv){
+  Config config = {100000, 100, 10000, 10, LRU, 0, WORKLOAD_UNIFORM, 0.99, 1000, WAL_NONE, 1, 1, 1, "bench.json", 12569874, NULL, 1};
+
+  if(parse(argc, argv, &config) != 0){
+    usage(argv[0]);
+    return 1;
+  }
+
+  if(config.trace != NULL && TRACE_START(0) != 0){
+    fprintf(stderr, "No tracing, it needs the bench_trace build.\n");
+    return 1;
+  }
+
+  BF_Init(config.policy);
+  WAL_SetMode(config.wal);
+  BF_ChecksumSetEnabled(config.checksums);
+  if(config.poolBlocks > 0 && BF_PoolCreate(POOL_NAME, config.poolBlocks, config.policy) != BF_OK){
+    fprintf(stderr, "No pool of %d blocks.\n", config.poolBlocks);
+    return 1;
+  }
+
+  readOverhead = -readCalls();
+  readOverhead += readCalls();
+
+  setRecordPrinting(0);   // The records found are not printed inside the timed calls
+  int saved = quiet();    // Only the rare "There is no entry" lines are left
+  if(config.hp){
+    benchHeap(&config);
+  }
+  if(config.ht){
+    benchHashtable(&config, 0);
+  }
+  if(config.sht){
+    benchHashtable(&config, 1);
+  }
+  loud(saved);
+  setRecordPrinting(1);
+
+  printf("%ld records (%s ids), %d buckets, %s, %s, checksums %s\n\n", config.records, distributionName(config.distribution),
+         config.buckets, config.policy == LRU ? "LRU" : "MRU", config.poolBlocks > 0 ? "pool" : "BF layer only",
+         config.checksums ? BF_Crc32cPath() : "off");
+  printTable();
+  writeJson(&config);
+
+  if(config.poolBlocks > 0){
+    BF_PoolDestroy(POOL_NAME);
+  }
+  BF_Close();
+
+  if(config.trace != NULL){   // After BF_Close, so the blocks it writes are in the log
+    if(TRACE_DUMP(config.trace) != 0){
+      fprintf(stderr, "No trace written to %s.\n", config.trace);
+    }
+    TRACE_STOP();
+  }
+
+  return 0;
+}
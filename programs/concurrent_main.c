@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "bf.h"
+#include "ht_table.h"
+#include "sht_table.h"
+
+#define RECORDS_NUM 5000      // Records of every file, their numbers are split between the writers
+#define WRITERS 4
+#define READERS 2
+#define BUCKETS 8             // Of the rehashed file, its ids are multiples of 8 so they all start in bucket 0
+#define INDEX_BUCKETS 50      // Of the indexed file and its index
+#define SKEW_THRESHOLD 1.5
+#define SCAN_PAUSE 2000       // Microseconds between two page scans
+#define FALSE_POSITIVE_RATE 0.01
+#define FILE_NAME "data.db"           // Rehashed while the threads use it, ids number * 8
+#define INDEXED_NAME "indexed.db"     // Indexed by INDEX_NAME, ids number * 8 + 1
+#define INDEX_NAME "index.db"
+
+static const char* lookupNames[] = {"Vagelis", "Christofos", "Marianna", "Konstantina"};
+#define NAMES ((int) (sizeof(lookupNames) / sizeof(lookupNames[0])))
+
+static HT_info* info;
+static HT_info* indexed_info;
+static SHT_info* index_info;
+
+static int inserted[RECORDS_NUM];   // 1 once the record with this number is in FILE_NAME
+static int expected[RECORDS_NUM];   // Lookups of the record in FILE_NAME, every one must print it
+static int writing = WRITERS;       // Writers still inserting
+
+static Record numbered(int number, int offset){
+  Record record;
+  memset(&record, 0, sizeof(record));
+  strcpy(record.record, "record");
+  record.id = number * 8 + offset;
+  strcpy(record.name, lookupNames[number % NAMES]);
+  strcpy(record.surname, "Svingos");
+  strcpy(record.city, "Athens");
+  return record;
+}
+
+/**** Threads ****/
+
+// Inserts every WRITERS-th record into both files, the indexed one together with its index
+static void* writer(void* argument){
+  int first = *(int*) argument;
+  for(int number = first; number < RECORDS_NUM; number += WRITERS){
+    HT_InsertEntry(info, numbered(number, 0));
+    __atomic_store_n(&inserted[number], 1, __ATOMIC_RELEASE);
+
+    Record record = numbered(number, 1);
+    SHT_SecondaryInsertEntry(index_info, record, HT_InsertEntry(indexed_info, record));
+  }
+  __atomic_sub_fetch(&writing, 1, __ATOMIC_SEQ_CST);
+  return NULL;
+}
+
+// Looks up records already inserted into FILE_NAME while it is rehashed, and names in the index
+static void* reader(void* argument){
+  unsigned int seed = *(int*) argument;
+  while(__atomic_load_n(&writing, __ATOMIC_SEQ_CST) > 0){
+    int number = rand_r(&seed) % RECORDS_NUM;
+    if(__atomic_load_n(&inserted[number], __ATOMIC_ACQUIRE)){
+      __atomic_add_fetch(&expected[number], 1, __ATOMIC_RELAXED);
+      HT_GetAllEntries(info, number * 8);
+    }
+    if(number % 16 == 0){
+      SHT_SecondaryGetAllEntries(indexed_info, index_info, (char*) lookupNames[number % NAMES]);
+    }
+  }
+  return NULL;
+}
+
+// Looks up the first record of every block it is given, from inside the page scan
+static void lookupFirst(void* context, const Record* records, int count){
+  (void) context;
+  if(count > 0){
+    __atomic_add_fetch(&expected[records[0].id / 8], 1, __ATOMIC_RELAXED);
+    HT_GetAllEntries(info, records[0].id);
+  }
+}
+
+static void* scanner(void* argument){
+  int* scans = argument;
+  while(__atomic_load_n(&writing, __ATOMIC_SEQ_CST) > 0){
+    HT_ScanPages(info, lookupFirst, NULL);
+    (*scans)++;
+    usleep(SCAN_PAUSE);   // The rehash steps of the inserts wait while a scan runs
+  }
+  return NULL;
+}
+
+/**** Lookup output, printed to a temporary file and counted ****/
+
+static FILE* output;
+static int saved;
+
+static void capture(void){
+  fflush(stdout);
+  output = tmpfile();
+  saved = dup(STDOUT_FILENO);
+  dup2(fileno(output), STDOUT_FILENO);
+}
+
+// Restores stdout and adds 1 to found[number] for every record (number * 8 + offset, ...) printed since capture
+static void release(int* found, int offset){
+  fflush(stdout);
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+
+  int id;
+  char line[128];
+  rewind(output);
+  while(fgets(line, sizeof(line), output)){
+    if(sscanf(line, "(%d,", &id) == 1 && id % 8 == offset && id / 8 < RECORDS_NUM){
+      found[id / 8]++;
+    }
+  }
+  fclose(output);
+}
+
+// Return the records printed another number of times than expected (1 for every record if expected is NULL)
+static int wrong(const int* found, const int* expected){
+  int wrong = 0;
+  for(int i = 0; i < RECORDS_NUM; i++){
+    wrong += found[i] != (expected != NULL ? expected[i] : 1);
+  }
+  return wrong;
+}
+
+int main(){
+  BF_Init(LRU);
+  HT_SetSkewThreshold(SKEW_THRESHOLD);
+  SHT_SetSkewThreshold(SKEW_THRESHOLD);
+
+  HT_CreateFileWithFilter(FILE_NAME, BUCKETS, FALSE_POSITIVE_RATE);
+  HT_CreateFileWithFilter(INDEXED_NAME, INDEX_BUCKETS, FALSE_POSITIVE_RATE);
+  SHT_CreateSecondaryIndexWithFilter(INDEX_NAME, INDEX_BUCKETS, INDEXED_NAME, FALSE_POSITIVE_RATE);
+
+  info = HT_OpenFile(FILE_NAME);
+  indexed_info = HT_OpenFile(INDEXED_NAME);
+  index_info = SHT_OpenSecondaryIndex(INDEX_NAME);
+  if(info == NULL || indexed_info == NULL || index_info == NULL){
+    return 1;
+  }
+
+  printf("%d writers, %d readers and a page scan share %s (rehashed) and %s with its index %s.\n",
+         WRITERS, READERS, FILE_NAME, INDEXED_NAME, INDEX_NAME);
+
+  pthread_t threads[WRITERS + READERS + 1];
+  int arguments[WRITERS + READERS];
+  int scans = 0, started = 0;
+
+  static int found[RECORDS_NUM];
+  capture();
+  for(int i = 0; i < WRITERS + READERS; i++){
+    arguments[i] = i;
+    if(pthread_create(&threads[started], NULL, i < WRITERS ? writer : reader, &arguments[i]) == 0){
+      started++;
+    }else if(i < WRITERS){
+      __atomic_sub_fetch(&writing, 1, __ATOMIC_SEQ_CST);
+    }
+  }
+  if(pthread_create(&threads[started], NULL, scanner, &scans) == 0){
+    started++;
+  }
+  for(int i = 0; i < started; i++){
+    pthread_join(threads[i], NULL);
+  }
+  release(found, 0);
+
+  int failed = 0;
+  int lookups = 0;
+  for(int i = 0; i < RECORDS_NUM; i++){
+    lookups += expected[i];
+  }
+  int missed = wrong(found, expected);
+  printf("%d threads, %d concurrent lookups of %s, %d page scans, %d records not found as often as looked up.\n",
+         started, lookups, FILE_NAME, scans, missed);
+  failed |= started != WRITERS + READERS + 1 || missed != 0;
+
+  if(info->numBuckets == BUCKETS){
+    printf("%s was not rehashed.\n", FILE_NAME);
+    failed = 1;
+  }
+  if(indexed_info->numBuckets != INDEX_BUCKETS || indexed_info->rehashBlock != 0){
+    printf("%s was rehashed.\n", INDEXED_NAME);
+    failed = 1;
+  }
+
+  // Every record once, by its id in the rehashed file and by its name in the indexed one
+  memset(found, 0, sizeof(found));
+  capture();
+  for(int i = 0; i < RECORDS_NUM; i++){
+    HT_GetAllEntries(info, i * 8);
+  }
+  release(found, 0);
+  missed = wrong(found, NULL);
+  printf("%s: %ld buckets, %d of %d records found once by their id.\n", FILE_NAME, info->numBuckets, RECORDS_NUM - missed, RECORDS_NUM);
+  failed |= missed != 0;
+
+  memset(found, 0, sizeof(found));
+  capture();
+  for(int i = 0; i < NAMES; i++){
+    SHT_SecondaryGetAllEntries(indexed_info, index_info, (char*) lookupNames[i]);
+  }
+  release(found, 1);
+  missed = wrong(found, NULL);
+  printf("%s: %ld buckets, %d of %d records found once by their name.\n", INDEXED_NAME, indexed_info->numBuckets, RECORDS_NUM - missed, RECORDS_NUM);
+  failed |= missed != 0;
+
+  SHT_CloseSecondaryIndex(index_info);
+  HT_CloseFile(indexed_info);
+  HT_CloseFile(info);
+  BF_Close();
+
+  remove(FILE_NAME);
+  remove(INDEXED_NAME);
+  remove(INDEX_NAME);
+  return failed;
+}
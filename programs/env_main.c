@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bf.h"
+#include "bf_env.h"
+#include "ht_table.h"
+
+#define BUCKETS 50          // Chains of a few blocks
+#define RECORDS_NUM 2000    // Records of every tenant
+#define HOT_IDS 8           // Ids the lookups ask for, their chains fit in the big pool but not in the small one
+#define LOOKUPS 400         // Lookups of every tenant, interleaved
+
+typedef struct{
+  const char* name;
+  const char* fileName;
+  int blocks;               // Pool budget
+  BF_Env* env;
+  HT_info* info;
+  int hot[HOT_IDS];
+}Tenant;
+
+static Tenant tenants[] = {
+  {"tenant-a", "tenant_a.db", 64, NULL, NULL, {0}},
+  {"tenant-b", "tenant_b.db", 8, NULL, NULL, {0}},
+};
+
+#define TENANTS ((int) (sizeof(tenants) / sizeof(tenants[0])))
+
+/**** The records found are printed to /dev/null ****/
+
+static int quiet(void){
+  fflush(stdout);
+  int saved = dup(STDOUT_FILENO);
+  int null = open("/dev/null", O_WRONLY);
+  dup2(null, STDOUT_FILENO);
+  close(null);
+  return saved;
+}
+
+static void loud(int saved){
+  fflush(stdout);
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+}
+
+static void report(const Tenant* tenant){
+  BF_EnvStats stats;
+  BF_EnvCounters(tenant->env, &stats);
+
+  long reads = stats.hits + stats.misses;
+  printf("%-10s pool %3d blocks, %d open (%ld opened), %6ld hits, %6ld misses, hit rate %5.1f%%\n", BF_EnvName(tenant->env),
+         stats.blocks, stats.files, stats.opened, stats.hits, stats.misses, reads > 0 ? 100.0 * stats.hits / reads : 0.0);
+}
+
+// LOOKUPS lookups of the hot ids of every tenant in tenants[from..to), one of each in turn
+static long lookups(int from, int to){
+  long blocks = 0;
+
+  int saved = quiet();
+  for(int i = 0; i < LOOKUPS; i++){
+    for(int t = from; t < to; t++){
+      blocks += HT_GetAllEntries(tenants[t].info, tenants[t].hot[rand() % HOT_IDS]);
+    }
+  }
+  loud(saved);
+
+  return blocks;
+}
+
+int main(){
+  srand(12569874);
+
+  for(int t = 0; t < TENANTS; t++){
+    Tenant* tenant = &tenants[t];
+
+    tenant->env = BF_EnvCreate(tenant->name, tenant->blocks, LRU);   // The first one starts the BF layer
+    if(tenant->env == NULL){
+      printf("Could not create the env %s.\n", tenant->name);
+      return 1;
+    }
+
+    HT_CreateFile((char*) tenant->fileName, BUCKETS);
+    tenant->info = HT_OpenFileEnv(tenant->env, (char*) tenant->fileName);
+    if(tenant->info == NULL){
+      return 1;
+    }
+
+    for(int i = 0; i < RECORDS_NUM; i++){
+      Record record = randomRecord();
+      HT_InsertEntry(tenant->info, record);
+      if(i < HOT_IDS){
+        tenant->hot[i] = record.id;
+      }
+    }
+  }
+
+  printf("Interleaved lookups of %d hot ids, %d per tenant:\n", HOT_IDS, LOOKUPS);
+  lookups(0, TENANTS);
+  for(int t = 0; t < TENANTS; t++){
+    report(&tenants[t]);
+  }
+
+  // tenant-b goes away with its file still open, tenant-a goes on with its pool as it was
+  Tenant* gone = &tenants[1];
+  printf("\nDestroying %s (%s is still open in it).\n", gone->name, gone->fileName);
+  if(BF_EnvDestroy(gone->env) != BF_OK){
+    printf("Could not close every file of %s.\n", gone->name);
+  }
+  gone->env = NULL;
+  gone->info = NULL;
+
+  lookups(0, 1);
+  report(&tenants[0]);
+
+  // Its file was closed and written back by BF_EnvDestroy, a new env reads it again
+  BF_Env* again = BF_EnvCreate("tenant-b2", gone->blocks, LRU);
+  HT_info* info = HT_OpenFileEnv(again, (char*) gone->fileName);
+  int found = 0;
+  if(info != NULL){
+    int saved = quiet();
+    found = HT_GetAllEntries(info, gone->hot[0]) > 0;
+    loud(saved);
+  }
+  printf("\n%s reopened in %s: %s\n", gone->fileName, BF_EnvName(again), found ? "records found" : "records missing");
+  BF_EnvDestroy(again);
+
+  BF_EnvDestroy(tenants[0].env);    // The last one closes the BF layer
+
+  for(int t = 0; t < TENANTS; t++){
+    remove(tenants[t].fileName);
+  }
+
+  return !found;
+}
@@ -5,9 +5,16 @@
 
 #include "bf.h"
 #include "hp_file.h"
+#include "wal.h"
+#include "bf_flush.h"
 
 #define RECORDS_NUM 200     // Number of records in database
+#define BENCH_RECORDS 100000  // Number of records for the insert benchmark
+#define CHECKPOINT_RECORDS 20000  // Inserts between two checkpoints of the insert benchmark
+#define SCAN_THREADS 4      // Workers of the parallel scan
+#define PENDING_RECORDS 20000 // Records of the file scanned right after its inserts, its last blocks still pending in the writer
 #define FILE_NAME "data.db"
+#define BENCH_FILE_NAME "bench.db"
 
 #define CALL_OR_DIE(call){  \
   BF_ErrorCode code = call; \
@@ -17,6 +24,22 @@
   }                         \
 }
 
+static double now(void){
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static void countRecords(void* context, const Record* records, int count){
+  (void) records;
+  *(int*) context += count;
+}
+
+static int compareLatencies(const void* a, const void* b){
+  double first = *(const double*) a, second = *(const double*) b;
+  return (first > second) - (first < second);
+}
+
 int main(){
   srand(12569874);
   // srand(time(NULL));
@@ -65,6 +88,71 @@ int main(){
   printf("\nSearching for: %d\n", noEntry);
   printf("Visited : %d blocks to find record with id %d.\n", HP_GetAllEntries(info, noEntry), noEntry);
 
+  /* Range of ids */
+
+  Predicate predicate = {PRED_BETWEEN, RECORDS_NUM / 2, RECORDS_NUM / 2 + 3};
+  printf("\nSearching for ids between %d and %d\n", predicate.low, predicate.high);
+  printf("Visited : %d blocks.\n", HP_GetEntriesWhere(info, predicate));
+
+  /* Parallel scan */
+
+  id = rand() % RECORDS_NUM;
+  printf("\nSearching in parallel for: %d\n", id);
+  printf("Visited : %d blocks to find record with id %d.\n", HP_ParallelGetAllEntries(info, id, SCAN_THREADS), id);
+
+  /* Insert throughput, with the first file still open, without and with the write ahead log */
+
+  static double latencies[BENCH_RECORDS];
+  WAL_Mode modes[] = {WAL_NONE, WAL_GROUP, WAL_GROUP};
+  BF_IoMode ioModes[] = {BF_IO_BUFFERED, BF_IO_BUFFERED, BF_IO_DIRECT};
+  const char* modeNames[] = {"no log", "group commit log", "group commit log, direct I/O"};
+
+  for(int mode = 0; mode < 3; mode++){
+    WAL_SetMode(modes[mode]);
+    BF_SetIoMode(ioModes[mode]);
+    HP_CreateFile(BENCH_FILE_NAME);
+    HP_info* benchInfo = HP_OpenFile(BENCH_FILE_NAME);
+
+    double seconds = 0;
+    for(int i = 0; i < BENCH_RECORDS; i++){
+      Record benchRecord = randomRecord();
+      double start = now();   // Wall time, so the waits for the disk count too
+      HP_InsertEntry(benchInfo, benchRecord);
+      latencies[i] = now() - start;
+      seconds += latencies[i];
+
+      if((i + 1) % CHECKPOINT_RECORDS == 0){
+        HP_Checkpoint(benchInfo);   // Keeps the log short, its time is not an insert latency
+      }
+    }
+    qsort(latencies, BENCH_RECORDS, sizeof(double), compareLatencies);
+    printf("\nInserted %d records in %.3f sec (%.0f records/sec, p99 %.2f us, %s)\n", BENCH_RECORDS, seconds,
+           BENCH_RECORDS / seconds, latencies[BENCH_RECORDS * 99 / 100] * 1e6, modeNames[mode]);
+
+    HP_CloseFile(benchInfo);
+    remove(BENCH_FILE_NAME);
+  }
+  BF_SetIoMode(BF_IO_BUFFERED);
+
+  /* Scan with writes pending, the frames evicted before the writer wrote their blocks are read back stale */
+  /* The inserts into the first file too evict them, the scan must see their pending copies */
+
+  WAL_SetMode(WAL_NONE);
+  HP_CreateFile(BENCH_FILE_NAME);
+  HP_info* pendingInfo = HP_OpenFile(BENCH_FILE_NAME);
+  for(int i = 0; i < PENDING_RECORDS; i++){
+    HP_InsertEntry(pendingInfo, randomRecord());
+    if(i % 3 == 0){
+      HP_InsertEntry(info, randomRecord());
+    }
+  }
+  int scanned = 0;
+  int scanBlocks = HP_ScanPages(pendingInfo, countRecords, &scanned);
+  printf("\nScanned %d of %d records (%s) right after inserting them.\n", scanned, PENDING_RECORDS, scanBlocks < 0 ? "failed" : "ok");
+  HP_CloseFile(pendingInfo);
+  remove(BENCH_FILE_NAME);
+  WAL_SetMode(WAL_GROUP);
+
   printf("\nDone with reading. Time to close the file.\n");
 
   if(HP_CloseFile(info) == 0){
@@ -74,5 +162,5 @@ int main(){
 
   remove(FILE_NAME);
 
-  return 0;
+  return scanBlocks < 0 || scanned != PENDING_RECORDS;
 }
@@ -7,6 +7,7 @@
 #include "ht_table.h"
 
 #define BUCKETS 10          // Number of buckets in hashtable (10 - 20 recommended)
+#define FALSE_POSITIVE_RATE 0.01  // Bloom filter false positive rate per bucket (0 for no filters)
 #define RECORDS_NUM 200     // Number of records in database
 #define FILE_NAME "data.db"
 
@@ -23,7 +24,7 @@ int main() {
   // srand(time(NULL));
   
   BF_Init(LRU);
-  HT_CreateFile(FILE_NAME, BUCKETS);
+  HT_CreateFileWithFilter(FILE_NAME, BUCKETS, FALSE_POSITIVE_RATE);
   HT_info* info = HT_OpenFile(FILE_NAME);
 
   printf("The file has been created successfully. Time to insert some random records.\n");
@@ -0,0 +1,114 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bf.h"
+#include "ht_table.h"
+#include "sht_table.h"
+
+#define BUCKETS 50            // Buckets of the hashtable and of every index
+#define RECORDS_NUM 20000     // Number of records in database
+#define FALSE_POSITIVE_RATE 0.01
+#define FILE_NAME "data.db"
+#define INSERT_INDEX_NAME "index.db"
+#define MAX_THREADS 8         // The bulk build is timed with 1, 2, 4 ... MAX_THREADS workers
+
+static const char* lookupNames[] = {"Vagelis", "Christofos", "Marianna", "Konstantina", "Iosif", "Christos"};
+
+/**** Timing helpers, the records found are printed to /dev/null ****/
+
+static int quiet(void){
+  fflush(stdout);
+  int saved = dup(STDOUT_FILENO);
+  int null = open("/dev/null", O_WRONLY);
+  dup2(null, STDOUT_FILENO);
+  close(null);
+  return saved;
+}
+
+static void loud(int saved){
+  fflush(stdout);
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+}
+
+static double now(void){
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// Blocks of the hashtable read by the lookups of names, the same for two indexes of the same records
+static int lookups(HT_info* info, SHT_info* index_info){
+  int blocks = 0;
+  int saved = quiet();
+  for(int i = 0; i < (int) (sizeof(lookupNames) / sizeof(lookupNames[0])); i++){
+    blocks += SHT_SecondaryGetAllEntries(info, index_info, (char*) lookupNames[i]);
+  }
+  loud(saved);
+  return blocks;
+}
+
+int main(){
+  srand(12569874);
+
+  BF_Init(LRU);
+
+  // The indexes open the hashtable file while they are created, so they are all created before it is opened
+  char indexNames[MAX_THREADS + 1][32];
+  HT_CreateFileWithFilter(FILE_NAME, BUCKETS, FALSE_POSITIVE_RATE);
+  SHT_CreateSecondaryIndexWithFilter(INSERT_INDEX_NAME, BUCKETS, FILE_NAME, FALSE_POSITIVE_RATE);
+  for(int threads = 1; threads <= MAX_THREADS; threads *= 2){
+    snprintf(indexNames[threads], sizeof(indexNames[threads]), "index%d.db", threads);
+    SHT_CreateSecondaryIndexWithFilter(indexNames[threads], BUCKETS, FILE_NAME, FALSE_POSITIVE_RATE);
+  }
+
+  HT_info* info = HT_OpenFile(FILE_NAME);
+  SHT_info* index_info = SHT_OpenSecondaryIndex(INSERT_INDEX_NAME);
+
+  printf("Inserting %d records, every one in the hashtable and in the index %s.\n", RECORDS_NUM, INSERT_INDEX_NAME);
+
+  double seconds = 0;
+  for(int i = 0; i < RECORDS_NUM; i++){
+    Record record = randomRecord();
+    int block_id = HT_InsertEntry(info, record);
+    double start = now();
+    SHT_SecondaryInsertEntry(index_info, record, block_id);
+    seconds += now() - start;
+  }
+  int expected = lookups(info, index_info);
+  printf("%-24s %10.3f ms, lookups read %d blocks\n", "one insert at a time", seconds * 1e3, expected);
+  SHT_CloseSecondaryIndex(index_info);
+
+  int failed = 0;
+  for(int threads = 1; threads <= MAX_THREADS; threads *= 2){
+    index_info = SHT_OpenSecondaryIndex(indexNames[threads]);
+
+    double start = now();
+    int entries = SHT_BuildFromPrimary(info, index_info, threads);
+    seconds = now() - start;
+
+    int blocks = lookups(info, index_info);
+    char label[32];
+    snprintf(label, sizeof(label), "bulk build, %d threads", threads);
+    printf("%-24s %10.3f ms, lookups read %d blocks, %d entries%s\n", label, seconds * 1e3, blocks, entries,
+           entries == RECORDS_NUM && blocks == expected ? "" : " (wrong)");
+    failed |= entries != RECORDS_NUM || blocks != expected;
+
+    SHT_CloseSecondaryIndex(index_info);
+  }
+
+  HT_CloseFile(info);
+  BF_Close();
+
+  remove(FILE_NAME);
+  remove(INSERT_INDEX_NAME);
+  for(int threads = 1; threads <= MAX_THREADS; threads *= 2){
+    remove(indexNames[threads]);
+  }
+
+  return failed;
+}
@@ -0,0 +1,83 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bf.h"
+#include "hp_file.h"
+#include "ht_table.h"
+#include "wal.h"
+#include "hash_join.h"
+
+#define BUCKETS 50              // Number of buckets in hashtable
+#define RECORDS_NUM 20000       // Number of records in the heap file, every third one is in the hashtable too
+#define SMALL_BUDGET 100000     // Bytes, too few for the hashtable side so the join is partitioned
+#define HT_FILE_NAME "data.db"
+#define HP_FILE_NAME "heap.db"
+
+typedef struct{
+  long pairs;
+  long checksum;    // Sum of the ids of the pairs, the same for every way of joining
+  int mismatches;   // Pairs with different ids, must be 0
+}Totals;
+
+static void count(void* context, const Record* left, const Record* right){
+  Totals* totals = context;
+
+  totals->pairs++;
+  totals->checksum += left->id;
+  if(left->id != right->id){
+    totals->mismatches++;
+  }
+}
+
+static double now(void){
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static void join(const char* title, HP_info* hpInfo, HT_info* htInfo, size_t budget){
+  Totals totals = {0, 0, 0};
+
+  double start = now();
+  long pairs = JOIN_HashJoin(JOIN_HeapInput(hpInfo, ID), JOIN_HashtableInput(htInfo, ID), budget, count, &totals);
+  double seconds = now() - start;
+
+  printf("%-12s: %ld pairs (%ld emitted, checksum %ld, %d mismatches) in %.2f ms\n",
+         title, pairs, totals.pairs, totals.checksum, totals.mismatches, seconds * 1e3);
+}
+
+int main(){
+  srand(12569874);
+
+  BF_Init(LRU);
+  WAL_SetMode(WAL_NONE);
+  HT_CreateFile(HT_FILE_NAME, BUCKETS);
+  HP_CreateFile(HP_FILE_NAME);
+
+  HT_info* htInfo = HT_OpenFile(HT_FILE_NAME);
+  HP_info* hpInfo = HP_OpenFile(HP_FILE_NAME);
+
+  for(int i = 0; i < RECORDS_NUM; i++){
+    Record record = randomRecord();
+    HP_InsertEntry(hpInfo, record);
+    if(i % 3 == 0){
+      HT_InsertEntry(htInfo, record);
+    }
+  }
+
+  printf("Inserted %d records, %d of them in the hashtable too.\n\n", RECORDS_NUM, (RECORDS_NUM + 2) / 3);
+
+  join("In memory", hpInfo, htInfo, 64 * 1024 * 1024);
+  join("Partitioned", hpInfo, htInfo, SMALL_BUDGET);
+
+  HT_CloseFile(htInfo);
+  HP_CloseFile(hpInfo);
+  BF_Close();
+
+  remove(HT_FILE_NAME);
+  remove(HP_FILE_NAME);
+
+  return 0;
+}
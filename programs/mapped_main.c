@@ -0,0 +1,120 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bf.h"
+#include "hp_file.h"
+#include "ht_table.h"
+
+#define BUCKETS 50          // Number of buckets in hashtable
+#define RECORDS_NUM 20000   // Number of records in database
+#define LOOKUPS 2000        // Number of lookups timed for every mode
+#define HT_FILE_NAME "data.db"
+#define HP_FILE_NAME "heap.db"
+
+/**** Timing helpers, the records found are printed to /dev/null while timing ****/
+
+static int quiet(void){
+  fflush(stdout);
+  int saved = dup(STDOUT_FILENO);
+  int null = open("/dev/null", O_WRONLY);
+  dup2(null, STDOUT_FILENO);
+  close(null);
+  return saved;
+}
+
+static void loud(int saved){
+  fflush(stdout);
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+}
+
+static double now(void){
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static double timeHashtable(HT_info* info){
+  srand(4);
+  int saved = quiet();
+  double start = now();
+  for(int i = 0; i < LOOKUPS; i++){
+    HT_GetAllEntries(info, rand() % RECORDS_NUM);
+  }
+  double seconds = now() - start;
+  loud(saved);
+  return seconds;
+}
+
+static double timeHeap(HP_info* info){
+  srand(4);
+  int saved = quiet();
+  double start = now();
+  for(int i = 0; i < LOOKUPS / 100; i++){   // A heap lookup is a scan of the whole file
+    HP_GetAllEntries(info, rand() % RECORDS_NUM);
+  }
+  double seconds = now() - start;
+  loud(saved);
+  return seconds;
+}
+
+int main(){
+  srand(12569874);
+
+  BF_Init(LRU);
+  HT_CreateFile(HT_FILE_NAME, BUCKETS);
+  HP_CreateFile(HP_FILE_NAME);
+
+  HT_info* htInfo = HT_OpenFile(HT_FILE_NAME);
+  HP_info* hpInfo = HP_OpenFile(HP_FILE_NAME);
+
+  for(int i = 0; i < RECORDS_NUM; i++){
+    Record record = randomRecord();
+    HT_InsertEntry(htInfo, record);
+    HP_InsertEntry(hpInfo, record);
+  }
+
+  HT_CloseFile(htInfo);   // Closing writes every block to disk, so the mapping sees them
+  HP_CloseFile(hpInfo);
+
+  printf("Inserted %d records, time to compare buffered and mapped lookups.\n", RECORDS_NUM);
+
+  /* Hashtable, random probes */
+
+  htInfo = HT_OpenFile(HT_FILE_NAME);
+  double buffered = timeHashtable(htInfo);
+  HT_CloseFile(htInfo);
+
+  htInfo = HT_OpenFileMapped(HT_FILE_NAME);
+  double mapped = timeHashtable(htInfo);
+  HT_CloseFile(htInfo);
+
+  printf("\nHashtable : %d lookups\n", LOOKUPS);
+  printf("  buffered : %8.2f us per lookup\n", buffered * 1e6 / LOOKUPS);
+  printf("  mapped   : %8.2f us per lookup\n", mapped * 1e6 / LOOKUPS);
+
+  /* Heap file, sequential scans */
+
+  hpInfo = HP_OpenFile(HP_FILE_NAME);
+  buffered = timeHeap(hpInfo);
+  HP_CloseFile(hpInfo);
+
+  hpInfo = HP_OpenFileMapped(HP_FILE_NAME);
+  mapped = timeHeap(hpInfo);
+  HP_CloseFile(hpInfo);
+
+  printf("\nHeap file : %d lookups\n", LOOKUPS / 100);
+  printf("  buffered : %8.2f us per lookup\n", buffered * 1e6 / (LOOKUPS / 100));
+  printf("  mapped   : %8.2f us per lookup\n", mapped * 1e6 / (LOOKUPS / 100));
+
+  BF_Close();
+
+  remove(HT_FILE_NAME);
+  remove(HP_FILE_NAME);
+
+  return 0;
+}
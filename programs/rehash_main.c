@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "bf.h"
+#include "ht_table.h"
+#include "sht_table.h"
+
+#define BUCKETS 8             // Every id is a multiple of BUCKETS, so all records hash to bucket 0 until the first rehash
+#define MAX_RECORDS 4000      // Inserts stop here if no rehash has started (a failure)
+#define STEPS_BEFORE_CRASH 3  // Inserts after the rehash starts and before the crash, each one moves one old bucket
+#define SKEW_THRESHOLD 1.5
+#define FALSE_POSITIVE_RATE 0.01
+#define FILE_NAME "data.db"
+#define INDEXED_NAME "indexed.db"
+#define INDEX_NAME "index.db"
+
+static const char* lookupNames[] = {"Vagelis", "Christofos", "Marianna", "Konstantina"};
+#define NAMES ((int) (sizeof(lookupNames) / sizeof(lookupNames[0])))
+
+// The record with the number-th id, its name is one of lookupNames so the index lookups can find them all
+static Record numbered(int number){
+  Record record = randomRecord();
+  record.id = number * BUCKETS;
+  strcpy(record.name, lookupNames[number % NAMES]);
+  return record;
+}
+
+/**** Lookups, their records are printed to a temporary file and counted ****/
+
+static FILE* output;
+static int saved;
+
+static void capture(void){
+  fflush(stdout);
+  output = tmpfile();
+  saved = dup(STDOUT_FILENO);
+  dup2(fileno(output), STDOUT_FILENO);
+}
+
+// Restores stdout and adds 1 to found[number] for every record (number * BUCKETS, ...) printed since capture
+// Return the records printed that are not numbered (number >= records or an id of no record)
+static int release(int* found, int records){
+  fflush(stdout);
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+
+  int wrong = 0, id;
+  char line[128];
+  rewind(output);
+  while(fgets(line, sizeof(line), output)){
+    if(sscanf(line, "(%d,", &id) != 1){
+      continue;
+    }
+    if(id % BUCKETS == 0 && id / BUCKETS < records){
+      found[id / BUCKETS]++;
+    }else{
+      wrong++;
+    }
+  }
+  fclose(output);
+  return wrong;
+}
+
+// Return the numbers below records not found exactly once, plus the records found that were never inserted
+static int missing(int* found, int records, int wrong){
+  for(int i = 0; i < records; i++){
+    wrong += found[i] != 1;
+  }
+  return wrong;
+}
+
+static void countRecords(void* context, const Record* records, int count){
+  (void) records;
+  *(int*) context += count;
+}
+
+// Return 1 if the data blocks of the table have room for records and leave out the directory and emptied blocks, else 0
+static int bounded(HT_info* info, int records){
+  int blocks = HT_DataBlocks(info);
+  printf("%d of the %d blocks are data blocks, with room for %d records.\n", blocks, info->lastBlockId, blocks * info->maxBlockRecs);
+  return (long) blocks * info->maxBlockRecs >= records && blocks < info->lastBlockId;
+}
+
+/**** A rehash that crashes in the middle ****/
+
+// The child process inserts until a rehash starts, moves a few buckets and exits without closing the file
+// It writes the amount of records it inserted to fd, the rehash must be in progress after the last one
+static void crash(int fd){
+  BF_Init(LRU);
+  HT_SetSkewThreshold(SKEW_THRESHOLD);
+
+  HT_CreateFileWithFilter(FILE_NAME, BUCKETS, FALSE_POSITIVE_RATE);
+  HT_info* info = HT_OpenFile(FILE_NAME);
+
+  int records = 0, steps = -1;
+  while(records < MAX_RECORDS && steps < STEPS_BEFORE_CRASH){
+    HT_InsertEntry(info, numbered(records++));
+    if(info->rehashBlock != 0){
+      steps++;
+    }
+  }
+  if(info->rehashBlock == 0){
+    records = -1;
+  }
+  printf("Inserted %d records, crashing in the middle of a rehash to %ld buckets.\n", records, info->numBuckets);
+  fflush(stdout);
+
+  if(write(fd, &records, sizeof(records)) != sizeof(records)){
+    _exit(1);
+  }
+  _exit(0);   // No HT_CloseFile and no BF_Close, only the log knows the rehash
+}
+
+static int recover(int records){
+  HT_info* info = HT_OpenFile(FILE_NAME);
+  if(info == NULL){
+    printf("The file could not be opened after the crash.\n");
+    return 1;
+  }
+  int failed = 0;
+  if(info->rehashBlock == 0){
+    printf("The rehash in progress was lost by the crash.\n");
+    failed = 1;
+  }
+  failed |= !bounded(info, records);
+
+  // An index needs records that stay in their blocks, so it can not be created on a file that is being rehashed
+  if(SHT_CreateSecondaryIndex(INDEX_NAME, BUCKETS, FILE_NAME) == HT_OK){
+    printf("An index was created in the middle of a rehash.\n");
+    failed = 1;
+  }
+
+  int total = records;
+  while(info->rehashBlock != 0 && total < MAX_RECORDS){
+    HT_InsertEntry(info, numbered(total++));
+  }
+  printf("The rehash finished after %d more records, %ld buckets.\n", total - records, info->numBuckets);
+  failed |= !bounded(info, total);
+
+  int* found = calloc(total, sizeof(int));
+  if(found == NULL){
+    HT_CloseFile(info);
+    return 1;
+  }
+  capture();
+  for(int i = 0; i < total; i++){
+    HT_GetAllEntries(info, i * BUCKETS);
+  }
+  int wrong = missing(found, total, release(found, total));
+
+  int scanned = 0;
+  HT_ScanPages(info, countRecords, &scanned);
+  printf("%d of %d records found once by their id, %d scanned.\n", total - wrong, total, scanned);
+  failed |= wrong != 0 || scanned != total;
+
+  free(found);
+  HT_CloseFile(info);
+  return failed;
+}
+
+/**** An indexed file is never rehashed ****/
+
+static int indexed(void){
+  HT_CreateFileWithFilter(INDEXED_NAME, BUCKETS, FALSE_POSITIVE_RATE);
+  if(SHT_CreateSecondaryIndexWithFilter(INDEX_NAME, BUCKETS, INDEXED_NAME, FALSE_POSITIVE_RATE) != HT_OK){
+    printf("The index of %s could not be created.\n", INDEXED_NAME);
+    return 1;
+  }
+  HT_info* info = HT_OpenFile(INDEXED_NAME);
+  SHT_info* index_info = SHT_OpenSecondaryIndex(INDEX_NAME);
+
+  int records = MAX_RECORDS / 4, failed = 0;
+  for(int i = 0; i < records; i++){
+    Record record = numbered(i);
+    SHT_SecondaryInsertEntry(index_info, record, HT_InsertEntry(info, record));
+  }
+  if(info->rehashBlock != 0 || info->numBuckets != BUCKETS){
+    printf("The indexed file was rehashed.\n");
+    failed = 1;
+  }
+
+  int* found = calloc(records, sizeof(int));
+  if(found == NULL){
+    SHT_CloseSecondaryIndex(index_info);
+    HT_CloseFile(info);
+    return 1;
+  }
+  capture();
+  for(int i = 0; i < NAMES; i++){
+    SHT_SecondaryGetAllEntries(info, index_info, (char*) lookupNames[i]);
+  }
+  int wrong = missing(found, records, release(found, records));
+  printf("Indexed file of %d records, skew %.2f and %ld buckets, %d records found once by their name.\n",
+         records, HT_Skew(info), info->numBuckets, records - wrong);
+  failed |= wrong != 0;
+
+  free(found);
+  SHT_CloseSecondaryIndex(index_info);
+  HT_CloseFile(info);
+  return failed;
+}
+
+int main(){
+  srand(12569874);
+  remove(FILE_NAME);
+
+  int fds[2];
+  if(pipe(fds) != 0){
+    return 1;
+  }
+  pid_t child = fork();
+  if(child < 0){
+    return 1;
+  }
+  if(child == 0){
+    close(fds[0]);
+    crash(fds[1]);
+  }
+  close(fds[1]);
+
+  int records = -1, status;
+  if(read(fds[0], &records, sizeof(records)) != sizeof(records)){
+    records = -1;
+  }
+  close(fds[0]);
+  waitpid(child, &status, 0);
+  if(records < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0){
+    printf("No rehash was in progress when the child exited.\n");
+    remove(FILE_NAME);
+    return 1;
+  }
+
+  BF_Init(LRU);
+  HT_SetSkewThreshold(SKEW_THRESHOLD);
+  SHT_SetSkewThreshold(SKEW_THRESHOLD);
+
+  int failed = recover(records);
+  failed |= indexed();
+
+  BF_Close();
+
+  remove(FILE_NAME);
+  remove(INDEXED_NAME);
+  remove(INDEX_NAME);
+  return failed;
+}
@@ -0,0 +1,120 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "bf.h"
+#include "hp_file.h"
+
+#define RECORDS_NUM 30000   // Records inserted before the first seal
+#define MORE_RECORDS 3000   // and after it
+#define SCANS 20            // Full scans timed in every state
+#define THREADS 4
+#define FILE_NAME "heap.db"
+
+typedef struct{
+  long records;
+  long idSum;
+}Totals;
+
+static Totals expected;
+
+/**** Timing helpers, the records found are printed to /dev/null ****/
+
+static int quiet(void){
+  fflush(stdout);
+  int saved = dup(STDOUT_FILENO);
+  int null = open("/dev/null", O_WRONLY);
+  dup2(null, STDOUT_FILENO);
+  close(null);
+  return saved;
+}
+
+static void loud(int saved){
+  fflush(stdout);
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+}
+
+static double now(void){
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static void count(void* context, const Record* records, int number){
+  Totals* totals = context;
+  for(int i = 0; i < number; i++){
+    totals->records++;
+    totals->idSum += records[i].id;
+  }
+}
+
+static void insert(int records){
+  HP_info* info = HP_OpenFile(FILE_NAME);
+  for(int i = 0; i < records; i++){
+    Record record = randomRecord();
+    HP_InsertEntry(info, record);
+    expected.records++;
+    expected.idSum += record.id;
+  }
+  HP_CloseFile(info);
+}
+
+// Blocks of the file on disk, the time of a full scan and whether it saw every record once. Return 1 if it did not
+static int report(const char* label, int mapped){
+  struct stat file;
+  stat(FILE_NAME, &file);
+
+  HP_info* info = mapped ? HP_OpenFileMapped(FILE_NAME) : HP_OpenFile(FILE_NAME);
+
+  Totals totals = {0, 0};
+  double start = now();
+  for(int i = 0; i < SCANS; i++){
+    HP_ScanPages(info, count, &totals);
+  }
+  double seconds = (now() - start) / SCANS;
+
+  int saved = quiet();    // The whole file is read for an id that is not there
+  int parallelBlocks = HP_ParallelGetAllEntries(info, -1, THREADS);
+  loud(saved);
+
+  int wrong = totals.records != expected.records * SCANS || totals.idSum != expected.idSum * SCANS ||
+              parallelBlocks != info->lastBlockId;
+  printf("%-28s %6ld blocks on disk, %3d sealed, scan %8.3f ms, %ld records%s\n", label, (long) file.st_size / BF_BLOCK_SIZE,
+         info->sealedBlocks, seconds * 1e3, totals.records / SCANS, wrong ? " (wrong)" : "");
+
+  HP_CloseFile(info);
+
+  return wrong;
+}
+
+int main(){
+  srand(12569874);
+
+  BF_Init(LRU);
+  HP_CreateFile(FILE_NAME);
+
+  int failed = 0;
+
+  insert(RECORDS_NUM);
+  failed |= report("before the seal", 0);
+
+  printf("Sealed %d blocks.\n", HP_SealFile(FILE_NAME));
+  failed |= report("sealed", 0);
+  failed |= report("sealed, mapped", 1);
+
+  insert(MORE_RECORDS);   // They go on in the last block and in new ones after it
+  failed |= report("inserts after the seal", 0);
+
+  printf("Sealed %d blocks.\n", HP_SealFile(FILE_NAME));
+  failed |= report("sealed again", 0);
+
+  BF_Close();
+  remove(FILE_NAME);
+
+  return failed;
+}
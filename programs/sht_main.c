@@ -6,10 +6,13 @@
 #include "bf.h"
 #include "ht_table.h"
 #include "sht_table.h"
+#include "bf_pool.h"
 
 #define RECORDS_NUM 200       // Number of records in database
+#define FALSE_POSITIVE_RATE 0.01  // Bloom filter false positive rate per bucket (0 for no filters)
 #define FILE_NAME "data.db"
 #define INDEX_NAME "index.db"
+#define INDEX_POOL_BLOCKS 32  // Blocks of the pool that keeps the index resident while the data blocks come and go
 
 #define CALL_OR_DIE(call){  \
   BF_ErrorCode code = call; \
@@ -24,8 +27,11 @@ int main(){
   // srand(time(NULL));
 
   BF_Init(LRU);
-  HT_CreateFile(FILE_NAME,10);
-  SHT_CreateSecondaryIndex(INDEX_NAME, 10, FILE_NAME);
+  CALL_OR_DIE(BF_PoolCreate("index", INDEX_POOL_BLOCKS, LRU));
+  CALL_OR_DIE(BF_PoolUse(INDEX_NAME, "index"));
+
+  HT_CreateFileWithFilter(FILE_NAME, 10, FALSE_POSITIVE_RATE);
+  SHT_CreateSecondaryIndexWithFilter(INDEX_NAME, 10, FILE_NAME, FALSE_POSITIVE_RATE);
 
   HT_info* info = HT_OpenFile(FILE_NAME);
   SHT_info* index_info = SHT_OpenSecondaryIndex(INDEX_NAME);
@@ -82,6 +88,7 @@ int main(){
   if(HT_CloseFile(info) == 0){
     printf("File %s closed successfully\n", FILE_NAME);
   }
+  BF_PoolDestroy("index");
   BF_Close();
 
   remove(FILE_NAME);
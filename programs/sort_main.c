@@ -0,0 +1,108 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bf.h"
+#include "hp_file.h"
+#include "ht_table.h"
+#include "wal.h"
+#include "external_sort.h"
+
+#define BUCKETS 50              // Number of buckets in hashtable
+#define RECORDS_NUM 20000       // Number of records in database
+#define BUDGET (64 * 1024)      // Bytes of the replacement selection heap, about 800 records
+#define FAN_IN 4                // Small, so the runs need more than one merge pass
+#define HT_FILE_NAME "data.db"
+#define HP_FILE_NAME "heap.db"
+#define SORTED_FILE_NAME "sorted.db"
+
+typedef struct{
+  Record_Attribute attribute;
+  Record last;
+  long records;
+  long outOfOrder;
+}Check;
+
+static void check(void* context, const Record* records, int count){
+  Check* state = context;
+
+  for(int i = 0; i < count; i++){
+    if(state->records > 0 && recordCompare(&state->last, &records[i], state->attribute) > 0){
+      state->outOfOrder++;
+    }
+    state->last = records[i];
+    state->records++;
+  }
+}
+
+static double now(void){
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static void report(const char* title, long sorted, SORT_Stats* stats, Record_Attribute attribute, double seconds){
+  Check state = {attribute, {{0}, 0, {0}, {0}, {0}}, 0, 0};
+
+  HP_info* info = HP_OpenFile(SORTED_FILE_NAME);
+  HP_ScanPages(info, check, &state);
+  HP_CloseFile(info);
+  remove(SORTED_FILE_NAME);
+
+  printf("%-21s: %ld records, %d runs, %d passes, %ld read back, %ld out of order in %.2f ms\n",
+         title, sorted, stats->runs, stats->passes, state.records, state.outOfOrder, seconds * 1e3);
+}
+
+int main(){
+  static Record records[RECORDS_NUM];
+  SORT_Stats stats;
+
+  srand(12569874);
+
+  BF_Init(LRU);
+  WAL_SetMode(WAL_NONE);
+  HT_CreateFile(HT_FILE_NAME, BUCKETS);
+  HP_CreateFile(HP_FILE_NAME);
+
+  HT_info* htInfo = HT_OpenFile(HT_FILE_NAME);
+  HP_info* hpInfo = HP_OpenFile(HP_FILE_NAME);
+
+  for(int i = 0; i < RECORDS_NUM; i++){
+    records[i] = randomRecord();
+  }
+  for(int i = RECORDS_NUM - 1; i > 0; i--){   // The ids are given in order, shuffled so sorting by id has work to do
+    int j = rand() % (i + 1);
+    Record swap = records[i];
+    records[i] = records[j];
+    records[j] = swap;
+  }
+  for(int i = 0; i < RECORDS_NUM; i++){
+    HP_InsertEntry(hpInfo, records[i]);
+    HT_InsertEntry(htInfo, records[i]);
+  }
+
+  printf("Inserted %d records, sorting with a %d byte budget and fan-in %d.\n\n", RECORDS_NUM, BUDGET, FAN_IN);
+
+  remove(SORTED_FILE_NAME);
+  double start = now();
+  long sorted = SORT_HeapFile(hpInfo, ID, SORTED_FILE_NAME, BUDGET, FAN_IN, &stats);
+  report("Heap by id", sorted, &stats, ID, now() - start);
+
+  start = now();
+  sorted = SORT_HashtableFile(htInfo, SURNAME, SORTED_FILE_NAME, BUDGET, FAN_IN, &stats);
+  report("Hashtable by surname", sorted, &stats, SURNAME, now() - start);
+
+  start = now();
+  sorted = SORT_HeapFile(hpInfo, ID, SORTED_FILE_NAME, 64 * 1024 * 1024, FAN_IN, &stats);
+  report("Heap by id, in memory", sorted, &stats, ID, now() - start);
+
+  HT_CloseFile(htInfo);
+  HP_CloseFile(hpInfo);
+  BF_Close();
+
+  remove(HT_FILE_NAME);
+  remove(HP_FILE_NAME);
+
+  return 0;
+}
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+// Turns a log of TRACE_Dump into a Chrome trace (the JSON of chrome://tracing and ui.perfetto.dev): every
+// function is a slice of its thread, every block event an instant with the file and block
+// Prints the calls and time of every function and the count of every block event too
+
+#define MAX_THREADS 64
+#define MAX_FUNCTIONS 64
+#define MAX_DEPTH 64
+
+typedef struct{
+  char name[64];
+  long calls;
+  double nanoseconds;     // Inclusive, from enter to exit
+}Function;
+
+typedef struct{
+  int depth;                          // Open functions, the exits of functions whose enter was overwritten are dropped
+  unsigned long enters[MAX_DEPTH];
+}Thread;
+
+static Function functions[MAX_FUNCTIONS];
+static int functionCount = 0;
+static Thread threads[MAX_THREADS];
+static long typeCounts[TRACE_TYPES];
+
+static Function* functionOf(const char* name){
+  for(int i = 0; i < functionCount; i++){
+    if(strcmp(functions[i].name, name) == 0){
+      return &functions[i];
+    }
+  }
+  if(functionCount == MAX_FUNCTIONS){
+    return NULL;
+  }
+
+  Function* function = &functions[functionCount++];
+  snprintf(function->name, sizeof(function->name), "%s", name);
+
+  return function;
+}
+
+static int typeOf(const char* name){
+  for(int i = 0; i < TRACE_TYPES; i++){
+    if(strcmp(TRACE_TypeNames[i], name) == 0){
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+int main(int argc, char** argv){
+  if(argc != 3){
+    printf("Usage: %s trace.log trace.json\n", argv[0]);
+    return 1;
+  }
+
+  FILE* log = fopen(argv[1], "r");
+  if(log == NULL){
+    perror(argv[1]);
+    return 1;
+  }
+  FILE* json = fopen(argv[2], "w");
+  if(json == NULL){
+    perror(argv[2]);
+    return 1;
+  }
+
+  unsigned long time = 0, start = 0;
+  int thread, file, block;
+  char typeName[16], name[64];
+  long events = 0, dropped = 0;
+
+  fprintf(json, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+  while(fscanf(log, "%lu %d %15s %d %d %63s", &time, &thread, typeName, &file, &block, name) == 6){
+    int type = typeOf(typeName);
+    if(type == -1 || thread < 1 || thread > MAX_THREADS){
+      dropped++;
+      continue;
+    }
+    if(events == 0){
+      start = time;
+    }
+
+    Thread* current = &threads[thread - 1];
+    double microseconds = (time - start) / 1000.0;
+
+    if(type == TRACE_ENTER){
+      if(current->depth < MAX_DEPTH){
+        current->enters[current->depth] = time;
+      }
+      current->depth++;
+      fprintf(json, "%s{\"name\": \"%s\", \"ph\": \"B\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d}", events > 0 ? ",\n" : "",
+              name, microseconds, thread);
+    }else if(type == TRACE_EXIT){
+      if(current->depth == 0){
+        dropped++;
+        continue;
+      }
+      current->depth--;
+      Function* function = functionOf(name);
+      if(function != NULL && current->depth < MAX_DEPTH){
+        function->calls++;
+        function->nanoseconds += time - current->enters[current->depth];
+      }
+      fprintf(json, "%s{\"name\": \"%s\", \"ph\": \"E\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d}", events > 0 ? ",\n" : "",
+              name, microseconds, thread);
+    }else{
+      fprintf(json, "%s{\"name\": \"%s\", \"cat\": \"block\", \"ph\": \"i\", \"s\": \"t\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d, "
+              "\"args\": {\"file\": %d, \"block\": %d}}", events > 0 ? ",\n" : "", typeName, microseconds, thread, file, block);
+    }
+    typeCounts[type]++;
+    events++;
+  }
+  fprintf(json, "\n]}\n");
+  fclose(log);
+
+  if(fclose(json) != 0){
+    perror(argv[2]);
+    return 1;
+  }
+
+  printf("%ld events (%ld dropped) over %.3f ms written to %s\n\n", events, dropped, (time - start) / 1e6, argv[2]);
+  printf("%-32s %10s %12s %12s\n", "function", "calls", "total ms", "mean us");
+  for(int i = 0; i < functionCount; i++){
+    printf("%-32s %10ld %12.3f %12.3f\n", functions[i].name, functions[i].calls, functions[i].nanoseconds / 1e6,
+           functions[i].nanoseconds / functions[i].calls / 1e3);
+  }
+  printf("\n");
+  for(int i = TRACE_PIN; i < TRACE_TYPES; i++){
+    printf("%-6s %10ld\n", TRACE_TypeNames[i], typeCounts[i]);
+  }
+
+  return 0;
+}
@@ -0,0 +1,163 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "record.h"
+#include "workload.h"
+
+#define RECORDS_NUM 1000000     // Records drawn for every timing
+#define SAMPLE 100000           // Records drawn to look at a distribution
+#define KEYS 10000              // Range of the ids
+#define FIRST_ID 1000           // First id of the sequential ids
+#define BATCH 1024              // Records of a WORKLOAD_Fill call
+#define THREADS 4
+
+static Record buffer[BATCH];
+
+typedef struct{
+  const WORKLOAD* workload;
+  int number;
+  unsigned long checksum;
+}Worker;
+
+static double now(void){
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static unsigned long checksum(const Record* records, int count){
+  unsigned long sum = 0;
+
+  for(int i = 0; i < count; i++){
+    sum = sum * 31 + records[i].id + records[i].name[0] + records[i].surname[1] + records[i].city[2];
+  }
+
+  return sum;
+}
+
+static void* work(void* argument){
+  Worker* worker = argument;
+  WORKLOAD_Stream stream;
+  Record records[BATCH];
+
+  WORKLOAD_StreamInit(&stream, worker->workload, worker->number, THREADS);
+  worker->checksum = 0;
+  for(int i = 0; i < RECORDS_NUM / THREADS; i += BATCH){
+    WORKLOAD_Fill(&stream, records, BATCH);
+    worker->checksum += checksum(records, BATCH);
+  }
+
+  return NULL;
+}
+
+// Counts the ids of a sample inside the range of the distribution, [firstId, firstId + SAMPLE) for the sequential one
+static void describe(const char* title, const WORKLOAD_Config* config){
+  static int counts[SAMPLE > KEYS ? SAMPLE : KEYS];
+  int low = config->distribution == WORKLOAD_SEQUENTIAL ? config->firstId : 0;
+  int range = config->distribution == WORKLOAD_SEQUENTIAL ? SAMPLE : config->keys;
+  WORKLOAD_Stream stream;
+  int top[10] = {0};
+
+  WORKLOAD* workload = WORKLOAD_Create(config, 42);
+  WORKLOAD_StreamInit(&stream, workload, 0, 1);
+  memset(counts, 0, sizeof(counts));
+
+  int outside = 0;
+  for(int i = 0; i < SAMPLE; i++){
+    Record record = WORKLOAD_Next(&stream);
+    if(record.id >= low && record.id < low + range){
+      counts[record.id - low]++;
+    }else{
+      outside++;
+    }
+  }
+
+  int distinct = 0;
+  for(int i = 0; i < range; i++){
+    distinct += counts[i] > 0;
+    for(int j = 0; j < 10; j++){    // The ten largest counts, largest first
+      if(counts[i] > top[j]){
+        memmove(&top[j + 1], &top[j], (9 - j) * sizeof(int));
+        top[j] = counts[i];
+        break;
+      }
+    }
+  }
+
+  int topTen = 0;
+  for(int j = 0; j < 10; j++){
+    topTen += top[j];
+  }
+
+  printf("  %-11s: %6d distinct ids in range, %6d outside, hottest id %5.2f%%, ten hottest %5.2f%%\n",
+         title, distinct, outside, 100.0 * top[0] / SAMPLE, 100.0 * topTen / SAMPLE);
+  WORKLOAD_Destroy(workload);
+}
+
+int main(){
+  WORKLOAD_Config config = {WORKLOAD_UNIFORM, KEYS, FIRST_ID, 0.99, 100, 0.9, 12, 12, 10};
+
+  /* Speed against randomRecord */
+
+  srand(12569874);
+  double start = now();
+  unsigned long sum = 0;
+  for(int i = 0; i < RECORDS_NUM; i++){
+    Record record = randomRecord();
+    sum += record.id;
+  }
+  double randomSeconds = now() - start;
+
+  WORKLOAD* workload = WORKLOAD_Create(&config, 42);
+  WORKLOAD_Stream stream;
+  WORKLOAD_StreamInit(&stream, workload, 0, 1);
+  start = now();
+  for(int i = 0; i < RECORDS_NUM; i += BATCH){
+    WORKLOAD_Fill(&stream, buffer, BATCH);
+    sum += buffer[0].id;
+  }
+  double fillSeconds = now() - start;
+
+  printf("Drawing %d records (checksum %lu):\n", RECORDS_NUM, sum % 1000);
+  printf("  randomRecord  : %6.2f ns per record\n", randomSeconds * 1e9 / RECORDS_NUM);
+  printf("  WORKLOAD_Fill : %6.2f ns per record\n", fillSeconds * 1e9 / RECORDS_NUM);
+
+  /* Reproducible streams, the same records from one thread or from THREADS */
+
+  Worker workers[THREADS];
+  pthread_t threads[THREADS];
+  unsigned long parallel = 0, serial = 0;
+
+  for(int i = 0; i < THREADS; i++){
+    workers[i].workload = workload;
+    workers[i].number = i;
+    pthread_create(&threads[i], NULL, work, &workers[i]);
+  }
+  for(int i = 0; i < THREADS; i++){
+    pthread_join(threads[i], NULL);
+    parallel += workers[i].checksum;
+  }
+  for(int i = 0; i < THREADS; i++){
+    work(&workers[i]);
+    serial += workers[i].checksum;
+  }
+  printf("\n%d streams in %d threads and in one: checksums %s\n", THREADS, THREADS, parallel == serial ? "equal" : "DIFFERENT");
+  WORKLOAD_Destroy(workload);
+
+  /* Distributions */
+
+  printf("\n%d records of every distribution, %d keys (sequential from %d):\n", SAMPLE, KEYS, FIRST_ID);
+  config.distribution = WORKLOAD_SEQUENTIAL;
+  describe("sequential", &config);
+  config.distribution = WORKLOAD_UNIFORM;
+  describe("uniform", &config);
+  config.distribution = WORKLOAD_ZIPF;
+  describe("zipf 0.99", &config);
+  config.distribution = WORKLOAD_DUPLICATES;
+  describe("duplicates", &config);
+
+  return 0;
+}